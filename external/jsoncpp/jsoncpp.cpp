@@ -4275,14 +4275,20 @@ JSONCPP_STRING valueToString(double value, bool useSpecialFloats, unsigned int p
   // that always has a decimal point because JSON doesn't distinguish the
   // concepts of reals and integers.
   if (isfinite(value)) {
-    len = snprintf(buffer, sizeof(buffer), formatString, value);
-    fixNumericLocale(buffer, buffer + len);
+    // local patch, see PATCHES.md: fixed-point output of large values (up to 309 digits for DBL_MAX) does not
+    // fit the buffer
+    len = snprintf(NULL, 0, formatString, value);
+    assert(len >= 0);
+    JSONCPP_STRING result(static_cast<size_t>(len) + 1, '\0');
+    snprintf(&result[0], result.size(), formatString, value);
+    result.resize(static_cast<size_t>(len));
+    fixNumericLocale(&result[0], &result[0] + len);
 
     // try to ensure we preserve the fact that this was given to us as a double on input
-    if (!strchr(buffer, '.') && !strchr(buffer, 'e')) {
-      strcat(buffer, ".0");
+    if (result.find('.') == JSONCPP_STRING::npos && result.find('e') == JSONCPP_STRING::npos) {
+      result += ".0";
     }
-
+    return result;
   } else {
     // IEEE standard states that NaN values will not compare to themselves
     if (value != value) {
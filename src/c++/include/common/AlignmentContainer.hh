@@ -0,0 +1,108 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Indexed container holding the alignment results of one sample for many graphs
+ *
+ * \file AlignmentContainer.hh
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <htslib/bgzf.h>
+
+namespace common
+{
+
+/**
+ * The container is a BGZF file with one JSON record per graph, and a tab-separated
+ * index file (container path + ".idx") with the graph key, virtual file offset and
+ * length of each record. Records are flushed and indexed as they are added, so a
+ * container written by an interrupted run can still be read.
+ */
+class AlignmentContainerWriter
+{
+public:
+    /**
+     * @param path container path, the index is written to path + ".idx"
+     */
+    explicit AlignmentContainerWriter(std::string const& path);
+    ~AlignmentContainerWriter();
+
+    AlignmentContainerWriter(AlignmentContainerWriter const&) = delete;
+    AlignmentContainerWriter& operator=(AlignmentContainerWriter const&) = delete;
+
+    std::string const& path() const { return path_; }
+
+    /**
+     * Add a record. Thread-safe.
+     * @param key graph key
+     * @param json serialized alignment JSON
+     */
+    void add(std::string const& key, std::string const& json);
+
+private:
+    const std::string path_;
+    BGZF* file_ = nullptr;
+    std::ofstream index_;
+    std::mutex mutex_;
+};
+
+/**
+ * Random access to the records of an alignment container
+ */
+class AlignmentContainerReader
+{
+public:
+    explicit AlignmentContainerReader(std::string const& path);
+    ~AlignmentContainerReader();
+
+    AlignmentContainerReader(AlignmentContainerReader const&) = delete;
+    AlignmentContainerReader& operator=(AlignmentContainerReader const&) = delete;
+
+    std::string const& path() const { return path_; }
+
+    bool contains(std::string const& key) const { return index_.count(key) != 0; }
+    std::size_t size() const { return index_.size(); }
+
+    /**
+     * Read the record for a key. Thread-safe.
+     * @return false if there is no record for the key
+     */
+    bool get(std::string const& key, std::string& json);
+
+private:
+    struct Record
+    {
+        int64_t offset;
+        std::size_t length;
+    };
+    const std::string path_;
+    BGZF* file_ = nullptr;
+    std::unordered_map<std::string, Record> index_;
+    std::mutex mutex_;
+};
+}
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -61,6 +62,19 @@ public:
      */
     explicit BamReader(const std::string& path, const std::string& index_path, const std::string& reference);
 
+    /**
+     * Create a reader which merges several BAM / CRAM files of the same sample, e.g. one per lane.
+     * The reads of a region are returned in coordinate order across all files, so mates from
+     * different files are paired up by read extraction. The files are opened in parallel.
+     * @param paths file paths
+     * @param index_paths index file paths, one per file (empty strings use the default location),
+     *                    or an empty vector to use the default locations for all files
+     * @param reference path to FASTA reference
+     */
+    BamReader(
+        const std::vector<std::string>& paths, const std::vector<std::string>& index_paths,
+        const std::string& reference);
+
     BamReader(BamReader&&) noexcept;
     BamReader& operator=(BamReader&&) noexcept;
     BamReader(const BamReader&) = delete;
@@ -91,9 +105,46 @@ public:
      */
     std::unique_ptr<DepthInfo> estimateDepth(std::string const& region) override;
 
+    /**
+     * estimate depth on a given region for each read group in the header, in the same pass
+     * as the estimate over all reads, which is stored with an empty key
+     */
+    std::map<std::string, std::unique_ptr<DepthInfo>> estimateReadGroupDepths(std::string const& region);
+
+    /**
+     * estimate the number of mapped reads in a region from the index statistics,
+     * assuming reads are spread evenly along the contig.
+     * return false if the index does not store read counts (e.g. CRAM)
+     */
+    bool estimateRegionReadCount(std::string const& region, size_t& read_count);
+
+    /**
+     * Keep the decoded reads of the last region and the results of mate lookups, so that
+     * overlapping regions requested one after the other are served without decoding the
+     * same BAM records again. When the next region overlaps the cached one and extends it
+     * to the right, only the new part is read. Ignored for CRAM input.
+     * @param max_reads maximum number of cached reads, regions with more reads are read
+     *                  without caching. 0 disables the cache.
+     */
+    void enableReadCache(size_t max_reads);
+
+    /**
+     * Set the read group of each read from its RG tag. Off by default, since only extracting the reads of
+     * samples stored as read groups needs it.
+     */
+    void enableReadGroups();
+
 protected:
     int SkipToNextGoodAlign();
 
+private:
+    bool setCachedRegion(const std::string& region_encoding);
+    bool cacheReads(int tid, int beg, int end, int64_t min_pos);
+    bool findAlignedMate(const Read& read, Read& mate);
+    bool getMergedAlign(Read& read);
+    std::map<std::string, std::unique_ptr<DepthInfo>>
+    estimateGroupDepths(std::string const& region, bool by_read_group);
+
 private:
     struct BamReaderImpl;
     std::unique_ptr<BamReaderImpl> _impl;
@@ -0,0 +1,112 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Memory budget for admission control of in-flight graphs
+ *
+ * \file MemoryBudget.hh
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace common
+{
+
+/**
+ * Estimate the number of bytes a ReadBuffer holding num_reads reads will use
+ * during extraction and alignment
+ * @param num_reads number of reads
+ * @param read_length (average) read length
+ * @return estimated number of bytes
+ */
+std::size_t estimateReadBufferSize(std::size_t num_reads, std::size_t read_length);
+
+/**
+ * Counting budget shared between worker threads. Each worker acquires the estimated
+ * footprint of a graph before extracting reads for it and releases it when the graph
+ * is done. A request which is larger than the whole budget is admitted once nothing
+ * else is in flight, so we never deadlock.
+ */
+class MemoryBudget
+{
+public:
+    /**
+     * @param capacity budget in bytes, 0 means unlimited
+     */
+    explicit MemoryBudget(std::size_t capacity = 0)
+        : capacity_(capacity)
+    {
+    }
+    MemoryBudget(MemoryBudget const&) = delete;
+    MemoryBudget& operator=(MemoryBudget const&) = delete;
+
+    /**
+     * Block until bytes fit into the budget and reserve them
+     * @return number of bytes reserved (0 when the budget is unlimited)
+     */
+    std::size_t acquire(std::size_t bytes);
+
+    /**
+     * Return reserved bytes to the budget
+     */
+    void release(std::size_t bytes);
+
+    std::size_t capacity() const { return capacity_; }
+    bool unlimited() const { return capacity_ == 0; }
+
+    /**
+     * @return number of bytes currently reserved
+     */
+    std::size_t inFlight() const;
+
+private:
+    const std::size_t capacity_;
+    std::size_t inFlight_ = 0;
+    std::size_t reservations_ = 0;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+};
+
+/**
+ * Scoped reservation on a MemoryBudget
+ */
+class MemoryReservation
+{
+public:
+    MemoryReservation(MemoryBudget& budget, std::size_t bytes)
+        : budget_(budget)
+        , bytes_(budget.acquire(bytes))
+    {
+    }
+    MemoryReservation(MemoryReservation const&) = delete;
+    MemoryReservation& operator=(MemoryReservation const&) = delete;
+    ~MemoryReservation() { budget_.release(bytes_); }
+
+    std::size_t bytes() const { return bytes_; }
+
+private:
+    MemoryBudget& budget_;
+    const std::size_t bytes_;
+};
+}
@@ -0,0 +1,156 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Bounded producer / consumer queue with a dedicated producer thread
+ *
+ * \file Prefetcher.hh
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "common/Error.hh"
+
+namespace common
+{
+
+/**
+ * \brief Runs a producer function on its own thread and buffers up to capacity
+ *        items for consumers. Used to overlap I/O-bound read extraction with
+ *        CPU-bound alignment on the thread pool.
+ *
+ * The producer is called repeatedly until it returns false. Exceptions thrown by the
+ * producer are rethrown to the consumers once all items produced before are consumed.
+ */
+template <typename T> class Prefetcher
+{
+public:
+    typedef std::function<bool(T&)> Producer;
+
+    Prefetcher(std::size_t capacity, Producer producer)
+        : capacity_(std::max<std::size_t>(capacity, 1))
+        , producer_(std::move(producer))
+    {
+        thread_ = std::thread(&Prefetcher::produce, this);
+    }
+
+    Prefetcher(Prefetcher const&) = delete;
+    Prefetcher& operator=(Prefetcher const&) = delete;
+
+    ~Prefetcher()
+    {
+        cancel();
+        thread_.join();
+    }
+
+    /**
+     * \brief Retrieve the next item. Thread-safe.
+     * \return false once the producer is done and all items have been consumed
+     */
+    bool next(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stateChanged_.wait(lock, [this]() { return !queue_.empty() || finished_; });
+        if (queue_.empty())
+        {
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+            return false;
+        }
+        item = std::move(queue_.front());
+        queue_.pop_front();
+        stateChanged_.notify_all();
+        return true;
+    }
+
+    /**
+     * \brief Stop producing more items and drop the ones not consumed yet, e.g. when a consumer has failed
+     */
+    void cancel()
+    {
+        std::deque<T> dropped;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_ = true;
+            // dropped items are destroyed outside the lock; they may hold resources the producer waits for
+            dropped.swap(queue_);
+        }
+        stateChanged_.notify_all();
+    }
+
+private:
+    void produce()
+    {
+        try
+        {
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    stateChanged_.wait(lock, [this]() { return queue_.size() < capacity_ || cancelled_; });
+                    if (cancelled_)
+                    {
+                        break;
+                    }
+                }
+                T item;
+                if (!producer_(item))
+                {
+                    break;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(item));
+                stateChanged_.notify_all();
+            }
+        }
+        catch (...)
+        {
+            LOG()->critical("ERROR: Prefetch thread caught an exception");
+            std::lock_guard<std::mutex> lock(mutex_);
+            exception_ = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+        }
+        stateChanged_.notify_all();
+    }
+
+    const std::size_t capacity_;
+    Producer producer_;
+    std::deque<T> queue_;
+    bool finished_ = false;
+    bool cancelled_ = false;
+    std::exception_ptr exception_;
+    std::mutex mutex_;
+    std::condition_variable stateChanged_;
+    std::thread thread_;
+};
+}
@@ -78,6 +78,10 @@ public:
     void set_pos(int32_t value) { pos_ = value; };
     uint8_t mapq() const { return mapq_; };
     void set_mapq(uint8_t value) { mapq_ = value; };
+    std::string const& read_group() const { return read_group_; };
+    void set_read_group(std::string const& value) { read_group_ = value; };
+    bool has_single_match_cigar() const { return has_single_match_cigar_; };
+    void set_has_single_match_cigar(bool value) { has_single_match_cigar_ = value; };
 
     bool is_reverse_strand() const { return is_reverse_strand_; };
     void set_is_reverse_strand(bool value) { is_reverse_strand_ = value; };
@@ -239,6 +243,10 @@ private:
     int32_t chrom_id_ = -1;
     int32_t pos_ = -1;
     uint8_t mapq_ = 0;
+    // RG tag, empty if the record has none
+    std::string read_group_;
+    // linear alignment is a single M / = operation, i.e. without indels or clips
+    bool has_single_match_cigar_ = false;
 
     bool is_reverse_strand_ = false;
     bool is_mate_reverse_strand_ = false;
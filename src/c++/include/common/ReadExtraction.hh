@@ -24,12 +24,18 @@
 #include "common/Region.hh"
 
 #include <list>
+#include <string>
 #include <utility>
 #include <vector>
 
 namespace common
 {
 
+/**
+ * Average fragment length assumed when reads are extracted. Target regions are extended by three times this.
+ */
+const int kAverageFragmentLength = 333;
+
 /**
  * High-level read extraction interface
  * @param reader An open reader
@@ -37,10 +43,14 @@ namespace common
  * @param max_reads maximum number of reads per target region to retrieve
  * @param all_reads output vector to store retrieved reads
  * @param avr_fragment_length decides how long to extend beyond target region
+ * @param max_read_density if > 0, replaces max_reads by this many reads per base of each extended target region
+ *                         and subsamples the read pairs of regions above that, see extractReadsFromRegion
+ * @param recover_mates recover missing mates also when the graph has no long insertions
  */
 void extractReads(
     BamReader& reader, std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
-    std::vector<p_Read>& all_reads, int avr_fragment_length = 333);
+    std::vector<p_Read>& all_reads, int avr_fragment_length = kAverageFragmentLength, double max_read_density = 0.0,
+    bool recover_mates = false);
 
 /**
  * High-level read extraction interface
@@ -55,7 +65,51 @@ void extractReads(
 void extractReads(
     const std::string& bam_path, const std::string& bam_index_path, const std::string& reference_path,
     std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
-    std::vector<p_Read>& all_reads, int avr_fragment_length = 333);
+    std::vector<p_Read>& all_reads, int avr_fragment_length = kAverageFragmentLength);
+
+/**
+ * Read extraction for several samples stored as read groups of the same file(s). Each target region is
+ * read once and records are routed to the samples by their RG tag.
+ * @param reader An open reader
+ * @param target_regions list of target regions
+ * @param max_reads maximum number of reads per target region and sample to retrieve
+ * @param sample_names names of the samples for logging
+ * @param read_groups read group IDs of each sample
+ * @param sample_reads output vectors to store retrieved reads, one per sample
+ * @param avr_fragment_length decides how long to extend beyond target region
+ * @param recover_mates recover missing mates also when the graph has no long insertions
+ */
+void extractReadGroupReads(
+    BamReader& reader, std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
+    std::vector<std::string> const& sample_names, std::vector<std::vector<std::string>> const& read_groups,
+    std::vector<std::vector<p_Read>>& sample_reads, int avr_fragment_length = kAverageFragmentLength,
+    bool recover_mates = false);
+
+/**
+ * Estimate how many reads extractReads will retrieve using the index statistics of the reader
+ * @param reader An open reader
+ * @param target_regions list of target regions
+ * @param max_num_reads maximum number of reads per target region to retrieve
+ * @param avr_fragment_length decides how long to extend beyond target region
+ * @param max_read_density if > 0, replaces max_num_reads as in extractReads
+ * @return estimated number of reads; max_num_reads per region when the index has no read counts
+ */
+size_t estimateNumReads(
+    BamReader& reader, std::list<Region> const& target_regions, int max_num_reads, int avr_fragment_length = kAverageFragmentLength,
+    double max_read_density = 0.0);
+
+/**
+ * Estimate the read length of a file from its first reads
+ * @param reader An open reader, its region is reset to the start of the file
+ * @param num_reads maximum number of reads to look at
+ * @return average length of these reads, 0 if there are none
+ */
+size_t estimateReadLength(ReadReader& reader, int num_reads = 1000);
+
+/**
+ * @return read limit for a region with the given number of reads per base
+ */
+int maxReadsForDensity(const Region& region, double max_read_density);
 
 /**
  * Lower-level read extraction interface for specified target region
@@ -65,10 +119,14 @@ void extractReads(
  * @param reader Reader that will provide the reads
  * @param region Target region
  * @param avr_fragment_length Decides how long to extend beyond target region
+ * @param max_read_density if > 0, replaces max_reads by this many reads per base of the extended region. Regions
+ *                         with more reads are subsampled uniformly instead of truncated.
+ * @param recover_mates recover missing mates also when the graph has no long insertions
  */
 std::pair<int, int> extractReadsFromRegion(
     std::vector<p_Read>& all_reads, int max_num_reads, ReadReader& reader, const Region& region,
-    unsigned longest_alt_insertion, int avr_fragment_length);
+    unsigned longest_alt_insertion, int avr_fragment_length, double max_read_density = 0.0,
+    bool recover_mates = false);
 
 /**
  * Low-level read extraction for mapped reads in target region
@@ -79,6 +137,19 @@ std::pair<int, int> extractReadsFromRegion(
  */
 int extractMappedReadsFromRegion(ReadPairs& read_pairs, int max_num_reads, ReadReader& reader, const Region& region);
 
+/**
+ * Low-level read extraction for mapped reads in target region which keeps a uniform subsample of the read
+ * pairs instead of the first max_num_reads. Whenever there are more reads than max_num_reads, the pairs
+ * with a fragment hash above half of max_hash are removed.
+ * @param read_pairs Container for extracted reads
+ * @param reader Reader that will provide the reads
+ * @param region Region to check if a read is in
+ * @param max_hash pairs with a higher fragment hash are not kept, updated when subsampling
+ * @return average read length
+ */
+int extractSubsampledReadsFromRegion(
+    ReadPairs& read_pairs, int max_num_reads, ReadReader& reader, const Region& region, uint32_t& max_hash);
+
 /**
  * return true if this aligned read or its mate overlaps >= 1 base with the target region
  */
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -57,6 +58,17 @@ public:
     void getReads(std::vector<Read>& reads);
     void getReads(std::vector<p_Read>& reads);
 
+    /**
+     * Remove the read pairs whose fragment hash is above max_hash. Keeps a uniform subsample of the
+     * pairs which doesn't depend on their position and leaves mates together.
+     */
+    void removeAboveHash(uint32_t max_hash);
+
+    /**
+     * @return FNV-1a hash of a fragment ID
+     */
+    static uint32_t fragmentHash(const std::string& fragment_id);
+
 private:
     std::map<std::string, ReadPair> read_pairs_;
     int num_reads_ = 0;
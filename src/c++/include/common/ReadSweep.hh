@@ -0,0 +1,94 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Read extraction for many targets with one sequential pass over a BAM / CRAM file
+ *
+ * \file ReadSweep.hh
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include "common/Read.hh"
+#include "common/ReadExtraction.hh"
+#include "common/Region.hh"
+
+namespace common
+{
+
+/**
+ * \brief Streams a coordinate-sorted BAM / CRAM file once and routes each record to all
+ *        targets whose extended target regions it overlaps. For large numbers of targets this
+ *        is cheaper than one index lookup per target region and doesn't need an index.
+ *
+ * Each target receives the same reads extractReads would retrieve for it. A target is complete
+ * as soon as the sweep has passed all its target regions, unless mates of its reads need to be
+ * recovered from elsewhere in the file: these are looked up in the index if there is one, and
+ * otherwise collected in a second pass, which completes the remaining targets.
+ *
+ * Example:
+ *   ReadSweep sweep(bam_path, "", reference_path);
+ *   for (auto const& graph : graphs)
+ *     sweep.addTarget(graph.target_regions, max_reads, graph.longest_alt_insertion);
+ *   std::size_t target;
+ *   ReadBuffer reads;
+ *   while (sweep.next(target, reads)) { ... }
+ */
+class ReadSweep
+{
+public:
+    /**
+     * @param path BAM / CRAM file sorted by coordinate
+     * @param index_path index file path, empty to use the default location. The index is optional.
+     * @param reference path to FASTA reference
+     */
+    ReadSweep(const std::string& path, const std::string& index_path, const std::string& reference);
+
+    ReadSweep(ReadSweep const&) = delete;
+    ReadSweep& operator=(ReadSweep const&) = delete;
+
+    ~ReadSweep();
+
+    /**
+     * Add a target. All targets must be added before the first call to next.
+     * Parameters are the same as for extractReads.
+     * @return index of the target
+     */
+    std::size_t addTarget(
+        std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
+        int avr_fragment_length = kAverageFragmentLength, bool recover_mates = false);
+
+    /**
+     * Read on until the next target is complete
+     * @param target index of the completed target
+     * @param reads output buffer for the reads of the target, previous contents are replaced
+     * @return false once all targets have been returned
+     */
+    bool next(std::size_t& target, ReadBuffer& reads);
+
+private:
+    struct ReadSweepImpl;
+    std::unique_ptr<ReadSweepImpl> _impl;
+};
+}
@@ -0,0 +1,89 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Content-addressed cache for per-graph results
+ *
+ * \file ResultCache.hh
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+namespace common
+{
+
+/**
+ * Collects everything a result depends on and hashes it into a cache key.
+ * The program version is always included.
+ */
+class CacheKey
+{
+public:
+    CacheKey();
+
+    /**
+     * Add a named value
+     */
+    CacheKey& add(std::string const& name, std::string const& value);
+
+    /**
+     * Add the identity of a file: absolute path, size and modification time
+     */
+    CacheKey& addFile(std::string const& name, std::string const& path);
+
+    /**
+     * @return hex digest of all values added
+     */
+    std::string digest() const;
+
+private:
+    std::string data_;
+};
+
+/**
+ * Directory of results keyed by CacheKey digest. Entries are written to a temporary
+ * file and renamed, so a run killed part-way never leaves a partial entry behind and
+ * several processes can share a cache directory.
+ */
+class ResultCache
+{
+public:
+    /**
+     * @param directory cache directory, created if missing. Empty disables the cache.
+     */
+    explicit ResultCache(std::string const& directory = "");
+
+    bool enabled() const { return !directory_.empty(); }
+
+    /**
+     * @return false if there is no entry for key
+     */
+    bool get(std::string const& key, std::string& value) const;
+
+    void put(std::string const& key, std::string const& value) const;
+
+private:
+    std::string path(std::string const& key) const;
+
+    std::string directory_;
+};
+}
@@ -29,7 +29,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cctype>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -174,6 +176,41 @@ namespace stringutil
         }
     }
 
+    /**
+     * @brief Parse a memory size
+     *
+     * @param input input string, e.g. "512M" or "16G". Suffixes K/M/G/T are powers of 1024,
+     *              no suffix means bytes.
+     * @return number of bytes
+     */
+    static inline uint64_t parseMemorySize(std::string input)
+    {
+        input.erase(std::remove_if(input.begin(), input.end(), ::isspace), input.end());
+        if (!input.empty() && (input.back() == 'b' || input.back() == 'B'))
+        {
+            input.pop_back();
+        }
+        uint64_t multiplier = 1;
+        if (!input.empty() && !::isdigit(input.back()))
+        {
+            static const std::string suffixes = "KMGT";
+            const size_t power = suffixes.find((char)::toupper(input.back()));
+            if (power == std::string::npos)
+            {
+                throw std::invalid_argument("Invalid memory size suffix: " + input);
+            }
+            multiplier <<= 10 * (power + 1);
+            input.pop_back();
+        }
+        size_t parsed = 0;
+        const double value = std::stod(input, &parsed);
+        if (parsed != input.size() || value < 0)
+        {
+            throw std::invalid_argument("Invalid memory size: " + input);
+        }
+        return static_cast<uint64_t>(value * multiplier);
+    }
+
     /**
      * upper-case a string
      */
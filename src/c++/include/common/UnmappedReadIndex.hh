@@ -0,0 +1,101 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief On-disk k-mer index of unmapped and low-MAPQ reads
+ *
+ * \file UnmappedReadIndex.hh
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/Read.hh"
+
+namespace common
+{
+
+/**
+ * \brief Reads from long insertions are often unmapped or mapped elsewhere with low MAPQ, so they are
+ *        not found in the target regions of a graph. This index is built with one pass over the BAM /
+ *        CRAM files of a sample. It stores these reads together with a sorted table of the k-mers at
+ *        every kStride-th read position, so reads sharing k-mers with insertion sequences can be
+ *        recruited for each graph without scanning the files again. The index file is memory-mapped, so
+ *        the k-mer table of a sample is only paged in while reads are recruited for it.
+ *
+ * Example:
+ *   auto index = UnmappedReadIndex::open({ bam_path }, reference_path, "sample.unmapped", 1);
+ *   index->recruitReads(insertion_sequences, max_reads, reads);
+ */
+class UnmappedReadIndex
+{
+public:
+    static const unsigned kKmerLength = 16;
+    static const unsigned kStride = 8;
+
+    /**
+     * Load an index, building it first if the file doesn't exist or was built from other files or settings.
+     * @param paths BAM / CRAM files of the sample
+     * @param reference path to FASTA reference
+     * @param index_file path of the index file
+     * @param min_mapq mapped reads with a lower MAPQ are indexed as well. 0 indexes only reads flagged as
+     *                 unmapped, including those placed at the position of their mapped mate.
+     */
+    static std::unique_ptr<UnmappedReadIndex> open(
+        std::vector<std::string> const& paths, std::string const& reference, std::string const& index_file,
+        int min_mapq);
+
+    /**
+     * Build an index file, see open
+     */
+    static void build(
+        std::vector<std::string> const& paths, std::string const& reference, std::string const& index_file,
+        int min_mapq);
+
+    /**
+     * Map an index file
+     */
+    explicit UnmappedReadIndex(std::string const& index_file);
+    ~UnmappedReadIndex();
+
+    UnmappedReadIndex(UnmappedReadIndex const&) = delete;
+    UnmappedReadIndex& operator=(UnmappedReadIndex const&) = delete;
+
+    size_t numReads() const;
+
+    /**
+     * Add reads which share k-mers with any of the sequences on either strand. Reads already in the
+     * output are not added again. Thread-safe.
+     * @param sequences sequences to look up, e.g. of insertion nodes
+     * @param max_num_reads maximum number of reads to add
+     * @param reads output vector to add reads to
+     * @return number of reads added
+     */
+    size_t recruitReads(std::vector<std::string> const& sequences, size_t max_num_reads, ReadBuffer& reads) const;
+
+private:
+    struct UnmappedReadIndexImpl;
+    std::unique_ptr<UnmappedReadIndexImpl> _impl;
+};
+}
@@ -63,6 +63,7 @@ public:
      * @param param Pointer to genotyping parameters
      */
     explicit BreakpointGenotyper(std::unique_ptr<GenotypingParameters> const& param);
+    explicit BreakpointGenotyper(GenotypingParameters const& param);
 
     /**
      * public function to do breakpoint genotyping from read counts on edges
@@ -76,12 +77,32 @@ public:
 
 private:
     /**
-     * return genotype likelihood given genotype (using Poisson model with internal parameters)
+     * compute the log-likelihoods of all possible genotypes (using Poisson model with internal parameters)
      * @param lambda Poisson distribution parameter
-     * @param gv Genotype vector
      * @param read_counts Read count vector for each allele
+     * @param gls output, one GL per possible genotype
      */
-    double genotypeLikelihood(double lambda, const GenotypeVector& gv, const std::vector<int32_t>& read_counts) const;
+    void genotypeLikelihoods(double lambda, const std::vector<int32_t>& read_counts, std::vector<double>& gls) const;
+
+    /**
+     * compute the log-likelihoods of genotypes made of supported alleles plus those with one copy of an allele
+     * without support; used when there are too many possible genotypes to evaluate all of them
+     * @param lambda Poisson distribution parameter
+     * @param read_counts Read count vector for each allele
+     * @param gl_names output, the evaluated genotypes in the order of possible_genotypes
+     * @param gls output, one GL per evaluated genotype
+     */
+    void prunedGenotypeLikelihoods(
+        double lambda, const std::vector<int32_t>& read_counts, std::vector<GenotypeVector>& gl_names,
+        std::vector<double>& gls) const;
+
+    /**
+     * Poisson log-pmf of the read count of each allele for each number of copies of that allele
+     * @param lambda Poisson distribution parameter
+     * @param read_counts Read count vector for each allele
+     * @param log_pdf output, row-major table of n_alleles_ x (max_allele_copies_ + 1)
+     */
+    void alleleLogPdfs(double lambda, const std::vector<int32_t>& read_counts, std::vector<double>& log_pdf) const;
 
     unsigned int n_alleles_;
     unsigned int ploidy_;
@@ -110,5 +131,18 @@ private:
     std::vector<double> haplotype_read_fraction_; // mean expected haplotype fraction for each allele
 
     std::map<GenotypeVector, double> genotype_prior_; // genotype prior log probabilities
+    double other_genotype_log_prior_ = 0; // log prior of genotypes not in genotype_prior_
+
+    bool pruned_search_; // true when there are too many possible genotypes to evaluate all of them
+
+    double min_supported_allele_fraction_; // minimum fraction of reads for an allele in the pruned search
+
+    /**
+     * tables for evaluating all genotypes at once, derived from the parameters above
+     */
+    unsigned int max_allele_copies_; // genotype size, the largest number of copies of an allele
+    std::vector<double> genotype_log_prior_; // log prior of each possible genotype
+    std::vector<unsigned int> genotype_allele_copies_; // copies of each allele in each genotype, row-major
+    std::vector<double> allele_rate_factors_; // Poisson rate / lambda for each allele and number of copies
 };
 };
\ No newline at end of file
@@ -69,6 +69,30 @@ public:
     void addCounts(Json::Value const& paragraph_json);
     int32_t getCount(std::string const& edge_or_allele_name) const;
 
+    /**
+     * Add edge counts from paragraph output to external count arrays, so the same breakpoint can be used
+     * for many samples
+     * @param paragraph_json JSON output from alignAndDisambiguate
+     * @param edge_counts counts in the order of edgeNames()
+     * @param allele_counts counts in the order of canonicalAlleleNames()
+     */
+    void addCounts(Json::Value const& paragraph_json, AlleleCounts& edge_counts, AlleleCounts& allele_counts) const;
+
+    /**
+     * Get a count from external count arrays, see addCounts
+     */
+    int32_t getCount(
+        std::string const& edge_or_allele_name, AlleleCounts const& edge_counts,
+        AlleleCounts const& allele_counts) const;
+
+    /**
+     * Find the position of an edge or allele in the count arrays
+     * @param edge_or_allele_name name of edge or allele
+     * @param is_edge set to true for edges and to false for alleles
+     * @return index in edge or allele counts, -1 if the name is unknown
+     */
+    int countIndex(std::string const& edge_or_allele_name, bool& is_edge) const;
+
     /**
      * @return vector of edge names
      */
@@ -96,8 +120,8 @@ public:
     }
 
 private:
-    // edge to allele index and allele names
-    std::unordered_map<std::string, std::vector<size_t>> edgename_to_alleles;
+    // edge index to allele indexes
+    std::vector<std::vector<size_t>> edge_alleles;
 
     // order of edge and allele names for AlleleCounts arrays below
     std::vector<std::string> edge_names;
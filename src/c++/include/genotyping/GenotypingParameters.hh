@@ -75,10 +75,24 @@ public:
 
     double otherHetHaplotypeFraction() const { return other_het_haplotype_fraction; }
 
+    double otherGenotypeFraction() const { return other_genotype_fraction; }
+
+    /**
+     * @return all possible unphased genotypes, empty if there are more than maxExhaustiveGenotypes
+     */
     const std::vector<GenotypeVector>& possibleGenotypes() const { return possible_genotypes; };
 
+    /**
+     * @return number of possible unphased genotypes, without enumerating them
+     */
+    uint64_t numPossibleGenotypes() const;
+
     bool usePoissonDepth() const { return use_poisson_depth; }
 
+    unsigned int maxExhaustiveGenotypes() const { return max_exhaustive_genotypes; }
+
+    double minSupportedAlleleFraction() const { return min_supported_allele_fraction; }
+
 private:
     /**
      * Set the vector of all possible unphased genotypes from stored alleles and ploidy.
@@ -134,7 +148,7 @@ private:
     unsigned int min_overlap_bases;
 
     /**
-     * all possible genotypes under given ploidy_
+     * all possible genotypes under given ploidy_, unless there are more than max_exhaustive_genotypes
      */
     std::vector<GenotypeVector> possible_genotypes;
 
@@ -168,5 +182,15 @@ private:
     double other_genotype_fraction;
 
     bool use_poisson_depth;
+
+    /**
+     * with more possible genotypes than this, only genotypes of alleles with read support are evaluated
+     */
+    unsigned int max_exhaustive_genotypes;
+
+    /**
+     * minimum fraction of reads for an allele to count as supported in the pruned genotype search
+     */
+    double min_supported_allele_fraction;
 };
 };
\ No newline at end of file
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 
 #include "GraphGenotyper.hh"
 #include "genotyping/Genotype.hh"
@@ -36,12 +37,20 @@
 
 namespace genotyping
 {
+class BreakpointGenotyper;
+
 class GraphBreakpointGenotyper : public GraphGenotyper
 {
 public:
-    GraphBreakpointGenotyper(unsigned int male_ploidy = 2, unsigned int female_ploidy = 2)
+    /**
+     * @param male_ploidy ploidy of male samples
+     * @param female_ploidy ploidy of female samples and samples with unknown sex
+     * @param threads number of threads for genotyping breakpoints and samples
+     */
+    GraphBreakpointGenotyper(unsigned int male_ploidy = 2, unsigned int female_ploidy = 2, unsigned int threads = 1)
         : male_ploidy_(male_ploidy)
-        , female_ploidy_(female_ploidy){};
+        , female_ploidy_(female_ploidy)
+        , threads_(threads){};
 
     /**
      * set genotyping parameters from JSON
@@ -58,15 +67,25 @@ private:
     /**
      * get ploidy according to its sex
      */
-    unsigned int getSamplePloidy(size_t sample_index);
+    unsigned int getSamplePloidy(size_t sample_index) const;
+
+    /**
+     * Run work(begin, end) on ranges of [0, num_items) on our threads. Each thread gets its own state from
+     * make_state, e.g. its own read count buffer.
+     */
+    template <typename MakeState, typename Work>
+    void parallelFor(size_t num_items, MakeState make_state, Work work) const;
 
     /**
-     * genotyping parameters
+     * genotyping parameters and genotypers, shared with other graphs that use the same parameters
      */
-    std::unique_ptr<GenotypingParameters> p_genotype_parameter;
-    std::unique_ptr<GenotypingParameters> p_male_genotype_parameter;
+    std::shared_ptr<const GenotypingParameters> p_genotype_parameter;
+    std::shared_ptr<const GenotypingParameters> p_male_genotype_parameter;
+    std::shared_ptr<const BreakpointGenotyper> p_genotyper;
+    std::shared_ptr<const BreakpointGenotyper> p_male_genotyper;
 
     unsigned int male_ploidy_;
     unsigned int female_ploidy_;
+    unsigned int threads_;
 };
 }
@@ -129,6 +129,14 @@ protected:
      */
     int32_t getCount(size_t sample_index, std::string const& breakpoint, std::string const& edge_or_allele_name) const;
 
+    /**
+     * Get the read counts of all alleles on a breakpoint
+     * @param sample_index index of sample (name is in sampleNames[sample_index])
+     * @param breakpoint_index index of the breakpoint in breakpointNames()
+     * @param counts output, one count per allele in alleleNames()
+     */
+    void getAlleleCounts(size_t sample_index, size_t breakpoint_index, std::vector<int32_t>& counts) const;
+
     /**
      * Get the depth data for a sample
      * @param sample_index index of sample (name is in sampleNames[sample_index])
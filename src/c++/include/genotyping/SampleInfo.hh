@@ -50,9 +50,33 @@ public:
     std::string const& sample_name() const { return sample_name_; }
     void set_sample_name(std::string const& sample_name) { sample_name_ = sample_name; }
     std::string const& filename() const { return filename_; }
-    void set_filename(std::string const& filename) { filename_ = filename; }
+    void set_filename(std::string const& filename) { set_filenames({ filename }); }
     std::string const& index_filename() const { return index_filename_; }
-    void set_index_filename(std::string const& index_filename) { index_filename_ = index_filename; }
+    void set_index_filename(std::string const& index_filename) { set_index_filenames({ index_filename }); }
+
+    /**
+     * All alignment files of a sample which was sequenced in several parts, e.g. one file per lane.
+     * filename() / index_filename() return the first of them.
+     */
+    std::vector<std::string> const& filenames() const { return filenames_; }
+    void set_filenames(std::vector<std::string> const& filenames)
+    {
+        filenames_ = filenames;
+        filename_ = filenames.empty() ? std::string() : filenames.front();
+    }
+    std::vector<std::string> const& index_filenames() const { return index_filenames_; }
+    void set_index_filenames(std::vector<std::string> const& index_filenames)
+    {
+        index_filenames_ = index_filenames;
+        index_filename_ = index_filenames.empty() ? std::string() : index_filenames.front();
+    }
+
+    /**
+     * Read groups of the sample when its files hold reads of several samples. Empty if all reads belong
+     * to the sample.
+     */
+    std::vector<std::string> const& read_groups() const { return read_groups_; }
+    void set_read_groups(std::vector<std::string> const& read_groups) { read_groups_ = read_groups; }
 
     /**
      * Getters / setters for BAM statistics
@@ -82,15 +106,28 @@ public:
     void set_alignment_data(Json::Value const& alignment_data) { alignment_data_ = alignment_data; }
     Json::Value const& get_alignment_data() const { return alignment_data_; }
 
+    /**
+     * Getter / setter for the alignment container written by grmpy --alignment-container
+     */
+    std::string const& alignment_container() const { return alignment_container_; }
+    void set_alignment_container(std::string const& alignment_container)
+    {
+        alignment_container_ = alignment_container;
+    }
+
 private:
     std::string sample_name_;
     std::string filename_;
     std::string index_filename_;
+    std::vector<std::string> filenames_;
+    std::vector<std::string> index_filenames_;
+    std::vector<std::string> read_groups_;
     unsigned int read_length_ = 0;
     double autosome_depth_ = 0.0;
     double depth_sd_ = 0.0;
     Sex sex_ = UNKNOWN;
     Json::Value alignment_data_ = Json::nullValue;
+    std::string alignment_container_;
 };
 
 typedef std::vector<SampleInfo> Samples;
@@ -99,9 +136,11 @@ typedef std::vector<SampleInfo> Samples;
  * Load manifest file. A manifest contains
  *
  *  * Sample names
- *  * Sample BAM/CRAM file locations
+ *  * Sample BAM/CRAM file locations, several files of a sample separated by ';'
+ *  * (optionally) read groups of the sample in files shared with other samples, separated by ';'
  *  * Depth estimates, or location of idxdepth output
  *  * (optionally) location of alignment JSON
+ *  * (optionally) location of an alignment container holding alignments for many graphs
  *
  * @param filename file name of manifest
  * @return list of sample info records
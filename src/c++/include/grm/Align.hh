@@ -35,6 +35,12 @@ namespace grm
 {
 static const Json::Value NO_PATHS = Json::objectValue;
 
+/**
+ * Estimated cost of aligning reads to a graph
+ * @return number of reads times the total sequence length of the graph
+ */
+uint64_t alignmentCost(const graphtools::Graph* graph, std::vector<common::p_Read> const& reads);
+
 /**
  * Wrapper / helper to produce read alignments
  * @param graph graph to align to
@@ -45,9 +51,12 @@ static const Json::Value NO_PATHS = Json::objectValue;
  * @param kmer_sequence_matching enable kmer sequence matching
  * @param validate_alignments enable validation using read ids
  * @param threads number of threads to use for parallel execution
+ * @param min_split_cost reads are split into one chunk per thread. Graphs with at least this alignmentCost are
+ *                       split into more chunks, which idle threads help to align. Aligned reads keep their input
+ *                       order.
  */
 void alignReads(
     const graphtools::Graph* graph, std::list<graphtools::Path> const& paths, std::vector<common::p_Read>& reads,
     ReadFilter const& filter, bool path_sequence_matching, bool graph_sequence_matching, bool klib_sequence_matching,
-    bool kmer_sequence_matching, bool validate_alignments, uint32_t threads = 1);
+    bool kmer_sequence_matching, bool validate_alignments, uint32_t threads = 1, uint64_t min_split_cost = 0);
 }
@@ -70,6 +70,10 @@ public:
     static const unsigned int AF_REVERSE_GRAPH = 0x04;
     static const unsigned int AF_ALL = (unsigned int)-1;
 
+    /** Default alignment scores */
+    static const int8_t DEFAULT_MATCH = 1;
+    static const int8_t DEFAULT_MISMATCH = 4;
+
     /**
      * Align a read to the graph and update the graph_* fields.
      *
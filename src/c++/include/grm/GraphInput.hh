@@ -36,6 +36,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "common/Region.hh"
 #include "json/json.h"
 
 namespace grm
@@ -55,4 +56,15 @@ graphtools::Graph graphFromJson(Json::Value const& in, std::string const& refere
  * @param in_paths Input JSON node with paths
  */
 std::list<graphtools::Path> pathsFromJson(graphtools::Graph const* graph, Json::Value const& in_paths);
+
+/**
+ * Find the breakpoints of a graph from its reference-backed nodes and return windows around them
+ * @param in Input JSON graph description
+ * @param target_regions windows are restricted to these regions
+ * @param flank window size on each side of a breakpoint
+ * @param merge_distance windows which are closer than this are merged
+ * @return windows sorted by position, target_regions if there are no breakpoints within them
+ */
+std::list<common::Region> breakpointWindowsFromJson(
+    Json::Value const& in, std::list<common::Region> const& target_regions, int64_t flank, int64_t merge_distance);
 };
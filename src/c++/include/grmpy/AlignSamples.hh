@@ -27,13 +27,80 @@
 
 #pragma once
 
+#include "common/AlignmentContainer.hh"
+#include "common/MemoryBudget.hh"
 #include "common/ReadExtraction.hh"
+#include "common/UnmappedReadIndex.hh"
 #include "grmpy/Parameters.hh"
+#include "paragraph/Parameters.hh"
 
 namespace grmpy
 {
 
+/**
+ * Key of a graph in alignment containers: the graph ID, model name or target regions
+ */
+std::string alignmentContainerKey(const paragraph::Parameters& paragraphParameters);
+
+/**
+ * @return path of the alignment container for a sample in the alignment output folder
+ */
+std::string alignmentContainerPath(const Parameters& parameters, genotyping::SampleInfo const& sample);
+
+/**
+ * Set up paragraph parameters for aligning samples to a graph
+ */
+paragraph::Parameters
+loadParagraphParameters(const Parameters& parameters, const std::string& graphPath, const std::string& referencePath);
+
+/**
+ * Reserve the estimated footprint of the reads for a graph and sample on a memory budget
+ * @return reservation, null if the budget is missing or unlimited
+ */
+std::unique_ptr<common::MemoryReservation> reserveSampleMemory(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters, common::BamReader& reader,
+    genotyping::SampleInfo const& sample, common::MemoryBudget* memoryBudget);
+
+/**
+ * @return reads per base of target region above which the reads of a sample are subsampled, 0 if the read limit
+ *         is not derived from the depth of the sample
+ */
+double maxReadDensity(const Parameters& parameters, genotyping::SampleInfo const& sample);
+
+/**
+ * Align reads extracted for a graph and store the result in sample
+ */
+void alignExtractedReads(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters, const std::string& referencePath,
+    common::ReadBuffer& reads, genotyping::SampleInfo& sample,
+    common::AlignmentContainerWriter* alignmentContainer = nullptr);
+
+/**
+ * Use alignments stored in a container instead of aligning
+ * @return false if the container has no record for key
+ */
+bool loadContainerAlignments(
+    common::AlignmentContainerReader& alignmentContainer, const std::string& key, genotyping::SampleInfo& sample);
+
 void alignSingleSample(
     const Parameters& parameters, const std::string& graphPath, const std::string& referencePath,
-    common::BamReader& reader, genotyping::SampleInfo& sample);
+    common::BamReader& reader, genotyping::SampleInfo& sample, common::MemoryBudget* memoryBudget = nullptr,
+    common::AlignmentContainerWriter* alignmentContainer = nullptr);
+
+/**
+ * Add reads of the sample's unmapped read index which share k-mers with the insertion nodes of the graph
+ */
+void recruitUnmappedReads(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters,
+    const common::UnmappedReadIndex& unmappedIndex, common::ReadBuffer& reads);
+
+/**
+ * Same as above, for a graph whose paragraph parameters have been loaded already
+ * @param unmappedIndex if not null, recruit reads from this index in addition to the target regions
+ */
+void alignSingleSample(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters, const std::string& referencePath,
+    common::BamReader& reader, genotyping::SampleInfo& sample, common::MemoryBudget* memoryBudget = nullptr,
+    common::AlignmentContainerWriter* alignmentContainer = nullptr,
+    const common::UnmappedReadIndex* unmappedIndex = nullptr);
 }
@@ -39,5 +39,5 @@ namespace grmpy
  */
 Json::Value countAndGenotype(
     const std::string& graphPath, const std::string& referencePath, const std::string& genotypingParameterPath,
-    const genotyping::Samples& samples);
+    const genotyping::Samples& samples, unsigned int threads = 1);
 }
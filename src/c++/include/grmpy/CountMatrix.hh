@@ -0,0 +1,106 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Sample x edge read count matrices for genotyping without alignment data
+ *
+ * \file CountMatrix.hh
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "genotyping/SampleInfo.hh"
+#include "json/json.h"
+
+namespace grmpy
+{
+
+/**
+ * Edge read counts of all samples for one graph, together with the sample statistics the genotyper uses.
+ * This is all that is needed to genotype the graph again with different parameters.
+ *
+ * Matrices are stored as tab-separated text, one block per graph:
+ *
+ *   #graph    <graph path>
+ *   #columns  sample  depth  depth_sd  read_length  sex  <edge 1>  <edge 2> ...
+ *   <sample>  <depth> <depth sd> <read length> <sex> <count 1> <count 2> ...
+ *
+ * Tabs, line breaks and backslashes in graph paths, edge and sample names are written as \t, \n, \r and \\,
+ * and a leading '#' as \#.
+ */
+struct CountMatrix
+{
+    std::string graph_path;
+    std::vector<std::string> edge_names;
+    // names, depths, read lengths and sexes of the samples
+    genotyping::Samples samples;
+    // [samples][edges]
+    std::vector<int32_t> counts;
+};
+
+/**
+ * Collect edge counts from aligned samples
+ * @param graph_path path of the graph JSON
+ * @param samples samples with alignment data for the graph
+ */
+CountMatrix makeCountMatrix(std::string const& graph_path, genotyping::Samples const& samples);
+
+/**
+ * Write a count matrix block
+ */
+void writeCountMatrix(std::ostream& output, CountMatrix const& matrix);
+
+/**
+ * Read the next count matrix block
+ * @return false if there are no more blocks
+ */
+bool readCountMatrix(std::istream& input, CountMatrix& matrix);
+
+/**
+ * Genotype a graph from its count matrix
+ * @param matrix edge counts and sample statistics
+ * @param referencePath path to FASTA reference for the graph
+ * @param genotypingParameterPath path to genotyper settings
+ * @param threads number of threads for genotyping breakpoints and samples
+ * @return genotypes in the same format as countAndGenotype
+ */
+Json::Value genotypeCountMatrix(
+    CountMatrix const& matrix, std::string const& referencePath, std::string const& genotypingParameterPath,
+    unsigned int threads);
+
+/**
+ * Genotype all graphs in a count matrix file
+ * @param countMatrixPath input file, may be gzipped
+ * @param referencePath path to FASTA reference for the graphs
+ * @param genotypingParameterPath path to genotyper settings
+ * @param outputFilePath output file for all genotypes, '-' for stdout, empty to not write one
+ * @param outputFolderPath output folder for one genotype file per graph, empty to not write these
+ * @param gzipOutput compress output files
+ * @param threads number of threads for genotyping breakpoints and samples
+ */
+void genotypeCountMatrices(
+    std::string const& countMatrixPath, std::string const& referencePath, std::string const& genotypingParameterPath,
+    std::string const& outputFilePath, std::string const& outputFolderPath, bool gzipOutput, unsigned int threads);
+}
@@ -59,6 +59,51 @@ public:
     std::string const& alignment_output_folder() const { return alignment_output_folder_; }
     bool infer_read_haplotypes() const { return infer_read_haplotypes_; }
 
+    size_t max_memory() const { return max_memory_; }
+    void set_max_memory(size_t max_memory) { max_memory_ = max_memory; }
+
+    bool alignment_container() const { return alignment_container_; }
+    void set_alignment_container(bool alignment_container) { alignment_container_ = alignment_container; }
+
+    unsigned prefetch_graphs() const { return prefetch_graphs_; }
+    void set_prefetch_graphs(unsigned prefetch_graphs) { prefetch_graphs_ = prefetch_graphs; }
+
+    std::string const& cache_dir() const { return cache_dir_; }
+    void set_cache_dir(std::string const& cache_dir) { cache_dir_ = cache_dir; }
+
+    bool sample_major() const { return sample_major_; }
+    void set_sample_major(bool sample_major) { sample_major_ = sample_major; }
+
+    size_t read_cache_size() const { return read_cache_size_; }
+    void set_read_cache_size(size_t read_cache_size) { read_cache_size_ = read_cache_size; }
+
+    uint64_t min_split_cost() const { return min_split_cost_; }
+    void set_min_split_cost(uint64_t min_split_cost) { min_split_cost_ = min_split_cost; }
+
+    bool deduplicate_graphs() const { return deduplicate_graphs_; }
+    void set_deduplicate_graphs(bool deduplicate_graphs) { deduplicate_graphs_ = deduplicate_graphs; }
+
+    bool reference_prescreen() const { return reference_prescreen_; }
+    void set_reference_prescreen(bool reference_prescreen) { reference_prescreen_ = reference_prescreen; }
+
+    int read_triage() const { return read_triage_; }
+    void set_read_triage(int read_triage) { read_triage_ = read_triage; }
+
+    std::string const& unmapped_index_dir() const { return unmapped_index_dir_; }
+    void set_unmapped_index_dir(std::string const& unmapped_index_dir) { unmapped_index_dir_ = unmapped_index_dir; }
+
+    int unmapped_index_mapq() const { return unmapped_index_mapq_; }
+    void set_unmapped_index_mapq(int unmapped_index_mapq) { unmapped_index_mapq_ = unmapped_index_mapq; }
+
+    int breakpoint_window() const { return breakpoint_window_; }
+    void set_breakpoint_window(int breakpoint_window) { breakpoint_window_ = breakpoint_window; }
+
+    double max_reads_depth_factor() const { return max_reads_depth_factor_; }
+    void set_max_reads_depth_factor(double max_reads_depth_factor) { max_reads_depth_factor_ = max_reads_depth_factor; }
+
+    std::string const& count_matrix_output() const { return count_matrix_output_; }
+    void set_count_matrix_output(std::string const& count_matrix_output) { count_matrix_output_ = count_matrix_output; }
+
 private:
     int threads_ = 1;
     int max_reads_ = 10000;
@@ -70,5 +115,20 @@ private:
     int bad_align_uniq_kmer_len_ = 0;
     std::string alignment_output_folder_;
     bool infer_read_haplotypes_ = false;
+    bool alignment_container_ = false;
+    size_t max_memory_ = 0;
+    unsigned prefetch_graphs_ = 0;
+    std::string cache_dir_;
+    bool sample_major_ = false;
+    size_t read_cache_size_ = 0;
+    uint64_t min_split_cost_ = 10000000;
+    bool deduplicate_graphs_ = false;
+    bool reference_prescreen_ = false;
+    int read_triage_ = 0;
+    std::string unmapped_index_dir_;
+    int unmapped_index_mapq_ = 1;
+    int breakpoint_window_ = 0;
+    double max_reads_depth_factor_ = 0.0;
+    std::string count_matrix_output_;
 };
 }
@@ -28,10 +28,17 @@
 
 #pragma once
 
+#include <deque>
 #include <mutex>
 
+#include "common/AlignmentContainer.hh"
+#include "common/MemoryBudget.hh"
+#include "common/Prefetcher.hh"
 #include "common/ReadExtraction.hh"
+#include "common/ResultCache.hh"
+#include "common/UnmappedReadIndex.hh"
 #include "grmpy/Parameters.hh"
+#include "paragraph/Parameters.hh"
 
 namespace grmpy
 {
@@ -62,6 +69,33 @@ class Workflow
     // [graphs][samples]
     std::vector<genotyping::Samples> alignedSamples_;
 
+    // [samples], null unless the sample has an alignment container / we write alignment containers
+    std::vector<std::unique_ptr<common::AlignmentContainerReader>> alignmentContainerReaders_;
+    std::vector<std::unique_ptr<common::AlignmentContainerWriter>> alignmentContainerWriters_;
+
+    // limits the reads held by graphs aligned in parallel
+    common::MemoryBudget memoryBudget_;
+
+    // alignments of samples to graphs from earlier runs
+    common::ResultCache resultCache_;
+
+    // graph indices sorted by the position of their first target region
+    std::vector<std::size_t> graphOrder_;
+    // next sample to be claimed by a thread in the sample-major schedule
+    std::size_t unclaimedSample_ = 0;
+
+    // graph index -> index of the first graph with the same graph fingerprint. Empty unless deduplicating.
+    std::vector<std::size_t> representatives_;
+    // graph index -> graph description to relabel copied alignments. Null unless the graph has duplicates or is one.
+    std::vector<Json::Value> duplicateDescriptions_;
+
+    // [samples] samples stored as read groups of the same files are aligned together with the first of them,
+    // which lists all of them here. Empty for other samples.
+    std::vector<std::vector<std::size_t>> readGroupSamples_;
+
+    // [samples] null unless unmapped read indexes are used. Samples stored as read groups don't have one.
+    std::vector<std::unique_ptr<const common::UnmappedReadIndex>> unmappedIndexes_;
+
     mutable std::mutex mutex_;
     bool terminate_ = false;
 
@@ -69,9 +103,56 @@ class Workflow
 
     bool progress_ = true;
 
+    /**
+     * Reads extracted for one sample and graph by the prefetch thread, waiting to be aligned
+     */
+    struct ExtractedGraph
+    {
+        ExtractedGraph() = default;
+        ExtractedGraph(ExtractedGraph&&) = default;
+        ExtractedGraph& operator=(ExtractedGraph&&) = default;
+
+        std::size_t sampleIndex_ = 0;
+        std::size_t graphIndex_ = 0;
+        paragraph::Parameters paragraphParameters_;
+        common::ReadBuffer reads_;
+        // shared by all samples of a read group set, whose reads are extracted together
+        std::shared_ptr<common::MemoryReservation> reservation_;
+        std::string cacheKey_;
+    };
+    // state of the prefetch thread
+    std::size_t prefetchSample_ = 0;
+    std::unique_ptr<common::BamReader> prefetchReader_;
+    // reads of the other samples in a read group set, extracted in the same pass
+    std::deque<ExtractedGraph> prefetchPending_;
+
+    void openReader(std::size_t sampleIndex, std::unique_ptr<common::BamReader>& reader) const;
+    void extractReadGroupSamples(
+        std::size_t sampleIndex, std::size_t graphIndex, const paragraph::Parameters& paragraphParameters,
+        std::unique_ptr<common::BamReader>& reader, std::vector<ExtractedGraph>& extracted);
+
+    std::string
+    alignmentCacheKey(const paragraph::Parameters& paragraphParameters, genotyping::SampleInfo const& sample) const;
+    bool loadCachedAlignments(const std::string& cacheKey, genotyping::SampleInfo& sample) const;
+    void storeCachedAlignments(const std::string& cacheKey, genotyping::SampleInfo const& sample) const;
+    bool loadStoredAlignments(
+        std::size_t sampleIndex, const paragraph::Parameters& paragraphParameters, genotyping::SampleInfo& sample);
+    bool prefetchGraph(ExtractedGraph& extractedGraph);
+    void alignPrefetchedGraphs(common::Prefetcher<ExtractedGraph>& prefetcher);
     void genotypeGraphs(
-        std::ostream& outputFileStream, std::vector<genotyping::Samples>::const_iterator& ungenotypedSamples);
+        std::ostream& outputFileStream, std::ostream* countMatrixStream,
+        std::vector<genotyping::Samples>::const_iterator& ungenotypedSamples);
+    void alignGraph(std::size_t sampleIndex, std::size_t graphIndex, std::unique_ptr<common::BamReader>& reader);
     void alignSamples();
+    void orderGraphsByLocus();
+    void findDuplicateGraphs();
+    void openUnmappedIndexes();
+    bool isDuplicate(std::size_t graphIndex) const
+    {
+        return !representatives_.empty() && representatives_[graphIndex] != graphIndex;
+    }
+    void copyDuplicateAlignments();
+    void alignSamplesByLocus();
     void makeOutputFile(const Json::Value& output, const std::string& graphSpecPath) const;
 
 public:
@@ -51,6 +51,12 @@ public:
     int threads() const { return threads_; }
     void set_threads(int threads) { threads_ = threads; }
 
+    /**
+     * Also estimate depth and read length for each read group in the BAM header
+     */
+    bool per_read_group() const { return per_read_group_; }
+    void set_per_read_group(bool per_read_group) { per_read_group_ = per_read_group; }
+
 private:
     std::string bam_path_;
     std::string bam_index_path_;
@@ -60,5 +66,6 @@ private:
     std::string autosome_regex_;
     std::string sex_chromosome_regex_;
     int threads_;
+    bool per_read_group_ = false;
 };
 };
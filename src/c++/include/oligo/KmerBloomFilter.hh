@@ -0,0 +1,95 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Bloom filter for encoded kmers
+ *
+ * \file KmerBloomFilter.hh
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace oligo
+{
+
+/**
+ ** \brief Set of kmers encoded by the KmerGenerator which may report false positives, but never false negatives.
+ **
+ ** \param T the type of the kmer
+ **/
+template <class T> class KmerBloomFilter
+{
+public:
+    /**
+     ** \param expected_kmers number of kmers which will be inserted
+     ** \param bits_per_kmer filter size per kmer. The default with 7 hashes gives about 1% false positives.
+     ** \param hash_count number of bits set per kmer
+     **/
+    explicit KmerBloomFilter(size_t expected_kmers, unsigned bits_per_kmer = 10, unsigned hash_count = 7)
+        : num_bits_(std::max<uint64_t>(64, expected_kmers * bits_per_kmer))
+        , hash_count_(hash_count)
+        , bits_((num_bits_ + 63) / 64, 0)
+    {
+    }
+
+    void insert(T kmer)
+    {
+        const uint64_t first = mix(static_cast<uint64_t>(kmer));
+        const uint64_t second = mix(first) | 1;
+        for (unsigned hash = 0; hash != hash_count_; ++hash)
+        {
+            const uint64_t bit = (first + hash * second) % num_bits_;
+            bits_[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    bool mayContain(T kmer) const
+    {
+        const uint64_t first = mix(static_cast<uint64_t>(kmer));
+        const uint64_t second = mix(first) | 1;
+        for (unsigned hash = 0; hash != hash_count_; ++hash)
+        {
+            const uint64_t bit = (first + hash * second) % num_bits_;
+            if ((bits_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    /// splitmix64 finalizer, spreads the 2-bit base encoding over all bits
+    static uint64_t mix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    uint64_t num_bits_;
+    unsigned hash_count_;
+    std::vector<uint64_t> bits_;
+};
+}
@@ -48,6 +48,17 @@ namespace paragraph
  */
 Json::Value alignAndDisambiguate(const Parameters& parameters, common::ReadBuffer& all_reads);
 
+/**
+ * Reuse the result of alignAndDisambiguate for a graph with the same Parameters::graphFingerprint
+ *
+ * @param result output of alignAndDisambiguate
+ * @param result_description description of the graph result was computed for
+ * @param description description of the graph to relabel the result for
+ * @return result with the ID, model name and other annotations taken from description
+ */
+Json::Value
+relabelResult(Json::Value const& result, Json::Value const& result_description, Json::Value const& description);
+
 /**
  * Node and edge filters / return True to indicate a node or edge is supported by a read
  */
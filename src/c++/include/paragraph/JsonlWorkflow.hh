@@ -0,0 +1,96 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Streaming workflow for graphs given one per line
+ *
+ * \file JsonlWorkflow.hh
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/BamReader.hh"
+#include "common/MemoryBudget.hh"
+#include "paragraph/Parameters.hh"
+
+namespace paragraph
+{
+
+/**
+ * Processes a JSONL file of graphs. Each line is a graph description or the path of a graph JSON file
+ * as in server mode. Lines are read as threads become free and the output for each graph is written as
+ * one JSON line in input order, so only a few graphs per thread are held in memory at any time.
+ */
+class JsonlWorkflow
+{
+    typedef std::vector<std::string> InputPaths;
+
+public:
+    /**
+     * @param graphJsonlPath input file, '-' for stdin. Files ending in .gz are decompressed.
+     * @param outputFilePath output file, '-' for stdout
+     */
+    JsonlWorkflow(
+        const InputPaths& inputPaths, const InputPaths& inputIndexPaths, const std::string& graphJsonlPath,
+        const std::string& outputFilePath, bool gzipOutput, const Parameters& parameters,
+        const std::string& referencePath, const std::string& targetRegions);
+
+    void run();
+
+    /**
+     * Process all graphs of a stream, see run
+     */
+    void processStream(std::istream& input, std::ostream& output);
+
+private:
+    void processGraphs(std::istream& input, std::ostream& output);
+
+    const InputPaths inputPaths_;
+    const InputPaths inputIndexPaths_;
+    const std::string graphJsonlPath_;
+    const std::string outputFilePath_;
+    const bool gzipOutput_;
+    const Parameters parameters_;
+    const std::string referencePath_;
+    const std::string targetRegions_;
+
+    // limits the reads held by graphs processed in parallel
+    common::MemoryBudget memoryBudget_;
+    const std::size_t readLength_;
+
+    std::mutex mutex_;
+    std::condition_variable outputWritten_;
+    bool terminate_ = false;
+    // number of graphs read from the input
+    std::size_t linesRead_ = 0;
+    // number of outputs written
+    std::size_t linesWritten_ = 0;
+    // line number -> output of graphs finished before the graphs on earlier lines
+    std::map<std::size_t, std::string> pendingOutputs_;
+};
+}
@@ -75,10 +75,24 @@ public:
         ALL = 0xffffffff
     };
 
+    /// reads which only support a reference flank are placed on the reference path without graph alignment
+    enum read_triage_mode
+    {
+        NO_TRIAGE = 0,
+        TRIAGE_EXACT = 1, ///< reads which match the flank exactly
+        TRIAGE_MISMATCHES = 2 ///< reads with up to 5% mismatches
+    };
+
     void load(
         const std::string& graph_path, const std::string& reference_path,
         const std::string& override_target_regions = "");
 
+    /**
+     * Same as load, for a graph description which has been parsed already
+     */
+    void loadDescription(
+        Json::Value root, const std::string& reference_path, const std::string& override_target_regions = "");
+
     const std::string& reference_path() const { return reference_path_; }
 
     size_t max_reads() const { return max_reads_; }
@@ -101,6 +115,10 @@ public:
     bool kmer_sequence_matching() const { return kmer_sequence_matching_; }
     bool validate_alignments() const { return validate_alignments_; }
     unsigned longest_alt_insertion() const { return longest_alt_insertion_; }
+    /// true if missing mates must be recovered whatever the insertion length, see breakpoint windows
+    bool recover_mates() const { return recover_mates_; }
+    /// sequences of the non-reference nodes
+    std::vector<std::string> const& alt_sequences() const { return alt_sequences_; }
 
     uint32_t threads() const { return threads_; }
     void set_threads(uint32_t threads) { threads_ = threads; }
@@ -111,7 +129,61 @@ public:
     bool remove_nonuniq_reads() const { return remove_nonuniq_reads_; }
     void set_remove_nonuniq_reads(bool remove_nonuniq_reads) { remove_nonuniq_reads_ = remove_nonuniq_reads; }
 
+    size_t max_memory() const { return max_memory_; }
+    void set_max_memory(size_t max_memory) { max_memory_ = max_memory; }
+
+    uint32_t prefetch_graphs() const { return prefetch_graphs_; }
+    void set_prefetch_graphs(uint32_t prefetch_graphs) { prefetch_graphs_ = prefetch_graphs; }
+
+    std::string const& cache_dir() const { return cache_dir_; }
+    void set_cache_dir(std::string const& cache_dir) { cache_dir_ = cache_dir; }
+
+    size_t read_cache_size() const { return read_cache_size_; }
+    void set_read_cache_size(size_t read_cache_size) { read_cache_size_ = read_cache_size; }
+
+    uint64_t min_split_cost() const { return min_split_cost_; }
+    void set_min_split_cost(uint64_t min_split_cost) { min_split_cost_ = min_split_cost; }
+
+    bool deduplicate_graphs() const { return deduplicate_graphs_; }
+    void set_deduplicate_graphs(bool deduplicate_graphs) { deduplicate_graphs_ = deduplicate_graphs; }
+
+    bool sweep_bam() const { return sweep_bam_; }
+    void set_sweep_bam(bool sweep_bam) { sweep_bam_ = sweep_bam; }
+
+    bool reference_prescreen() const { return reference_prescreen_; }
+    void set_reference_prescreen(bool reference_prescreen) { reference_prescreen_ = reference_prescreen; }
+
+    int read_triage() const { return read_triage_; }
+    void set_read_triage(int read_triage) { read_triage_ = read_triage; }
+
+    std::string const& unmapped_index_dir() const { return unmapped_index_dir_; }
+    void set_unmapped_index_dir(std::string const& unmapped_index_dir) { unmapped_index_dir_ = unmapped_index_dir; }
+
+    int unmapped_index_mapq() const { return unmapped_index_mapq_; }
+    void set_unmapped_index_mapq(int unmapped_index_mapq) { unmapped_index_mapq_ = unmapped_index_mapq; }
+
+    int breakpoint_window() const { return breakpoint_window_; }
+    void set_breakpoint_window(int breakpoint_window) { breakpoint_window_ = breakpoint_window; }
+
+    /**
+     * @return serialized graph description, target regions and all settings that change
+     *         alignment results. Used to key cached results.
+     */
+    std::string fingerprint() const;
+
+    /**
+     * @return serialized graph structure (nodes, edges, paths), target regions and alignment
+     *         settings. Graphs with the same graph fingerprint give the same alignment results
+     *         and only differ in their annotations, e.g. the graph ID.
+     */
+    std::string graphFingerprint() const;
+
 private:
+    /**
+     * @return target regions and all settings that change alignment results, shared by the fingerprints
+     */
+    Json::Value alignmentSettings() const;
+
     std::string reference_path_;
 
     size_t max_reads_; ///< maximum number of reads to process per locus
@@ -131,6 +203,9 @@ private:
     Json::Value description_; ///< graph description
     /// if graph contains long insertions, we might want to read mates that are not in the target region.
     unsigned longest_alt_insertion_ = 0;
+    /// reads between breakpoint windows are not extracted, so their mates are recovered
+    bool recover_mates_ = false;
+    std::vector<std::string> alt_sequences_;
 
     std::list<common::Region> target_regions_; ///< target regions for read retrieval
 
@@ -139,5 +214,32 @@ private:
     int kmer_len_{ 0 }; ///< kmer length for validation
 
     bool remove_nonuniq_reads_{ true }; // remove reads with no unique alignment
+
+    size_t max_memory_{ 0 }; ///< memory budget in bytes for reads of graphs processed in parallel, 0 = unlimited
+
+    uint32_t prefetch_graphs_{ 0 }; ///< number of graphs to extract reads for ahead of alignment, 0 = no prefetching
+
+    std::string cache_dir_; ///< directory for cached results, empty = no caching
+
+    size_t read_cache_size_{ 0 }; ///< number of decoded reads each BAM reader keeps for overlapping regions
+
+    /// alignment cost (reads x graph sequence length) above which the reads of a graph are aligned on several threads
+    uint64_t min_split_cost_{ 10000000 };
+
+    bool deduplicate_graphs_{ false }; ///< align graphs with the same graphFingerprint only once
+
+    bool sweep_bam_{ false }; ///< extract reads for all graphs with one sequential pass over each BAM
+
+    /// skip graph alignment when no read has an alt-specific k-mer
+    bool reference_prescreen_{ false };
+
+    int read_triage_{ NO_TRIAGE }; ///< read_triage_mode
+
+    /// directory for indexes of unmapped and low-MAPQ reads to recruit insertion reads from, empty = don't recruit
+    std::string unmapped_index_dir_;
+    int unmapped_index_mapq_{ 1 }; ///< mapped reads with a lower MAPQ are indexed with the unmapped reads
+
+    /// reads are only extracted within this distance of the breakpoints of the graph, 0 = whole target regions
+    int breakpoint_window_{ 0 };
 };
 }
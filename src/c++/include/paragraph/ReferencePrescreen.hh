@@ -0,0 +1,96 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Prescreen reads for alt-specific k-mers to skip graph alignment at reference-only loci
+ *
+ * \file ReferencePrescreen.hh
+ *
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "common/Read.hh"
+#include "graphcore/Graph.hh"
+#include "json/json.h"
+
+namespace paragraph
+{
+
+/**
+ * Most loci are homozygous reference in any given sample. The prescreen hashes the k-mers which occur only
+ * on non-reference paths or breakpoint junctions of a graph. When no read carries one of them, reads are
+ * placed on the reference path using their linear alignment instead of aligning them to the graph.
+ * Reads which fall within a reference flank can also be triaged one by one.
+ */
+class ReferencePrescreen
+{
+public:
+    /**
+     * @param graph graph to screen reads for
+     * @param description graph description; its path with sequence "REF" must follow the linear reference
+     */
+    ReferencePrescreen(graphtools::Graph const* graph, Json::Value const& description);
+    ~ReferencePrescreen();
+
+    ReferencePrescreen(ReferencePrescreen const&) = delete;
+    ReferencePrescreen& operator=(ReferencePrescreen const&) = delete;
+
+    /**
+     * @return false if the graph has no reference path along the linear reference
+     */
+    bool enabled() const;
+
+    /**
+     * @return true if the read has a k-mer which occurs only on non-reference paths of the graph
+     */
+    bool hasAltKmer(common::Read const& read) const;
+
+    /**
+     * Reads without informative k-mers, i.e. k-mers which span an edge or lie on a non-reference node, can
+     * only support a single reference node. Uses a Bloom filter, so some reads are reported as informative
+     * when they are not.
+     * @return true if the read may have an informative k-mer
+     */
+    bool hasInformativeKmer(common::Read const& read) const;
+
+    /**
+     * Set the graph alignment of a read to its linear alignment on the reference path. Reads which overhang
+     * the path, have a BAM CIGAR other than a single match operation, too many mismatches, or no k-mer that
+     * places them uniquely in the graph are left unaligned. Like the graph aligner, mismatching read ends are
+     * soft-clipped and the alignment is scored with its match and mismatch scores.
+     * @param max_mismatch_fraction maximum fraction of mismatching bases
+     * @return true if the read was placed on the reference path
+     */
+    bool alignToReference(common::Read& read, double max_mismatch_fraction = 0.05) const;
+
+    /**
+     * Like alignToReference, but only for reads without informative k-mers whose linear alignment lies within
+     * a single reference node, which makes them reference flank support.
+     * @return true if the read was placed on the reference path
+     */
+    bool alignToFlank(common::Read& read, double max_mismatch_fraction) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+}
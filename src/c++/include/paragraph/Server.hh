@@ -0,0 +1,127 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Paragraph server mode: align graphs sent over a local Unix domain socket
+ *
+ * \file Server.hh
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "common/BamReader.hh"
+#include "common/Fasta.hh"
+#include "common/MemoryBudget.hh"
+#include "paragraph/Parameters.hh"
+
+namespace paragraph
+{
+
+/**
+ * Process a single graph given as a JSON line or the path of a graph JSON file
+ * @param request graph description or path to graph description
+ * @param defaultParameters parameters to load the graph description into
+ * @param inputPaths BAM / CRAM files of the readers, reported in the output
+ * @param readers BAM readers owned by the calling thread
+ * @param memoryBudget waits until the estimated read footprint of the graph fits
+ * @param readLength read length used for the footprint, see estimateInputReadLength
+ * @return single line JSON output
+ */
+std::string processGraphRequest(
+    const std::string& request, const Parameters& defaultParameters, const std::string& referencePath,
+    const std::string& targetRegions, const std::vector<std::string>& inputPaths,
+    std::vector<common::BamReader>& readers, common::MemoryBudget& memoryBudget, std::size_t readLength);
+
+/**
+ * @return average length of the first reads of the first input file, 0 if the memory budget is unlimited
+ */
+std::size_t estimateInputReadLength(
+    const std::vector<std::string>& inputPaths, const std::vector<std::string>& inputIndexPaths,
+    const std::string& referencePath, const common::MemoryBudget& memoryBudget);
+
+/**
+ * Keeps the reference, BAM readers and parameters loaded and answers alignment
+ * requests on a Unix domain socket.
+ *
+ * The protocol is line based. Each request line is either a graph description
+ * (a JSON object in the same format as the -g input) or the path of a graph
+ * JSON file. The server answers each request with one line holding the same
+ * JSON paragraph would write for the graph, or {"error": "..."} if the request
+ * failed. An empty line is ignored, "shutdown" stops the server.
+ *
+ * Each worker thread serves one connection at a time, so up to threads
+ * connections are processed concurrently. The socket is only accessible to
+ * the user running the server.
+ */
+class Server
+{
+    typedef std::vector<std::string> InputPaths;
+
+public:
+    Server(
+        const std::string& socketPath, const InputPaths& inputPaths, const InputPaths& inputIndexPaths,
+        const Parameters& parameters, const std::string& referencePath, const std::string& targetRegions);
+    ~Server();
+
+    Server(Server const&) = delete;
+    Server& operator=(Server const&) = delete;
+
+    /**
+     * Accept and process connections until a shutdown request is received or stop() is called
+     */
+    void run();
+
+    /**
+     * Stop accepting connections. Requests in progress are completed.
+     */
+    void stop();
+
+    /**
+     * Process a single request line
+     * @param request graph description or path to graph description
+     * @param readers BAM readers owned by the calling thread
+     * @return single line JSON output
+     */
+    std::string processRequest(const std::string& request, std::vector<common::BamReader>& readers);
+
+private:
+    void serveConnections();
+    void serveConnection(int connection, std::vector<common::BamReader>& readers);
+
+    const std::string socketPath_;
+    const InputPaths inputPaths_;
+    const InputPaths inputIndexPaths_;
+    const Parameters parameters_;
+    const std::string referencePath_;
+    const std::string targetRegions_;
+
+    // keeps the reference mapped for the lifetime of the server
+    common::FastaFile reference_;
+    common::MemoryBudget memoryBudget_;
+    const std::size_t readLength_;
+
+    int listenSocket_ = -1;
+    std::atomic<bool> stopped_;
+};
+}
@@ -28,7 +28,16 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+
+#include "common/MemoryBudget.hh"
+#include "common/Prefetcher.hh"
 #include "common/ReadExtraction.hh"
+#include "common/ReadSweep.hh"
+#include "common/ResultCache.hh"
+#include "common/UnmappedReadIndex.hh"
 #include "paragraph/Parameters.hh"
 
 namespace paragraph
@@ -51,6 +60,10 @@ class Workflow
         const InputPaths inputPaths_;
         const InputPaths inputIndexPaths_;
         GraphSpecPaths::const_iterator unprocessedGraphs_;
+        // unmapped and low-MAPQ reads of the input, null unless recruiting them
+        std::shared_ptr<const common::UnmappedReadIndex> unmappedIndex_;
+        // average length of the first reads, only estimated when the memory budget is limited
+        std::size_t readLength_ = 0;
     };
     std::vector<Input> unprocessedInputs_;
     const GraphSpecPaths& graphSpecPaths_;
@@ -61,16 +74,113 @@ class Workflow
     const std::string& referencePath_;
     const std::string& targetRegions_;
 
+    // limits the reads held by graphs processed in parallel
+    common::MemoryBudget memoryBudget_;
+
+    // results of graphs processed by earlier runs
+    common::ResultCache resultCache_;
+
+    // graph index -> index of the first graph with the same graph fingerprint. Empty unless deduplicating.
+    std::vector<std::size_t> representatives_;
+    // graph index -> the later graphs with the same graph fingerprint
+    std::vector<std::vector<std::size_t>> duplicates_;
+    struct RepresentativeResult
+    {
+        Json::Value description;
+        std::string output;
+        std::size_t remainingDuplicates = 0;
+    };
+    // (input, graph index) -> result to copy to the duplicates of the graph, removed once all are copied
+    std::map<std::pair<const Input*, std::size_t>, RepresentativeResult> representativeResults_;
+
     mutable std::mutex mutex_;
     bool terminate_ = false;
+    // signalled when a representative result is kept or processing terminates
+    std::condition_variable representativeResultAdded_;
 
     bool firstPrinted_ = false;
 
+    /**
+     * Graph with reads extracted by the prefetch thread, waiting to be aligned
+     */
+    struct ExtractedGraph
+    {
+        const Input* input_ = nullptr;
+        std::size_t graphIndex_ = 0;
+        std::string graphSpecPath_;
+        Parameters parameters_;
+        common::ReadBuffer reads_;
+        std::unique_ptr<common::MemoryReservation> reservation_;
+        std::string cacheKey_;
+        bool cached_ = false;
+        // the result is copied from the representative of the graph
+        bool duplicate_ = false;
+        std::string output_;
+    };
+    // state of the prefetch thread
+    std::vector<Input>::iterator prefetchInput_;
+    std::vector<common::BamReader> prefetchReaders_;
+
+    /**
+     * Target regions of a graph for the sweep, and whether its result is cached for each input
+     */
+    struct SweepTarget
+    {
+        std::list<common::Region> targetRegions_;
+        int maxReads_ = 0;
+        unsigned longestAltInsertion_ = 0;
+        bool recoverMates_ = false;
+        std::vector<bool> cached_;
+    };
+    /**
+     * Reads of a graph collected from the sweeps of some of the BAM files of an input
+     */
+    struct SweptGraph
+    {
+        std::vector<common::ReadBuffer> reads_;
+        std::size_t sweepsDone_ = 0;
+    };
+    // state of the sweep, one per BAM file of the prefetch input
+    std::vector<SweepTarget> sweepTargets_;
+    std::vector<std::unique_ptr<common::ReadSweep>> sweeps_;
+    std::vector<bool> sweepsFinished_;
+    std::size_t nextSweep_ = 0;
+    // sweep target -> graph index
+    std::vector<std::size_t> sweepGraphs_;
+    std::unordered_map<std::size_t, SweptGraph> sweptGraphs_;
+    // graphs which don't need reads from the sweep: cached graphs and duplicates of graphs that were swept
+    std::deque<std::size_t> sweepReadyGraphs_;
+
+    std::string cacheKey(const Parameters& parameters, const InputPaths& inputPaths) const;
+    std::unique_ptr<common::MemoryReservation>
+    reserveMemory(const Parameters& parameters, const Input& input, std::vector<common::BamReader>& readers);
+    void extractGraphReads(
+        const Parameters& parameters, const Input& input, std::vector<common::BamReader>& readers,
+        common::ReadBuffer& allReads);
+    void openUnmappedIndexes();
+    void recruitUnmappedReads(const Input& input, const Parameters& parameters, common::ReadBuffer& allReads) const;
+    std::string alignGraph(const Parameters& parameters, const InputPaths& inputPaths, common::ReadBuffer& allReads);
     std::string processGraph(
-        const std::string& graphSpecPath, const Parameters& parameters, const InputPaths& inputPaths,
+        const std::string& graphSpecPath, const Parameters& parameters, const Input& input,
         std::vector<common::BamReader>& readers);
     void processGraphs(std::ostream& outputFileStream);
+    bool loadGraph(Input& input, std::size_t graphIndex, ExtractedGraph& extractedGraph);
+    bool prefetchGraph(ExtractedGraph& extractedGraph);
+    void planSweep();
+    void startSweep(const Input& input, std::size_t inputIndex);
+    bool sweepGraph(ExtractedGraph& extractedGraph);
+    void queueSweepDuplicates(std::size_t graphIndex);
+    void alignPrefetchedGraphs(common::Prefetcher<ExtractedGraph>& prefetcher, std::ostream& outputFileStream);
+    void findDuplicateGraphs();
+    bool isDuplicate(std::size_t graphIndex) const
+    {
+        return !representatives_.empty() && representatives_[graphIndex] != graphIndex;
+    }
+    void keepRepresentativeResult(
+        const Input& input, std::size_t graphIndex, const Parameters& parameters, const std::string& output);
+    std::string duplicateOutput(const Input& input, std::size_t graphIndex, const Parameters& parameters);
     void makeOutputFile(const std::string& output, const std::string& graphSpecPath);
+    void writeOutput(const std::string& output, std::ostream& outputFileStream);
 
 public:
     Workflow(
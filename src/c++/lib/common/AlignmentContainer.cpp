@@ -0,0 +1,129 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Alignment container implementation
+ *
+ * \file AlignmentContainer.cpp
+ *
+ */
+
+#include "common/AlignmentContainer.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "common/Error.hh"
+
+namespace common
+{
+
+AlignmentContainerWriter::AlignmentContainerWriter(std::string const& path)
+    : path_(path)
+{
+    file_ = bgzf_open(path_.c_str(), "w");
+    if (file_ == nullptr)
+    {
+        error("ERROR: Failed to open alignment container '%s': '%s'", path_.c_str(), std::strerror(errno));
+    }
+    index_.open(path_ + ".idx");
+    if (!index_)
+    {
+        error("ERROR: Failed to open alignment container index '%s.idx'", path_.c_str());
+    }
+}
+
+AlignmentContainerWriter::~AlignmentContainerWriter()
+{
+    if (file_ != nullptr && bgzf_close(file_) != 0)
+    {
+        LOG()->warn("Failed to close alignment container {}", path_);
+    }
+}
+
+void AlignmentContainerWriter::add(std::string const& key, std::string const& json)
+{
+    if (key.find_first_of("\t\n") != std::string::npos)
+    {
+        error("ERROR: Invalid alignment container key '%s'", key.c_str());
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t offset = bgzf_tell(file_);
+    if (bgzf_write(file_, json.data(), json.size()) < 0 || bgzf_write(file_, "\n", 1) < 0 || bgzf_flush(file_) < 0)
+    {
+        error("ERROR: Failed to write to alignment container '%s'", path_.c_str());
+    }
+    // records only become visible in the index once their data is on disk
+    index_ << key << '\t' << offset << '\t' << json.size() << std::endl;
+    if (!index_)
+    {
+        error("ERROR: Failed to write alignment container index '%s.idx'", path_.c_str());
+    }
+}
+
+AlignmentContainerReader::AlignmentContainerReader(std::string const& path)
+    : path_(path)
+{
+    std::ifstream index(path_ + ".idx");
+    if (!index)
+    {
+        error("ERROR: Failed to open alignment container index '%s.idx'", path_.c_str());
+    }
+    std::string key;
+    Record record{ 0, 0 };
+    while (std::getline(index, key, '\t') && index >> record.offset >> record.length)
+    {
+        index.ignore(1); // newline
+        // later records replace earlier ones for the same key
+        index_[key] = record;
+    }
+
+    file_ = bgzf_open(path_.c_str(), "r");
+    if (file_ == nullptr)
+    {
+        error("ERROR: Failed to open alignment container '%s': '%s'", path_.c_str(), std::strerror(errno));
+    }
+}
+
+AlignmentContainerReader::~AlignmentContainerReader()
+{
+    if (file_ != nullptr)
+    {
+        bgzf_close(file_);
+    }
+}
+
+bool AlignmentContainerReader::get(std::string const& key, std::string& json)
+{
+    const auto record = index_.find(key);
+    if (record == index_.end())
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    json.resize(record->second.length);
+    if (bgzf_seek(file_, record->second.offset, SEEK_SET) < 0
+        || bgzf_read(file_, &json[0], json.size()) != static_cast<ssize_t>(json.size()))
+    {
+        error("ERROR: Failed to read record '%s' from alignment container '%s'", key.c_str(), path_.c_str());
+    }
+    return true;
+}
+}
@@ -19,8 +19,16 @@
 
 #include "common/BamReader.hh"
 
+#include <algorithm>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/accumulators/accumulators.hpp>
@@ -34,6 +42,7 @@ extern "C" {
 
 #include "common/Error.hh"
 #include "common/Fasta.hh"
+#include "HtsHelpers.hh"
 #include "common/ReadPileup.hh"
 #include "common/StringUtil.hh"
 #include "spdlog/spdlog.h"
@@ -47,65 +56,6 @@ using std::vector;
 namespace common
 {
 
-static inline void decodeHtsBases(bam1_t* hts_align_ptr, string& bases)
-{
-    uint8_t* hts_seq_ptr = bam_get_seq(hts_align_ptr);
-    const int32_t read_len = hts_align_ptr->core.l_qseq;
-    bases.resize((unsigned long)read_len);
-
-    for (int32_t i = 0; i < read_len; ++i)
-    {
-        bases[i] = seq_nt16_str[bam_seqi(hts_seq_ptr, i)];
-    }
-}
-
-static inline void decodeHtsQuals(bam1_t* hts_align_ptr, string& quals)
-{
-    uint8_t* hts_quals_ptr = bam_get_qual(hts_align_ptr);
-    const int32_t read_len = hts_align_ptr->core.l_qseq;
-    quals.resize((unsigned long)read_len);
-
-    uint8_t* test_hts_quals_ptr = hts_quals_ptr;
-
-    for (int32_t i = 0; i < read_len; ++i)
-    {
-        quals[i] = static_cast<char>(33 + test_hts_quals_ptr[i]);
-    }
-}
-
-/**
- * Decode BAM alignment from HTSLib struct.
- *
- * @param hts_align_ptr a bam1_t * to initialize from.
- * Passed as void* to avoid dependency on htslib headers
- *
- * TODO we could make this a constructor
- */
-static inline void decodeHtsAlign(void* _hts_align_ptr, Read& read)
-{
-    auto* hts_align_ptr = (bam1_t*)_hts_align_ptr;
-    const string fragment_id = bam_get_qname(hts_align_ptr);
-    string bases, quals;
-    decodeHtsBases(hts_align_ptr, bases);
-    decodeHtsQuals(hts_align_ptr, quals);
-    read.set_fragment_id(fragment_id);
-    read.set_bases(bases);
-    read.set_quals(quals);
-
-    const auto& flag = hts_align_ptr->core.flag;
-    read.set_is_mapped((flag & BamReader::kIsMapped) == 0);
-    read.set_is_first_mate((flag & BamReader::kIsFirstMate) != 0);
-    read.set_is_mate_mapped((flag & BamReader::kIsMateMapped) == 0);
-    read.set_is_reverse_strand(bam_is_rev(hts_align_ptr));
-    read.set_is_mate_reverse_strand(bam_is_mrev(hts_align_ptr));
-
-    read.set_chrom_id(hts_align_ptr->core.tid);
-    read.set_pos(hts_align_ptr->core.pos);
-    read.set_mapq(hts_align_ptr->core.qual);
-    read.set_mate_chrom_id(hts_align_ptr->core.mtid);
-    read.set_mate_pos(hts_align_ptr->core.mpos);
-}
-
 struct BamReader::BamReaderImpl
 {
     BamReaderImpl() = default;
@@ -222,6 +172,39 @@ struct BamReader::BamReaderImpl
     bool at_file_end_ = false;
 
     std::unordered_map<std::string, int> header_contig_map;
+
+    // read cache, see enableReadCache
+    struct CachedRead
+    {
+        Read read;
+        int64_t end; ///< end of the reference span, exclusive
+    };
+    struct CachedMate
+    {
+        bool found;
+        Read mate;
+    };
+    size_t read_cache_capacity_ = 0;
+    // see enableReadGroups
+    bool decode_read_groups_ = false;
+    // all primary reads overlapping [window_beg_, window_end_) on window_tid_, in file order
+    int window_tid_ = -1;
+    int window_beg_ = 0;
+    int window_end_ = 0;
+    std::vector<CachedRead> window_reads_;
+    // region currently served from the window
+    bool serving_from_window_ = false;
+    int region_beg_ = 0;
+    int region_end_ = 0;
+    size_t next_window_read_ = 0;
+    std::unordered_map<std::string, CachedMate> mate_cache_;
+    std::deque<std::string> mate_cache_order_;
+
+    // readers of the files merged by this reader, empty for a single file
+    std::vector<std::unique_ptr<BamReader>> parts_;
+    // next read of each part in the current region
+    std::vector<Read> part_reads_;
+    std::vector<bool> part_has_read_;
 };
 
 BamReader::BamReader(const std::string& path, const std::string& index_path, const std::string& reference)
@@ -240,6 +223,59 @@ BamReader::BamReader(const std::string& path, const std::string& index_path, con
     _impl->open(_impl->file_path, _impl->reference_path);
 }
 
+BamReader::BamReader(
+    const std::vector<std::string>& paths, const std::vector<std::string>& index_paths, const std::string& reference)
+    : _impl(new BamReaderImpl())
+{
+    if (paths.empty())
+    {
+        error("ERROR: No alignment files to read from");
+    }
+    if (!index_paths.empty() && index_paths.size() != paths.size())
+    {
+        error("ERROR: %d index files given for %d alignment files", (int)index_paths.size(), (int)paths.size());
+    }
+    if (paths.size() == 1)
+    {
+        *this = BamReader(paths.front(), index_paths.empty() ? std::string() : index_paths.front(), reference);
+        return;
+    }
+
+    // loading the indexes takes a while for large files
+    _impl->parts_.resize(paths.size());
+    std::vector<std::exception_ptr> failures(paths.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i != paths.size(); ++i)
+    {
+        threads.emplace_back([this, &paths, &index_paths, &reference, &failures, i]() {
+            try
+            {
+                _impl->parts_[i].reset(
+                    new BamReader(paths[i], index_paths.empty() ? std::string() : index_paths[i], reference));
+            }
+            catch (...)
+            {
+                failures[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (const auto& failure : failures)
+    {
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
+    }
+    _impl->file_path = paths.front();
+    _impl->reference_path = reference;
+    _impl->part_reads_.resize(paths.size());
+    _impl->part_has_read_.assign(paths.size(), false);
+}
+
 BamReader::BamReader(BamReader&& rhs) noexcept
     : _impl(std::move(rhs._impl))
 {
@@ -253,9 +289,67 @@ BamReader& BamReader::operator=(BamReader&& rhs) noexcept
 
 BamReader::~BamReader() = default;
 
+void BamReader::enableReadCache(size_t max_reads)
+{
+    if (!_impl->parts_.empty())
+    {
+        for (auto& part : _impl->parts_)
+        {
+            part->enableReadCache(max_reads);
+        }
+        return;
+    }
+    if (max_reads > 0 && _impl->hts_file_ptr_->format.format != bam)
+    {
+        LOG()->debug("Read cache is only used for BAM input, not for {}", _impl->file_path);
+        return;
+    }
+    _impl->read_cache_capacity_ = max_reads;
+    _impl->window_tid_ = -1;
+    _impl->window_reads_.clear();
+    _impl->mate_cache_.clear();
+    _impl->mate_cache_order_.clear();
+}
+
+void BamReader::enableReadGroups()
+{
+    if (!_impl->parts_.empty())
+    {
+        for (auto& part : _impl->parts_)
+        {
+            part->enableReadGroups();
+        }
+        return;
+    }
+    if (_impl->decode_read_groups_)
+    {
+        return;
+    }
+    _impl->decode_read_groups_ = true;
+    // cached reads were decoded without their read group
+    _impl->window_tid_ = -1;
+    _impl->window_reads_.clear();
+    _impl->mate_cache_.clear();
+    _impl->mate_cache_order_.clear();
+}
+
 void BamReader::setRegion(const std::string& region_encoding)
 {
+    if (!_impl->parts_.empty())
+    {
+        for (size_t i = 0; i != _impl->parts_.size(); ++i)
+        {
+            _impl->parts_[i]->setRegion(region_encoding);
+            _impl->part_has_read_[i] = _impl->parts_[i]->getAlign(_impl->part_reads_[i]);
+        }
+        return;
+    }
     _impl->at_file_end_ = false;
+    _impl->serving_from_window_ = false;
+    if (_impl->read_cache_capacity_ > 0 && setCachedRegion(region_encoding))
+    {
+        return;
+    }
     if (_impl->hts_itr_ptr_ != nullptr)
     {
         hts_itr_destroy(_impl->hts_itr_ptr_);
@@ -267,8 +361,133 @@ void BamReader::setRegion(const std::string& region_encoding)
     }
 }
 
+/**
+ * Serve a region from the read window, reading the parts of it which are not cached yet.
+ * The region is parsed like sam_itr_querys does and reads are selected with the same
+ * overlap test as the htslib iterator, so the result doesn't change.
+ * @return false if the region must be read without the cache
+ */
+bool BamReader::setCachedRegion(const std::string& region_encoding)
+{
+    int beg = 0;
+    int end = 0;
+    const char* contig_end = hts_parse_reg(region_encoding.c_str(), &beg, &end);
+    if (contig_end == nullptr)
+    {
+        return false;
+    }
+    const std::string contig(region_encoding.c_str(), contig_end);
+    const int tid = bam_name2id(_impl->hts_bam_hdr_ptr_, contig.c_str());
+    if (tid < 0)
+    {
+        return false;
+    }
+
+    const bool overlaps_window = tid == _impl->window_tid_ && beg >= _impl->window_beg_ && beg <= _impl->window_end_;
+    if (!overlaps_window || end > _impl->window_end_)
+    {
+        bool complete = false;
+        if (overlaps_window)
+        {
+            // reads overlapping the extension which start before the window end are cached already
+            complete = cacheReads(tid, _impl->window_end_, end, _impl->window_end_);
+        }
+        else
+        {
+            _impl->window_reads_.clear();
+            complete = cacheReads(tid, beg, end, std::numeric_limits<int64_t>::min());
+        }
+        if (!complete)
+        {
+            LOG()->debug("More than {} reads in {}, not caching", _impl->read_cache_capacity_, region_encoding);
+            _impl->window_tid_ = -1;
+            _impl->window_reads_.clear();
+            return false;
+        }
+        _impl->window_reads_.erase(
+            std::remove_if(
+                _impl->window_reads_.begin(), _impl->window_reads_.end(),
+                [beg](BamReaderImpl::CachedRead const& cached) { return cached.end <= beg; }),
+            _impl->window_reads_.end());
+        _impl->window_tid_ = tid;
+        _impl->window_beg_ = beg;
+        _impl->window_end_ = end;
+    }
+
+    _impl->serving_from_window_ = true;
+    _impl->region_beg_ = beg;
+    _impl->region_end_ = end;
+    _impl->next_window_read_ = 0;
+    return true;
+}
+
+/**
+ * Append primary reads overlapping [beg, end) which start at min_pos or later to the read window
+ * @return false if the window would exceed the cache capacity
+ */
+bool BamReader::cacheReads(int tid, int beg, int end, int64_t min_pos)
+{
+    if (_impl->hts_itr_ptr_ != nullptr)
+    {
+        hts_itr_destroy(_impl->hts_itr_ptr_);
+    }
+    _impl->hts_itr_ptr_ = sam_itr_queryi(_impl->hts_idx_ptr_, tid, beg, end);
+    if (_impl->hts_itr_ptr_ == nullptr)
+    {
+        error("Failed to jump to %d:%d-%d in %s", tid, beg, end, _impl->file_path.c_str());
+    }
+    if (_impl->hts_bam_align_ptr_ == nullptr)
+    {
+        _impl->hts_bam_align_ptr_ = bam_init1();
+    }
+
+    int read_ret = 0;
+    while ((read_ret = SkipToNextGoodAlign()) >= 0)
+    {
+        if (_impl->hts_bam_align_ptr_->core.pos < min_pos)
+        {
+            continue;
+        }
+        if (_impl->window_reads_.size() >= _impl->read_cache_capacity_)
+        {
+            return false;
+        }
+        _impl->window_reads_.emplace_back();
+        decodeHtsAlign(_impl->hts_bam_align_ptr_, _impl->window_reads_.back().read, _impl->decode_read_groups_);
+        _impl->window_reads_.back().end = bam_endpos(_impl->hts_bam_align_ptr_);
+    }
+    if (read_ret < -1)
+    {
+        error("ERROR: Failed to extract read from BAM.");
+    }
+    return true;
+}
+
 bool BamReader::getAlign(Read& read)
 {
+    if (!_impl->parts_.empty())
+    {
+        return getMergedAlign(read);
+    }
+    if (_impl->serving_from_window_)
+    {
+        std::vector<BamReaderImpl::CachedRead> const& window_reads = _impl->window_reads_;
+        while (_impl->next_window_read_ < window_reads.size())
+        {
+            BamReaderImpl::CachedRead const& cached = window_reads[_impl->next_window_read_++];
+            if (cached.read.pos() >= _impl->region_end_)
+            {
+                _impl->next_window_read_ = window_reads.size();
+            }
+            else if (cached.end > _impl->region_beg_)
+            {
+                read = cached.read;
+                return true;
+            }
+        }
+        return false;
+    }
+
     if (_impl->hts_file_ptr_ == nullptr)
     {
         throw std::logic_error("Error: BAM file is not open.");
@@ -299,11 +518,35 @@ bool BamReader::getAlign(Read& read)
         error("ERROR: Failed to extract read from BAM.");
     }
 
-    decodeHtsAlign(_impl->hts_bam_align_ptr_, read);
+    decodeHtsAlign(_impl->hts_bam_align_ptr_, read, _impl->decode_read_groups_);
 
     return true;
 }
 
+/**
+ * Return the next read of the file whose next read has the lowest position, the first file wins ties
+ */
+bool BamReader::getMergedAlign(Read& read)
+{
+    const size_t num_parts = _impl->parts_.size();
+    size_t next_part = num_parts;
+    for (size_t i = 0; i != num_parts; ++i)
+    {
+        if (_impl->part_has_read_[i]
+            && (next_part == num_parts || _impl->part_reads_[i].pos() < _impl->part_reads_[next_part].pos()))
+        {
+            next_part = i;
+        }
+    }
+    if (next_part == num_parts)
+    {
+        return false;
+    }
+    std::swap(read, _impl->part_reads_[next_part]);
+    _impl->part_has_read_[next_part] = _impl->parts_[next_part]->getAlign(_impl->part_reads_[next_part]);
+    return true;
+}
+
 int BamReader::SkipToNextGoodAlign()
 {
     bool is_primary_align = false;
@@ -326,6 +569,45 @@ int BamReader::SkipToNextGoodAlign()
 }
 
 bool BamReader::getAlignedMate(const Read& read, Read& mate)
+{
+    if (!_impl->parts_.empty())
+    {
+        for (auto& part : _impl->parts_)
+        {
+            if (part->getAlignedMate(read, mate))
+            {
+                return true;
+            }
+        }
+        mate = Read();
+        return false;
+    }
+
+    if (_impl->read_cache_capacity_ == 0)
+    {
+        return findAlignedMate(read, mate);
+    }
+
+    const std::string key = read.fragment_id() + (read.is_first_mate() ? "/1" : "/2");
+    const auto cached = _impl->mate_cache_.find(key);
+    if (cached != _impl->mate_cache_.end())
+    {
+        mate = cached->second.mate;
+        return cached->second.found;
+    }
+
+    const bool found = findAlignedMate(read, mate);
+    if (_impl->mate_cache_order_.size() >= _impl->read_cache_capacity_)
+    {
+        _impl->mate_cache_.erase(_impl->mate_cache_order_.front());
+        _impl->mate_cache_order_.pop_front();
+    }
+    _impl->mate_cache_.emplace(key, BamReaderImpl::CachedMate{ found, mate });
+    _impl->mate_cache_order_.push_back(key);
+    return found;
+}
+
+bool BamReader::findAlignedMate(const Read& read, Read& mate)
 {
     int32_t tid = 0;
     int32_t beg = 0;
@@ -352,7 +634,7 @@ bool BamReader::getAlignedMate(const Read& read, Read& mate)
     }
     while (sam_itr_next(_impl->hts_file_ptr_, iter, _impl->hts_bam_align_ptr_) >= 0)
     {
-        decodeHtsAlign(_impl->hts_bam_align_ptr_, mate);
+        decodeHtsAlign(_impl->hts_bam_align_ptr_, mate, _impl->decode_read_groups_);
         if ((mate.fragment_id() == read.fragment_id()) && (mate.is_first_mate() != read.is_first_mate()))
         {
             hts_itr_destroy(iter);
@@ -363,8 +645,135 @@ bool BamReader::getAlignedMate(const Read& read, Read& mate)
     return false;
 }
 
+bool BamReader::estimateRegionReadCount(std::string const& region, size_t& read_count)
+{
+    if (!_impl->parts_.empty())
+    {
+        read_count = 0;
+        for (auto& part : _impl->parts_)
+        {
+            size_t part_read_count = 0;
+            if (!part->estimateRegionReadCount(region, part_read_count))
+            {
+                return false;
+            }
+            read_count += part_read_count;
+        }
+        return true;
+    }
+
+    std::string chr;
+    int64_t region_start = -1;
+    int64_t region_end = -1;
+    common::stringutil::parsePos(region, chr, region_start, region_end);
+
+    const auto tid_it = _impl->header_contig_map.find(chr);
+    if (tid_it == _impl->header_contig_map.end())
+    {
+        read_count = 0;
+        return true;
+    }
+    const int tid = tid_it->second;
+
+    uint64_t mapped = 0;
+    uint64_t unmapped = 0;
+    if (hts_idx_get_stat(_impl->hts_idx_ptr_, tid, &mapped, &unmapped) < 0)
+    {
+        return false;
+    }
+
+    const int64_t contig_length = _impl->hts_bam_hdr_ptr_->target_len[tid];
+    if (contig_length <= 0)
+    {
+        read_count = 0;
+        return true;
+    }
+    region_start = std::max<int64_t>(region_start, 0);
+    region_end = region_end < 0 ? contig_length - 1 : std::min(region_end, contig_length - 1);
+    const int64_t region_length = std::max<int64_t>(region_end - region_start + 1, 0);
+
+    read_count = static_cast<size_t>(ceil(static_cast<double>(mapped) * region_length / contig_length));
+    return true;
+}
+
+namespace
+{
+/**
+ * Combine the depth estimates of several files of the same sample: depths of the files add up,
+ * read length is the mean over all reads
+ */
+void addPartDepth(DepthInfo& total, double& total_read_length, DepthInfo const& part)
+{
+    total.read_length_unique = total.read_length_unique && part.read_length_unique
+        && (total.read_count == 0 || part.read_count == 0 || total.read_length == part.read_length);
+    total.depth_median += part.depth_median;
+    total.depth_variance += part.depth_variance;
+    total_read_length += static_cast<double>(part.read_length) * part.read_count;
+    total.read_count += part.read_count;
+    if (total.read_count > 0)
+    {
+        total.read_length = static_cast<size_t>(total_read_length / total.read_count);
+    }
+}
+
+/**
+ * @return IDs of the @RG lines in a BAM header
+ */
+std::vector<std::string> headerReadGroups(const bam_hdr_t* header)
+{
+    std::vector<std::string> read_groups;
+    std::istringstream text(std::string(header->text, header->l_text));
+    std::string line;
+    while (std::getline(text, line))
+    {
+        if (line.compare(0, 4, "@RG\t") != 0)
+        {
+            continue;
+        }
+        const size_t id_start = line.find("\tID:");
+        if (id_start != std::string::npos)
+        {
+            const size_t id_end = line.find('\t', id_start + 4);
+            read_groups.push_back(
+                line.substr(id_start + 4, id_end == std::string::npos ? std::string::npos : id_end - id_start - 4));
+        }
+    }
+    return read_groups;
+}
+}
+
 std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
 {
+    return std::move(estimateGroupDepths(region, false)[""]);
+}
+
+std::map<std::string, std::unique_ptr<DepthInfo>> BamReader::estimateReadGroupDepths(std::string const& region)
+{
+    return estimateGroupDepths(region, true);
+}
+
+std::map<std::string, std::unique_ptr<DepthInfo>>
+BamReader::estimateGroupDepths(std::string const& region, bool by_read_group)
+{
+    if (!_impl->parts_.empty())
+    {
+        std::map<std::string, std::unique_ptr<DepthInfo>> dp_infos;
+        std::map<std::string, double> total_read_length;
+        for (auto& part : _impl->parts_)
+        {
+            for (const auto& part_info : part->estimateGroupDepths(region, by_read_group))
+            {
+                auto& dp_info = dp_infos[part_info.first];
+                if (!dp_info)
+                {
+                    dp_info.reset(new DepthInfo);
+                }
+                addPartDepth(*dp_info, total_read_length[part_info.first], *part_info.second);
+            }
+        }
+        return dp_infos;
+    }
+
     auto logger = LOG();
 
     // max change of DP for convergence
@@ -372,9 +781,6 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
     // Minimum region length to estimate depth over
     static const auto kIntervalLength = 2000000;
 
-    // output variable that will be returned
-    std::unique_ptr<DepthInfo> dp_info{ new DepthInfo };
-
     // file needs to be open already so we have a path
     // we will open a separate handle below s.t. we can
     // run this function in parallel with itself + read CRAM files
@@ -441,12 +847,25 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
     std::unique_ptr<bam1_t, std::function<void(bam1_t*)>> hts_align_ptr{ bam_init1(), bam_destroy1 };
 
     using namespace boost::accumulators;
-    accumulator_set<double, features<tag::count, tag::median, tag::variance>> read_length_accumulator;
-    accumulator_set<double, features<tag::median, tag::variance>> depth_accumulator;
+    // statistics over all reads (key "") and over the reads of each read group in the header
+    struct GroupStatistics
+    {
+        accumulator_set<double, features<tag::count, tag::median, tag::variance>> read_length_accumulator;
+        accumulator_set<double, features<tag::median, tag::variance>> depth_accumulator;
+        double convergence_previous_depth = std::numeric_limits<double>::max();
+    };
+    std::map<std::string, GroupStatistics> groups;
+    groups[""];
+    if (by_read_group)
+    {
+        for (const auto& read_group : headerReadGroups(_impl->hts_bam_hdr_ptr_))
+        {
+            groups[read_group];
+        }
+    }
 
     bool all_finished = false;
     bool converged = false;
-    double convergence_previous_depth = std::numeric_limits<double>::max();
 
     int cycle = 0;
 
@@ -460,21 +879,27 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
             return;
         }
         // check every ~1M reads
-        const double current_depth = median(depth_accumulator);
-        if (fabs(current_depth - convergence_previous_depth) < kDPAccuracy)
+        bool all_converged = true;
+        for (auto& group : groups)
         {
+            const double current_depth = median(group.second.depth_accumulator);
+            if (fabs(current_depth - group.second.convergence_previous_depth) >= kDPAccuracy)
+            {
 #ifdef _DEBUG
-            logger->debug("Converged for {} DP: {}", chr, current_depth);
+                logger->debug(
+                    "Not converged yet for {} {} previous: {} current: {}", chr, group.first,
+                    group.second.convergence_previous_depth, current_depth);
 #endif
-            converged = true;
+                all_converged = false;
+            }
+            group.second.convergence_previous_depth = current_depth;
         }
-        else
+        if (all_converged)
         {
 #ifdef _DEBUG
-            logger->debug(
-                "Not converged yet for {} previous: {} current: {}", chr, convergence_previous_depth, current_depth);
+            logger->debug("Converged for {}", chr);
 #endif
-            convergence_previous_depth = current_depth;
+            converged = true;
         }
     };
 
@@ -510,7 +935,11 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
             int return_value;
             int any_reads = 0;
 
-            ReadPileup pileup;
+            std::map<std::string, ReadPileup> pileups;
+            for (const auto& group : groups)
+            {
+                pileups[group.first];
+            }
 
             while ((return_value = sam_itr_next(tmp_impl.hts_file_ptr_, hts_itr_ptr.get(), hts_align_ptr.get())) >= 0)
             {
@@ -526,10 +955,24 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
 
                 // update read length
                 any_reads++;
-                read_length_accumulator(hts_align_ptr->core.l_qseq);
+                groups[""].read_length_accumulator(hts_align_ptr->core.l_qseq);
 
                 // update pileup
-                pileup.addRead(SimpleRead::make(hts_align_ptr->core.pos, hts_align_ptr->core.l_qseq));
+                pileups[""].addRead(SimpleRead::make(hts_align_ptr->core.pos, hts_align_ptr->core.l_qseq));
+
+                if (by_read_group)
+                {
+                    uint8_t* read_group = bam_aux_get(hts_align_ptr.get(), "RG");
+                    const auto group = read_group != nullptr && *read_group == 'Z'
+                        ? groups.find(bam_aux2Z(read_group))
+                        : groups.end();
+                    if (group != groups.end())
+                    {
+                        group->second.read_length_accumulator(hts_align_ptr->core.l_qseq);
+                        pileups[group->first].addRead(
+                            SimpleRead::make(hts_align_ptr->core.pos, hts_align_ptr->core.l_qseq));
+                    }
+                }
 
                 last_pos = static_cast<int64_t>(hts_align_ptr->core.pos);
 
@@ -540,14 +983,20 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
                 }
             }
 
-            int64_t last_pileup_pos = start;
-            const size_t current_read_length = median(read_length_accumulator);
-            while (last_pileup_pos <= last_pos)
+            for (auto& group : groups)
             {
-                size_t dp = 0;
-                pileup.pileup(last_pileup_pos, [&dp](ReadPileupInfo*) { ++dp; });
-                depth_accumulator(dp);
-                last_pileup_pos += std::max((size_t)1, current_read_length / 2);
+                int64_t last_pileup_pos = start;
+                const size_t current_read_length = count(group.second.read_length_accumulator) > 0
+                    ? static_cast<size_t>(median(group.second.read_length_accumulator))
+                    : 0;
+                ReadPileup& pileup = pileups[group.first];
+                while (last_pileup_pos <= last_pos)
+                {
+                    size_t dp = 0;
+                    pileup.pileup(last_pileup_pos, [&dp](ReadPileupInfo*) { ++dp; });
+                    group.second.depth_accumulator(dp);
+                    last_pileup_pos += std::max((size_t)1, current_read_length / 2);
+                }
             }
 
             if (return_value < 0)
@@ -574,17 +1023,24 @@ std::unique_ptr<DepthInfo> BamReader::estimateDepth(std::string const& region)
         check_convergence();
     }
 
-    dp_info->read_length_unique = fabs(variance(read_length_accumulator)) < std::numeric_limits<double>::epsilon();
-    dp_info->read_length = static_cast<size_t>(median(read_length_accumulator));
-    dp_info->read_count = static_cast<size_t>(count(read_length_accumulator));
-    dp_info->depth_median = median(depth_accumulator);
-    dp_info->depth_variance = round(variance(depth_accumulator) * 100 / 100);
+    std::map<std::string, std::unique_ptr<DepthInfo>> dp_infos;
+    for (const auto& group : groups)
+    {
+        std::unique_ptr<DepthInfo> dp_info{ new DepthInfo };
+        dp_info->read_length_unique
+            = fabs(variance(group.second.read_length_accumulator)) < std::numeric_limits<double>::epsilon();
+        dp_info->read_length = static_cast<size_t>(median(group.second.read_length_accumulator));
+        dp_info->read_count = static_cast<size_t>(count(group.second.read_length_accumulator));
+        dp_info->depth_median = median(group.second.depth_accumulator);
+        dp_info->depth_variance = round(variance(group.second.depth_accumulator) * 100 / 100);
+        dp_infos[group.first] = std::move(dp_info);
+    }
 
     if (!converged && !all_finished)
     {
         logger->warn("DP estimation for region {} did not converge.", region);
     }
 
-    return dp_info;
+    return dp_infos;
 }
 }
@@ -0,0 +1,114 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Decoding of htslib records into reads, shared by the BAM readers
+ *
+ * \file HtsHelpers.hh
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+extern "C" {
+#include <htslib/sam.h>
+};
+
+#include "common/BamReader.hh"
+#include "common/Read.hh"
+
+namespace common
+{
+
+static inline void decodeHtsBases(bam1_t* hts_align_ptr, std::string& bases)
+{
+    uint8_t* hts_seq_ptr = bam_get_seq(hts_align_ptr);
+    const int32_t read_len = hts_align_ptr->core.l_qseq;
+    bases.resize((unsigned long)read_len);
+
+    for (int32_t i = 0; i < read_len; ++i)
+    {
+        bases[i] = seq_nt16_str[bam_seqi(hts_seq_ptr, i)];
+    }
+}
+
+static inline void decodeHtsQuals(bam1_t* hts_align_ptr, std::string& quals)
+{
+    uint8_t* hts_quals_ptr = bam_get_qual(hts_align_ptr);
+    const int32_t read_len = hts_align_ptr->core.l_qseq;
+    quals.resize((unsigned long)read_len);
+
+    uint8_t* test_hts_quals_ptr = hts_quals_ptr;
+
+    for (int32_t i = 0; i < read_len; ++i)
+    {
+        quals[i] = static_cast<char>(33 + test_hts_quals_ptr[i]);
+    }
+}
+
+/**
+ * Decode BAM alignment from HTSLib struct.
+ *
+ * @param hts_align_ptr a bam1_t * to initialize from.
+ * Passed as void* to avoid dependency on htslib headers
+ * @param decode_read_group set the read group from the RG tag, otherwise it is left empty
+ *
+ * TODO we could make this a constructor
+ */
+static inline void decodeHtsAlign(void* _hts_align_ptr, Read& read, bool decode_read_group = false)
+{
+    auto* hts_align_ptr = (bam1_t*)_hts_align_ptr;
+    const std::string fragment_id = bam_get_qname(hts_align_ptr);
+    std::string bases, quals;
+    decodeHtsBases(hts_align_ptr, bases);
+    decodeHtsQuals(hts_align_ptr, quals);
+    read.set_fragment_id(fragment_id);
+    read.set_bases(bases);
+    read.set_quals(quals);
+
+    const auto& flag = hts_align_ptr->core.flag;
+    read.set_is_mapped((flag & BamReader::kIsMapped) == 0);
+    read.set_is_first_mate((flag & BamReader::kIsFirstMate) != 0);
+    read.set_is_mate_mapped((flag & BamReader::kIsMateMapped) == 0);
+    read.set_is_reverse_strand(bam_is_rev(hts_align_ptr));
+    read.set_is_mate_reverse_strand(bam_is_mrev(hts_align_ptr));
+
+    read.set_chrom_id(hts_align_ptr->core.tid);
+    read.set_pos(hts_align_ptr->core.pos);
+    read.set_mapq(hts_align_ptr->core.qual);
+    read.set_mate_chrom_id(hts_align_ptr->core.mtid);
+    read.set_mate_pos(hts_align_ptr->core.mpos);
+    const uint32_t* cigar = bam_get_cigar(hts_align_ptr);
+    read.set_has_single_match_cigar(
+        hts_align_ptr->core.n_cigar == 1
+        && (bam_cigar_op(cigar[0]) == BAM_CMATCH || bam_cigar_op(cigar[0]) == BAM_CEQUAL));
+
+    uint8_t* read_group = decode_read_group ? bam_aux_get(hts_align_ptr, "RG") : nullptr;
+    if (read_group != nullptr && *read_group == 'Z')
+    {
+        read.set_read_group(bam_aux2Z(read_group));
+    }
+    else
+    {
+        read.set_read_group(std::string());
+    }
+}
+}
@@ -0,0 +1,90 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Memory budget implementation
+ *
+ * \file MemoryBudget.cpp
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "common/MemoryBudget.hh"
+#include "common/Read.hh"
+
+#include "common/Error.hh"
+
+namespace common
+{
+
+std::size_t estimateReadBufferSize(std::size_t num_reads, std::size_t read_length)
+{
+    // fragment id, bases and qualities are stored on the read, graph CIGAR and
+    // supported nodes / edges / sequences are added during alignment and
+    // disambiguation. The constants are rough averages measured on 150bp reads.
+    static const std::size_t kFragmentIdAndLabels = 256;
+    const std::size_t per_read = sizeof(Read) + sizeof(p_Read) + kFragmentIdAndLabels + 3 * read_length;
+    return num_reads * per_read;
+}
+
+std::size_t MemoryBudget::acquire(std::size_t bytes)
+{
+    if (unlimited())
+    {
+        return 0;
+    }
+    bytes = std::max<std::size_t>(bytes, 1);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (bytes > capacity_)
+    {
+        LOG()->warn(
+            "Estimated footprint of {} bytes exceeds the memory budget of {} bytes, waiting to run alone.", bytes,
+            capacity_);
+    }
+    // requests larger than the budget are admitted when nothing else is running
+    released_.wait(lock, [this, bytes]() { return reservations_ == 0 || inFlight_ + bytes <= capacity_; });
+    inFlight_ += bytes;
+    ++reservations_;
+    return bytes;
+}
+
+void MemoryBudget::release(std::size_t bytes)
+{
+    if (bytes == 0)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(reservations_ > 0 && inFlight_ >= bytes);
+        inFlight_ -= bytes;
+        --reservations_;
+    }
+    released_.notify_all();
+}
+
+std::size_t MemoryBudget::inFlight() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inFlight_;
+}
+}
@@ -19,8 +19,13 @@
 
 #include "common/ReadExtraction.hh"
 #include "common/Error.hh"
+#include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <limits>
 #include <list>
+#include <string>
+#include <unordered_map>
 
 namespace common
 {
@@ -34,19 +39,21 @@ namespace common
  * possibly support it and happen to be aligned outside of target region
  * @param all_reads output vector to store retrieved reads
  * @param avr_fragment_length decides how long to extend beyond target region
+ * @param recover_mates recover missing mates also when the graph has no long insertions
  */
 void extractReads(
     BamReader& reader, std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
-    std::vector<p_Read>& all_reads, int avr_fragment_length)
+    std::vector<p_Read>& all_reads, int avr_fragment_length, double max_read_density, bool recover_mates)
 {
     auto logger = LOG();
     for (const auto& region : target_regions)
     {
         logger->info("[Retrieving for region {}.]", (std::string)region);
         std::pair<int, int> num_extracted_reads = extractReadsFromRegion(
-            all_reads, max_num_reads, reader, region, longest_alt_insertion, avr_fragment_length);
+            all_reads, max_num_reads, reader, region, longest_alt_insertion, avr_fragment_length, max_read_density,
+            recover_mates);
 
-        if (max_num_reads == num_extracted_reads.first)
+        if (max_read_density <= 0 && max_num_reads == num_extracted_reads.first)
         {
             logger->warn("Reached maximum number of reads ({}).", max_num_reads);
         }
@@ -81,6 +88,151 @@ void extractReads(
     logger->info("Done retrieving reads from {}", bam_path);
 }
 
+/**
+ * Read extraction for several samples stored as read groups of the same file(s). Each target region is
+ * read once and records are routed to the samples by their RG tag; the read limit, read length estimate and
+ * mate recovery apply to each sample separately as in extractReadsFromRegion. Records from other read groups
+ * are skipped.
+ * @param reader An open bam reader, read groups are enabled on it
+ * @param target_regions list of target regions
+ * @param max_reads maximum number of reads per target region and sample to retrieve
+ * @param longest_alt_insertion If graph has long enough insertions recoverMissingMates is used to find mates that
+ * possibly support it and happen to be aligned outside of target region
+ * @param sample_names names of the samples for logging
+ * @param read_groups read group IDs of each sample
+ * @param sample_reads output vectors to store retrieved reads, one per sample
+ * @param avr_fragment_length decides how long to extend beyond target region
+ * @param recover_mates recover missing mates also when the graph has no long insertions
+ */
+void extractReadGroupReads(
+    BamReader& reader, std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
+    std::vector<std::string> const& sample_names, std::vector<std::vector<std::string>> const& read_groups,
+    std::vector<std::vector<p_Read>>& sample_reads, int avr_fragment_length, bool recover_mates)
+{
+    auto logger = LOG();
+    reader.enableReadGroups();
+    const std::size_t num_samples = read_groups.size();
+    assert(sample_names.size() == num_samples);
+    sample_reads.resize(num_samples);
+
+    std::unordered_map<std::string, std::size_t> sample_of_read_group;
+    for (std::size_t sample = 0; sample < num_samples; ++sample)
+    {
+        for (const auto& read_group : read_groups[sample])
+        {
+            if (!sample_of_read_group.emplace(read_group, sample).second)
+            {
+                error("ERROR: Read group %s is assigned to more than one sample", read_group.c_str());
+            }
+        }
+    }
+
+    for (const auto& region : target_regions)
+    {
+        logger->info("[Retrieving read groups for region {}.]", (std::string)region);
+        const auto extended_region = region.getExtendedRegion(static_cast<int64_t>(avr_fragment_length * 3));
+        reader.setRegion(extended_region);
+
+        std::vector<ReadPairs> read_pairs(num_samples);
+        std::vector<unsigned> total_read_length(num_samples, 0);
+        std::vector<unsigned> reads(num_samples, 0);
+        std::size_t samples_done = 0;
+        Read read;
+        while (samples_done != num_samples && reader.getAlign(read))
+        {
+            const auto sample = sample_of_read_group.find(read.read_group());
+            if (sample == sample_of_read_group.end() || read_pairs[sample->second].num_reads() == max_num_reads)
+            {
+                continue;
+            }
+            ReadPairs& pairs = read_pairs[sample->second];
+            if (read.bases().length())
+            {
+                total_read_length[sample->second] += read.bases().length();
+                ++reads[sample->second];
+            }
+            if (isReadOrItsMateInRegion(read, region))
+            {
+                pairs.add(read);
+                samples_done += pairs.num_reads() == max_num_reads ? 1 : 0;
+            }
+        }
+
+        for (std::size_t sample = 0; sample < num_samples; ++sample)
+        {
+            const int num_reads_original = read_pairs[sample].num_reads();
+            const unsigned read_length = reads[sample] ? total_read_length[sample] / reads[sample] : 0;
+            if (max_num_reads == num_reads_original)
+            {
+                logger->warn(
+                    "Reached maximum number of reads ({}) for sample {}.", max_num_reads, sample_names[sample]);
+            }
+            else if (recover_mates || read_length <= longest_alt_insertion * 2)
+            {
+                recoverMissingMates(reader, read_pairs[sample]);
+            }
+            logger->info(
+                "[Retrieved {} + {} additional reads for sample {}]", num_reads_original,
+                read_pairs[sample].num_reads() - num_reads_original, sample_names[sample]);
+            read_pairs[sample].getReads(sample_reads[sample]);
+        }
+    }
+}
+
+/**
+ * Estimate how many reads extractReads will retrieve using the index statistics of the reader
+ * @param reader An open reader
+ * @param target_regions list of target regions
+ * @param max_num_reads maximum number of reads per target region to retrieve
+ * @param avr_fragment_length decides how long to extend beyond target region
+ * @param max_read_density if > 0, replaces max_num_reads as in extractReads
+ * @return estimated number of reads; max_num_reads per region when the index has no read counts
+ */
+size_t estimateNumReads(
+    BamReader& reader, std::list<Region> const& target_regions, int max_num_reads, int avr_fragment_length,
+    double max_read_density)
+{
+    size_t total = 0;
+    for (const auto& region : target_regions)
+    {
+        const auto extended_region = region.getExtendedRegion(static_cast<int64_t>(avr_fragment_length * 3));
+        if (max_read_density > 0)
+        {
+            max_num_reads = maxReadsForDensity(extended_region, max_read_density);
+        }
+        size_t region_reads = 0;
+        if (!reader.estimateRegionReadCount(extended_region, region_reads))
+        {
+            region_reads = static_cast<size_t>(std::max(max_num_reads, 0));
+        }
+        else if (max_num_reads >= 0)
+        {
+            region_reads = std::min(region_reads, static_cast<size_t>(max_num_reads));
+        }
+        total += region_reads;
+    }
+    return total;
+}
+
+size_t estimateReadLength(ReadReader& reader, int num_reads)
+{
+    reader.setRegion(".");
+    Read read;
+    size_t total_length = 0;
+    int reads_seen = 0;
+    while (reads_seen < num_reads && reader.getAlign(read))
+    {
+        total_length += read.bases().size();
+        ++reads_seen;
+    }
+    return reads_seen ? total_length / reads_seen : 0;
+}
+
+int maxReadsForDensity(const Region& region, double max_read_density)
+{
+    return static_cast<int>(std::ceil(max_read_density * static_cast<double>(region.length())));
+}
+
 /**
  * Lower-level read extraction interface for specified target region
  * @return <num_original_extracted, num_recovered_mates> when finish
@@ -91,10 +243,13 @@ void extractReads(
  * @param longest_alt_insertion If graph has long enough insertions recoverMissingMates is used to find mates that
  * possibly support it and happen to be aligned outside of target region
  * @param avr_fragment_length decides how long to extend beyond target region
+ * @param max_read_density if > 0, replaces max_reads by this many reads per base of the extended region. Regions
+ * with more reads are subsampled uniformly instead of truncated.
+ * @param recover_mates recover missing mates also when the graph has no long insertions
  */
 std::pair<int, int> extractReadsFromRegion(
     std::vector<p_Read>& all_reads, int max_num_reads, ReadReader& reader, const Region& region,
-    unsigned longest_alt_insertion, int avr_fragment_length)
+    unsigned longest_alt_insertion, int avr_fragment_length, double max_read_density, bool recover_mates)
 {
 
     int extended_flank = avr_fragment_length * 3;
@@ -102,10 +257,27 @@ std::pair<int, int> extractReadsFromRegion(
     reader.setRegion(extended_region);
 
     ReadPairs read_pairs;
-    unsigned read_length = extractMappedReadsFromRegion(read_pairs, max_num_reads, reader, region);
+    unsigned read_length = 0;
+    if (max_read_density > 0)
+    {
+        // the mates of subsampled pairs have the same fragment hash, so they can still be recovered below
+        max_num_reads = maxReadsForDensity(extended_region, max_read_density);
+        uint32_t max_hash = std::numeric_limits<uint32_t>::max();
+        read_length = extractSubsampledReadsFromRegion(read_pairs, max_num_reads, reader, region, max_hash);
+        if (max_hash != std::numeric_limits<uint32_t>::max())
+        {
+            const double kept_fraction = (static_cast<double>(max_hash) + 1) / 4294967296.0;
+            LOG()->warn("Subsampled read pairs to {:.2f}% to stay below {} reads.", 100 * kept_fraction, max_num_reads);
+        }
+    }
+    else
+    {
+        read_length = extractMappedReadsFromRegion(read_pairs, max_num_reads, reader, region);
+    }
 
     std::pair<int, int> num_extracted_reads;
-    if (max_num_reads == read_pairs.num_reads() || read_length > longest_alt_insertion * 2)
+    if ((max_read_density <= 0 && max_num_reads == read_pairs.num_reads())
+        || (!recover_mates && read_length > longest_alt_insertion * 2))
     {
         num_extracted_reads = std::make_pair(read_pairs.num_reads(), 0);
     }
@@ -151,6 +323,33 @@ int extractMappedReadsFromRegion(ReadPairs& read_pairs, int max_num_reads, ReadR
     return reads ? total_read_length / reads : 0;
 }
 
+int extractSubsampledReadsFromRegion(
+    ReadPairs& read_pairs, int max_num_reads, ReadReader& reader, const Region& region, uint32_t& max_hash)
+{
+    Read read;
+    unsigned total_read_length = 0;
+    unsigned reads = 0;
+    while (reader.getAlign(read))
+    {
+        if (read.bases().length())
+        {
+            total_read_length += read.bases().length();
+            ++reads;
+        }
+        if (ReadPairs::fragmentHash(read.fragment_id()) <= max_hash && isReadOrItsMateInRegion(read, region))
+        {
+            read_pairs.add(read);
+            while (read_pairs.num_reads() > max_num_reads && max_hash > 0)
+            {
+                max_hash /= 2;
+                read_pairs.removeAboveHash(max_hash);
+            }
+        }
+    }
+
+    return reads ? total_read_length / reads : 0;
+}
+
 /**
  *
  * return true if this aligned read or its mate overlaps >= 1 base with the target region
@@ -81,6 +81,33 @@ void ReadPairs::getReads(vector<p_Read>& reads)
     }
 }
 
+void ReadPairs::removeAboveHash(uint32_t max_hash)
+{
+    for (auto read_pair = read_pairs_.begin(); read_pair != read_pairs_.end();)
+    {
+        if (fragmentHash(read_pair->first) > max_hash)
+        {
+            num_reads_ -= (int)read_pair->second.first_mate().is_initialized()
+                + (int)read_pair->second.second_mate().is_initialized();
+            read_pair = read_pairs_.erase(read_pair);
+        }
+        else
+        {
+            ++read_pair;
+        }
+    }
+}
+
+uint32_t ReadPairs::fragmentHash(const std::string& fragment_id)
+{
+    uint32_t hash = 2166136261u;
+    for (const char c : fragment_id)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
 void ReadPairs::clear()
 {
     read_pairs_.clear();
@@ -0,0 +1,542 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Read extraction for many targets with one sequential pass over a BAM / CRAM file
+ *
+ * \file ReadSweep.cpp
+ *
+ */
+
+#include "common/ReadSweep.hh"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+};
+
+#include "common/BamReader.hh"
+#include "common/Error.hh"
+#include "HtsHelpers.hh"
+#include "common/ReadExtraction.hh"
+#include "common/ReadPairs.hh"
+
+namespace common
+{
+
+namespace
+{
+/**
+ * Collects the mate lookups recoverMissingMates makes, so they can be served by a second pass
+ */
+class MateRequestRecorder : public ReadReader
+{
+public:
+    void setRegion(const std::string&) override {}
+    bool getAlign(Read&) override { return false; }
+    bool getAlignedMate(const Read& read, Read&) override
+    {
+        requests.push_back(read);
+        return false;
+    }
+
+    std::vector<Read> requests;
+};
+}
+
+struct ReadSweep::ReadSweepImpl
+{
+    struct SweepRegion
+    {
+        std::size_t target = 0;
+        Region region;
+        // extended region as parsed by sam_itr_querys, [beg, end)
+        int tid = -1;
+        int beg = 0;
+        int end = 0;
+        ReadPairs read_pairs;
+        unsigned total_read_length = 0;
+        unsigned reads_seen = 0;
+        std::size_t pending_mates = 0;
+        ReadBuffer reads;
+    };
+
+    struct SweepTarget
+    {
+        std::vector<std::size_t> regions;
+        int max_num_reads = 0;
+        unsigned longest_alt_insertion = 0;
+        bool recover_mates = false;
+        std::size_t unfinished_regions = 0;
+    };
+
+    // lookup of BamReader::getAlignedMate, served by the second pass
+    struct MateRequest
+    {
+        std::size_t region;
+        std::string fragment_id;
+        bool first_mate;
+        int tid;
+        int64_t pos;
+        bool found;
+    };
+
+    ReadSweepImpl() = default;
+    ReadSweepImpl(ReadSweepImpl const&) = delete;
+    ReadSweepImpl& operator=(ReadSweepImpl const&) = delete;
+    ~ReadSweepImpl() { close(); }
+
+    void open()
+    {
+        close();
+        hts_file_ptr_ = sam_open(path.c_str(), "r");
+        if (hts_file_ptr_ == nullptr)
+        {
+            error("ERROR: Failed to open %s", path.c_str());
+        }
+        if (hts_file_ptr_->format.format != bam && hts_file_ptr_->format.format != cram)
+        {
+            error("ERROR: Unknown alignment file format.");
+        }
+        if (hts_set_fai_filename(hts_file_ptr_, (reference + ".fai").c_str()) != 0)
+        {
+            error("ERROR: Failed to use reference %s for %s", reference.c_str(), path.c_str());
+        }
+        hts_bam_hdr_ptr_ = sam_hdr_read(hts_file_ptr_);
+        if (hts_bam_hdr_ptr_ == nullptr)
+        {
+            error("ERROR: Failed to read header of %s", path.c_str());
+        }
+        hts_bam_align_ptr_ = bam_init1();
+    }
+
+    void close()
+    {
+        if (hts_bam_align_ptr_ != nullptr)
+        {
+            bam_destroy1(hts_bam_align_ptr_);
+            hts_bam_align_ptr_ = nullptr;
+        }
+        if (hts_bam_hdr_ptr_ != nullptr)
+        {
+            bam_hdr_destroy(hts_bam_hdr_ptr_);
+            hts_bam_hdr_ptr_ = nullptr;
+        }
+        if (hts_file_ptr_ != nullptr)
+        {
+            sam_close(hts_file_ptr_);
+            hts_file_ptr_ = nullptr;
+        }
+    }
+
+    /**
+     * @return true if the file has an index we can look up mates in
+     */
+    bool hasIndex() const
+    {
+        htsFile* probe = sam_open(path.c_str(), "r");
+        if (probe == nullptr)
+        {
+            return false;
+        }
+        hts_idx_t* index = sam_index_load2(probe, path.c_str(), index_path.empty() ? NULL : index_path.c_str());
+        const bool found = index != nullptr;
+        if (index != nullptr)
+        {
+            hts_idx_destroy(index);
+        }
+        sam_close(probe);
+        return found;
+    }
+
+    void start()
+    {
+        region_order_.resize(regions_.size());
+        for (std::size_t r = 0; r != regions_.size(); ++r)
+        {
+            region_order_[r] = r;
+        }
+        std::stable_sort(region_order_.begin(), region_order_.end(), [this](std::size_t a, std::size_t b) {
+            return regions_[a].tid < regions_[b].tid
+                || (regions_[a].tid == regions_[b].tid && regions_[a].beg < regions_[b].beg);
+        });
+        LOG()->info("Sweeping {} for {} regions of {} targets", path, regions_.size(), targets_.size());
+        started_ = true;
+    }
+
+    /**
+     * Read the next primary alignment and add it to the regions it overlaps. Regions which
+     * the sweep has passed are finished.
+     * @return false once all mapped reads have been read
+     */
+    bool sweepRecord()
+    {
+        int read_ret = 0;
+        do
+        {
+            read_ret = sam_read1(hts_file_ptr_, hts_bam_hdr_ptr_, hts_bam_align_ptr_);
+        } while (read_ret >= 0
+                 && (hts_bam_align_ptr_->core.flag & (BamReader::kSupplementaryAlign | BamReader::kSecondaryAlign)));
+        if (read_ret < -1)
+        {
+            error("ERROR: Failed to extract read from %s", path.c_str());
+        }
+        if (read_ret == -1 || hts_bam_align_ptr_->core.tid < 0)
+        {
+            return false;
+        }
+
+        const int tid = hts_bam_align_ptr_->core.tid;
+        const int64_t pos = hts_bam_align_ptr_->core.pos;
+        if (tid < last_tid_ || (tid == last_tid_ && pos < last_pos_))
+        {
+            error("ERROR: %s is not sorted by coordinate", path.c_str());
+        }
+        last_tid_ = tid;
+        last_pos_ = pos;
+        // same overlap test as the htslib region iterator
+        const int64_t end_pos = bam_endpos(hts_bam_align_ptr_);
+
+        while (region_order_.size() != next_region_)
+        {
+            SweepRegion const& region = regions_[region_order_[next_region_]];
+            if (region.tid > tid || (region.tid == tid && region.beg >= end_pos))
+            {
+                break;
+            }
+            active_regions_.push_back(region_order_[next_region_++]);
+        }
+
+        Read read;
+        bool decoded = false;
+        std::size_t still_active = 0;
+        for (const std::size_t r : active_regions_)
+        {
+            SweepRegion& region = regions_[r];
+            if (region.tid < tid || region.end <= pos)
+            {
+                finishRegion(r);
+                continue;
+            }
+            active_regions_[still_active++] = r;
+            if (end_pos <= region.beg || region.read_pairs.num_reads() == targets_[region.target].max_num_reads)
+            {
+                continue;
+            }
+            if (!decoded)
+            {
+                decodeHtsAlign(hts_bam_align_ptr_, read);
+                decoded = true;
+            }
+            // same as extractMappedReadsFromRegion
+            if (read.bases().length())
+            {
+                region.total_read_length += read.bases().length();
+                ++region.reads_seen;
+            }
+            if (isReadOrItsMateInRegion(read, region.region))
+            {
+                region.read_pairs.add(read);
+            }
+        }
+        active_regions_.resize(still_active);
+        return true;
+    }
+
+    /**
+     * Finish all regions once the sweep has reached the end of the file and recover the
+     * remaining mates
+     */
+    void finishSweep()
+    {
+        while (region_order_.size() != next_region_)
+        {
+            active_regions_.push_back(region_order_[next_region_++]);
+        }
+        for (const std::size_t r : active_regions_)
+        {
+            finishRegion(r);
+        }
+        active_regions_.clear();
+
+        if (!mate_requests_.empty())
+        {
+            findMates();
+            for (std::size_t r = 0; r != regions_.size(); ++r)
+            {
+                if (regions_[r].pending_mates > 0)
+                {
+                    completeRegion(r);
+                }
+            }
+        }
+        finished_ = true;
+    }
+
+    /**
+     * Recover mates like extractReadsFromRegion does, either from the index or in the second pass
+     */
+    void finishRegion(std::size_t r)
+    {
+        SweepRegion& region = regions_[r];
+        SweepTarget const& target = targets_[region.target];
+        const unsigned read_length = region.reads_seen ? region.total_read_length / region.reads_seen : 0;
+        if (target.max_num_reads == region.read_pairs.num_reads())
+        {
+            LOG()->warn(
+                "Reached maximum number of reads ({}) for {}.", target.max_num_reads, (std::string)region.region);
+        }
+        else if (target.recover_mates || read_length <= target.longest_alt_insertion * 2)
+        {
+            if (mate_reader_)
+            {
+                recoverMissingMates(*mate_reader_, region.read_pairs);
+            }
+            else
+            {
+                MateRequestRecorder recorder;
+                recoverMissingMates(recorder, region.read_pairs);
+                for (Read const& read : recorder.requests)
+                {
+                    // BamReader::getAlignedMate looks at the mate position, or at the read position for unmapped mates
+                    const int tid = read.is_mate_mapped() ? read.mate_chrom_id() : read.chrom_id();
+                    const int64_t pos = read.is_mate_mapped() ? read.mate_pos() : read.pos();
+                    if (tid < 0)
+                    {
+                        continue;
+                    }
+                    mate_requests_by_fragment_[read.fragment_id()].push_back(mate_requests_.size());
+                    mate_requests_.push_back(
+                        MateRequest{ r, read.fragment_id(), read.is_first_mate(), tid, pos, false });
+                    ++region.pending_mates;
+                }
+                if (region.pending_mates > 0)
+                {
+                    return;
+                }
+            }
+        }
+        completeRegion(r);
+    }
+
+    void completeRegion(std::size_t r)
+    {
+        SweepRegion& region = regions_[r];
+        region.read_pairs.getReads(region.reads);
+        region.read_pairs.clear();
+        if (--targets_[region.target].unfinished_regions == 0)
+        {
+            completed_.push_back(region.target);
+        }
+    }
+
+    /**
+     * Second pass over the file to find the mates requested by regions: the first alignment of the
+     * other mate which overlaps the requested position, like an index lookup at that position
+     */
+    void findMates()
+    {
+        LOG()->info("Looking for {} mates in a second pass over {}", mate_requests_.size(), path);
+        int last_tid = -1;
+        int64_t last_pos = -1;
+        for (MateRequest const& request : mate_requests_)
+        {
+            if (request.tid > last_tid || (request.tid == last_tid && request.pos > last_pos))
+            {
+                last_tid = request.tid;
+                last_pos = request.pos;
+            }
+        }
+
+        open();
+        std::size_t unresolved = mate_requests_.size();
+        int read_ret = 0;
+        while (unresolved > 0 && (read_ret = sam_read1(hts_file_ptr_, hts_bam_hdr_ptr_, hts_bam_align_ptr_)) >= 0)
+        {
+            const int tid = hts_bam_align_ptr_->core.tid;
+            const int64_t pos = hts_bam_align_ptr_->core.pos;
+            if (tid < 0 || tid > last_tid || (tid == last_tid && pos > last_pos))
+            {
+                break;
+            }
+            const auto requests = mate_requests_by_fragment_.find(bam_get_qname(hts_bam_align_ptr_));
+            if (requests == mate_requests_by_fragment_.end())
+            {
+                continue;
+            }
+            const bool first_mate = (hts_bam_align_ptr_->core.flag & BamReader::kIsFirstMate) != 0;
+            const int64_t end_pos = bam_endpos(hts_bam_align_ptr_);
+            for (const std::size_t m : requests->second)
+            {
+                MateRequest& request = mate_requests_[m];
+                if (request.found || request.first_mate == first_mate || request.tid != tid || pos > request.pos
+                    || end_pos <= request.pos)
+                {
+                    continue;
+                }
+                Read mate;
+                decodeHtsAlign(hts_bam_align_ptr_, mate);
+                regions_[request.region].read_pairs.add(mate);
+                request.found = true;
+                --unresolved;
+            }
+        }
+        if (read_ret < -1)
+        {
+            error("ERROR: Failed to extract read from %s", path.c_str());
+        }
+        close();
+        mate_requests_.clear();
+        mate_requests_by_fragment_.clear();
+    }
+
+    std::string path;
+    std::string index_path;
+    std::string reference;
+
+    htsFile* hts_file_ptr_ = nullptr;
+    bam_hdr_t* hts_bam_hdr_ptr_ = nullptr;
+    bam1_t* hts_bam_align_ptr_ = nullptr;
+
+    // mate lookups when the file has an index
+    std::unique_ptr<BamReader> mate_reader_;
+
+    std::vector<SweepRegion> regions_;
+    std::vector<SweepTarget> targets_;
+
+    // regions sorted by start, regions before next_region_ were activated
+    std::vector<std::size_t> region_order_;
+    std::size_t next_region_ = 0;
+    // regions the sweep is in
+    std::vector<std::size_t> active_regions_;
+
+    int last_tid_ = -1;
+    int64_t last_pos_ = -1;
+    bool started_ = false;
+    bool finished_ = false;
+
+    std::vector<MateRequest> mate_requests_;
+    std::unordered_map<std::string, std::vector<std::size_t>> mate_requests_by_fragment_;
+
+    // targets which have all their reads
+    std::deque<std::size_t> completed_;
+};
+
+ReadSweep::ReadSweep(const std::string& path, const std::string& index_path, const std::string& reference)
+    : _impl(new ReadSweepImpl())
+{
+    assertFileExists(path);
+    assertFileExists(reference);
+    assertFileExists(reference + ".fai");
+    _impl->path = path;
+    _impl->index_path = index_path;
+    _impl->reference = reference;
+    _impl->open();
+    if (_impl->hasIndex())
+    {
+        _impl->mate_reader_.reset(new BamReader(path, index_path, reference));
+    }
+    else
+    {
+        LOG()->info("No index for {}, mates outside the target regions are recovered in a second pass", path);
+    }
+}
+
+ReadSweep::~ReadSweep() = default;
+
+std::size_t ReadSweep::addTarget(
+    std::list<Region> const& target_regions, int max_num_reads, unsigned longest_alt_insertion,
+    int avr_fragment_length, bool recover_mates)
+{
+    if (_impl->started_)
+    {
+        error("ERROR: Cannot add targets to a sweep which has started already");
+    }
+    const std::size_t target = _impl->targets_.size();
+    _impl->targets_.emplace_back();
+    ReadSweepImpl::SweepTarget& sweep_target = _impl->targets_.back();
+    sweep_target.max_num_reads = max_num_reads;
+    sweep_target.longest_alt_insertion = longest_alt_insertion;
+    sweep_target.recover_mates = recover_mates;
+
+    for (const auto& region : target_regions)
+    {
+        const std::string extended_region
+            = region.getExtendedRegion(static_cast<int64_t>(avr_fragment_length * 3));
+        _impl->regions_.emplace_back();
+        ReadSweepImpl::SweepRegion& sweep_region = _impl->regions_.back();
+        sweep_region.target = target;
+        sweep_region.region = region;
+
+        const char* contig_end = hts_parse_reg(extended_region.c_str(), &sweep_region.beg, &sweep_region.end);
+        if (contig_end != nullptr)
+        {
+            const std::string contig(extended_region.c_str(), contig_end);
+            sweep_region.tid = bam_name2id(_impl->hts_bam_hdr_ptr_, contig.c_str());
+        }
+        if (sweep_region.tid < 0)
+        {
+            error("Failed to jump to %s in %s", extended_region.c_str(), _impl->path.c_str());
+        }
+        sweep_target.regions.push_back(_impl->regions_.size() - 1);
+    }
+    sweep_target.unfinished_regions = sweep_target.regions.size();
+    if (sweep_target.regions.empty())
+    {
+        _impl->completed_.push_back(target);
+    }
+    return target;
+}
+
+bool ReadSweep::next(std::size_t& target, ReadBuffer& reads)
+{
+    if (!_impl->started_)
+    {
+        _impl->start();
+    }
+    while (_impl->completed_.empty() && !_impl->finished_)
+    {
+        if (!_impl->sweepRecord())
+        {
+            _impl->finishSweep();
+        }
+    }
+    if (_impl->completed_.empty())
+    {
+        return false;
+    }
+
+    target = _impl->completed_.front();
+    _impl->completed_.pop_front();
+    reads.clear();
+    for (const std::size_t r : _impl->targets_[target].regions)
+    {
+        ReadBuffer& region_reads = _impl->regions_[r].reads;
+        std::move(region_reads.begin(), region_reads.end(), std::back_inserter(reads));
+        ReadBuffer().swap(region_reads);
+    }
+    return true;
+}
+}
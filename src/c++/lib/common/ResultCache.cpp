@@ -0,0 +1,133 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Result cache implementation
+ *
+ * \file ResultCache.cpp
+ *
+ */
+
+#include "common/ResultCache.hh"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <htslib/hts.h>
+#include <unistd.h>
+
+#include "grm/Version.hh"
+
+#include "common/Error.hh"
+
+namespace common
+{
+
+CacheKey::CacheKey() { add("version", GRM_VERSION); }
+
+CacheKey& CacheKey::add(std::string const& name, std::string const& value)
+{
+    // length prefixes keep different sequences of values from producing the same data
+    data_ += name + ":" + std::to_string(value.size()) + ":" + value + "\n";
+    return *this;
+}
+
+CacheKey& CacheKey::addFile(std::string const& name, std::string const& path)
+{
+    if (path.empty())
+    {
+        return add(name, path);
+    }
+    if (path.find("://") != std::string::npos)
+    {
+        // remote files: the URL is all we can cheaply identify them by
+        return add(name, path);
+    }
+    const boost::filesystem::path absolute = boost::filesystem::absolute(path);
+    return add(
+        name,
+        absolute.string() + "|" + std::to_string(boost::filesystem::file_size(absolute)) + "|"
+            + std::to_string(boost::filesystem::last_write_time(absolute)));
+}
+
+std::string CacheKey::digest() const
+{
+    hts_md5_context* md5 = hts_md5_init();
+    if (md5 == nullptr)
+    {
+        error("ERROR: Failed to initialise MD5");
+    }
+    hts_md5_update(md5, data_.data(), static_cast<unsigned long>(data_.size()));
+    unsigned char digest[16];
+    hts_md5_final(digest, md5);
+    hts_md5_destroy(md5);
+    char hex[33];
+    hts_md5_hex(hex, digest);
+    return std::string(hex);
+}
+
+ResultCache::ResultCache(std::string const& directory)
+    : directory_(directory)
+{
+    if (enabled())
+    {
+        boost::filesystem::create_directories(directory_);
+    }
+}
+
+std::string ResultCache::path(std::string const& key) const
+{
+    // two-level layout to keep directories small
+    return (boost::filesystem::path(directory_) / key.substr(0, 2) / (key + ".json")).string();
+}
+
+bool ResultCache::get(std::string const& key, std::string& value) const
+{
+    std::ifstream entry(path(key), std::ios::binary);
+    if (!entry)
+    {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << entry.rdbuf();
+    value = contents.str();
+    return true;
+}
+
+void ResultCache::put(std::string const& key, std::string const& value) const
+{
+    const boost::filesystem::path entryPath(path(key));
+    boost::filesystem::create_directories(entryPath.parent_path());
+
+    std::ostringstream temporaryName;
+    temporaryName << entryPath.string() << ".tmp." << ::getpid() << "." << std::this_thread::get_id();
+    const std::string temporaryPath = temporaryName.str();
+    {
+        std::ofstream entry(temporaryPath, std::ios::binary);
+        entry << value;
+        if (!entry.flush())
+        {
+            error("ERROR: Failed to write cache entry '%s'", temporaryPath.c_str());
+        }
+    }
+    boost::filesystem::rename(temporaryPath, entryPath);
+}
+}
@@ -0,0 +1,459 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief On-disk k-mer index of unmapped and low-MAPQ reads
+ *
+ * \file UnmappedReadIndex.cpp
+ *
+ */
+
+#include "common/UnmappedReadIndex.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <unistd.h>
+
+extern "C" {
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+};
+
+#include "common/BamReader.hh"
+#include "HtsHelpers.hh"
+#include "graphutils/SequenceOperations.hh"
+#include "oligo/KmerGenerator.hh"
+
+#include "common/Error.hh"
+
+namespace common
+{
+
+namespace
+{
+    typedef oligo::KmerGenerator<UnmappedReadIndex::kKmerLength, unsigned, std::string::const_iterator> KmerGenerator;
+
+    const char kMagic[8] = { 'P', 'R', 'G', 'U', 'M', 'I', '0', '3' };
+
+    // k-mers which occur in more reads than this are repeats and don't help to find insertion reads
+    const size_t kMaxKmerReads = 1000;
+    // minimum number of k-mers a read must share with the sequences to be recruited
+    const unsigned kMinKmerHits = 2;
+
+    struct Entry
+    {
+        uint32_t kmer;
+        uint32_t read;
+        bool operator<(Entry const& rhs) const { return kmer < rhs.kmer || (kmer == rhs.kmer && read < rhs.read); }
+    };
+
+    struct CompareKmer
+    {
+        bool operator()(Entry const& entry, uint32_t kmer) const { return entry.kmer < kmer; }
+        bool operator()(uint32_t kmer, Entry const& entry) const { return kmer < entry.kmer; }
+    };
+
+    /**
+     * Fixed-size part of the file header, followed by the source description
+     */
+    struct Header
+    {
+        char magic[8];
+        uint32_t kmer_length;
+        uint32_t stride;
+        int32_t min_mapq;
+        uint32_t source_length;
+        uint64_t num_reads;
+        uint64_t num_entries;
+        uint64_t entries_offset;
+        uint64_t read_offsets_offset;
+    };
+
+    /**
+     * @return description of the input files, the index is rebuilt when it changes
+     */
+    std::string describeSource(std::vector<std::string> const& paths)
+    {
+        std::ostringstream source;
+        for (const auto& path : paths)
+        {
+            source << boost::filesystem::absolute(path).string() << "\t" << boost::filesystem::file_size(path) << "\t"
+                   << boost::filesystem::last_write_time(path) << "\n";
+        }
+        return source.str();
+    }
+
+    template <typename T> void writeValue(std::ostream& out, T const& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T> void readValue(std::istream& in, T& value)
+    {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    void writeString(std::ostream& out, std::string const& value)
+    {
+        writeValue(out, static_cast<uint32_t>(value.size()));
+        out.write(value.data(), value.size());
+    }
+
+    void readString(std::istream& in, std::string& value)
+    {
+        uint32_t length = 0;
+        readValue(in, length);
+        value.resize(length);
+        in.read(&value[0], length);
+    }
+
+    void writeRead(std::ostream& out, Read const& read)
+    {
+        writeString(out, read.fragment_id());
+        writeString(out, read.bases());
+        writeString(out, read.quals());
+        writeString(out, read.read_group());
+        const uint8_t flags = (read.is_mapped() ? 1 : 0) | (read.is_first_mate() ? 2 : 0)
+            | (read.is_mate_mapped() ? 4 : 0) | (read.is_reverse_strand() ? 8 : 0)
+            | (read.is_mate_reverse_strand() ? 16 : 0);
+        writeValue(out, flags);
+        writeValue(out, static_cast<int32_t>(read.chrom_id()));
+        writeValue(out, static_cast<int32_t>(read.pos()));
+        writeValue(out, static_cast<int32_t>(read.mapq()));
+        writeValue(out, static_cast<int32_t>(read.mate_chrom_id()));
+        writeValue(out, static_cast<int32_t>(read.mate_pos()));
+    }
+
+    void readRead(std::istream& in, Read& read)
+    {
+        std::string value;
+        readString(in, value);
+        read.set_fragment_id(value);
+        readString(in, value);
+        read.set_bases(value);
+        readString(in, value);
+        read.set_quals(value);
+        readString(in, value);
+        read.set_read_group(value);
+        uint8_t flags = 0;
+        readValue(in, flags);
+        read.set_is_mapped((flags & 1) != 0);
+        read.set_is_first_mate((flags & 2) != 0);
+        read.set_is_mate_mapped((flags & 4) != 0);
+        read.set_is_reverse_strand((flags & 8) != 0);
+        read.set_is_mate_reverse_strand((flags & 16) != 0);
+        int32_t number = 0;
+        readValue(in, number);
+        read.set_chrom_id(number);
+        readValue(in, number);
+        read.set_pos(number);
+        readValue(in, number);
+        read.set_mapq(static_cast<uint8_t>(number));
+        readValue(in, number);
+        read.set_mate_chrom_id(number);
+        readValue(in, number);
+        read.set_mate_pos(number);
+    }
+
+    /**
+     * Read the header and source description
+     * @return false if the file is not an index
+     */
+    bool readHeader(std::istream& in, Header& header, std::string& source)
+    {
+        readValue(in, header);
+        if (!in || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+            || header.kmer_length != UnmappedReadIndex::kKmerLength || header.stride != UnmappedReadIndex::kStride)
+        {
+            return false;
+        }
+        source.resize(header.source_length);
+        in.read(&source[0], header.source_length);
+        return static_cast<bool>(in);
+    }
+
+    /**
+     * Add the reads to index from one BAM / CRAM file. Aligners place unmapped reads at the position of their
+     * mapped mate, so the whole file is read rather than only its unplaced reads.
+     */
+    void indexFile(
+        std::string const& path, std::string const& reference, int min_mapq, std::ostream& out,
+        std::vector<uint64_t>& read_offsets, std::vector<Entry>& entries)
+    {
+        htsFile* file = sam_open(path.c_str(), "r");
+        if (file == nullptr)
+        {
+            error("ERROR: Failed to open %s", path.c_str());
+        }
+        if (hts_set_fai_filename(file, (reference + ".fai").c_str()) != 0)
+        {
+            error("ERROR: Failed to use reference %s for %s", reference.c_str(), path.c_str());
+        }
+        bam_hdr_t* header = sam_hdr_read(file);
+        if (header == nullptr)
+        {
+            error("ERROR: Failed to read header of %s", path.c_str());
+        }
+
+        bam1_t* record = bam_init1();
+        Read read;
+        int read_ret = 0;
+        while ((read_ret = sam_read1(file, header, record)) >= 0)
+        {
+            const auto flag = record->core.flag;
+            if ((flag & (BamReader::kSupplementaryAlign | BamReader::kSecondaryAlign)) != 0
+                || ((flag & BamReader::kIsMapped) == 0 && record->core.qual >= min_mapq))
+            {
+                continue;
+            }
+            decodeHtsAlign(record, read);
+            if (read.bases().size() < UnmappedReadIndex::kKmerLength)
+            {
+                continue;
+            }
+            if (read_offsets.size() == std::numeric_limits<uint32_t>::max())
+            {
+                error("ERROR: Too many unmapped reads in %s", path.c_str());
+            }
+            const auto read_index = static_cast<uint32_t>(read_offsets.size());
+            read_offsets.push_back(static_cast<uint64_t>(out.tellp()));
+            writeRead(out, read);
+
+            KmerGenerator generator(read.bases().begin(), read.bases().end());
+            unsigned kmer = 0;
+            std::string::const_iterator position;
+            while (generator.next(kmer, position))
+            {
+                if ((position - read.bases().begin()) % UnmappedReadIndex::kStride == 0)
+                {
+                    entries.push_back(Entry{ kmer, read_index });
+                }
+            }
+        }
+        if (read_ret < -1)
+        {
+            error("ERROR: Failed to extract read from %s", path.c_str());
+        }
+
+        bam_destroy1(record);
+        bam_hdr_destroy(header);
+        sam_close(file);
+    }
+}
+
+struct UnmappedReadIndex::UnmappedReadIndexImpl
+{
+    std::string index_file;
+    // the k-mer table and read offsets are used in place from the mapped file
+    boost::iostreams::mapped_file_source file;
+    const Entry* entries = nullptr;
+    size_t num_entries = 0;
+    const uint64_t* read_offsets = nullptr;
+    size_t num_reads = 0;
+};
+
+std::unique_ptr<UnmappedReadIndex> UnmappedReadIndex::open(
+    std::vector<std::string> const& paths, std::string const& reference, std::string const& index_file, int min_mapq)
+{
+    bool up_to_date = false;
+    {
+        std::ifstream in(index_file, std::ios::binary);
+        Header header;
+        std::string source;
+        up_to_date = in && readHeader(in, header, source) && header.min_mapq == min_mapq
+            && source == describeSource(paths);
+    }
+    if (!up_to_date)
+    {
+        build(paths, reference, index_file, min_mapq);
+    }
+    return std::unique_ptr<UnmappedReadIndex>(new UnmappedReadIndex(index_file));
+}
+
+void UnmappedReadIndex::build(
+    std::vector<std::string> const& paths, std::string const& reference, std::string const& index_file, int min_mapq)
+{
+    LOG()->info("Building unmapped read index {}", index_file);
+    const std::string source = describeSource(paths);
+    std::ostringstream temporary_name;
+    temporary_name << index_file << ".tmp." << ::getpid() << "." << std::this_thread::get_id();
+    const std::string temporary_path = temporary_name.str();
+    {
+        std::ofstream out(temporary_path, std::ios::binary);
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.kmer_length = kKmerLength;
+        header.stride = kStride;
+        header.min_mapq = min_mapq;
+        header.source_length = static_cast<uint32_t>(source.size());
+        writeValue(out, header);
+        out.write(source.data(), source.size());
+
+        std::vector<uint64_t> read_offsets;
+        std::vector<Entry> entries;
+        for (size_t i = 0; i != paths.size(); ++i)
+        {
+            indexFile(paths[i], reference, min_mapq, out, read_offsets, entries);
+        }
+        std::sort(entries.begin(), entries.end());
+
+        // align the tables so they can be used in place when the file is mapped
+        while (static_cast<uint64_t>(out.tellp()) % sizeof(uint64_t) != 0)
+        {
+            out.put(0);
+        }
+        header.num_reads = read_offsets.size();
+        header.num_entries = entries.size();
+        header.entries_offset = static_cast<uint64_t>(out.tellp());
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+        header.read_offsets_offset = static_cast<uint64_t>(out.tellp());
+        out.write(reinterpret_cast<const char*>(read_offsets.data()), read_offsets.size() * sizeof(uint64_t));
+        out.seekp(0);
+        writeValue(out, header);
+        if (!out.flush())
+        {
+            error("ERROR: Failed to write unmapped read index '%s'", temporary_path.c_str());
+        }
+        LOG()->info("Indexed {} unmapped and low-MAPQ reads in {}", read_offsets.size(), index_file);
+    }
+    boost::filesystem::rename(temporary_path, index_file);
+}
+
+UnmappedReadIndex::UnmappedReadIndex(std::string const& index_file)
+    : _impl(new UnmappedReadIndexImpl())
+{
+    _impl->index_file = index_file;
+    std::ifstream in(index_file, std::ios::binary);
+    Header header;
+    std::string source;
+    if (!in || !readHeader(in, header, source))
+    {
+        error("ERROR: '%s' is not an unmapped read index", index_file.c_str());
+    }
+    in.seekg(0, std::ios::end);
+    const auto file_size = static_cast<uint64_t>(in.tellg());
+    if (header.entries_offset % sizeof(uint64_t) != 0 || header.read_offsets_offset % sizeof(uint64_t) != 0
+        || header.entries_offset + header.num_entries * sizeof(Entry) > file_size
+        || header.read_offsets_offset + header.num_reads * sizeof(uint64_t) > file_size)
+    {
+        error("ERROR: Unmapped read index '%s' is truncated", index_file.c_str());
+    }
+
+    try
+    {
+        _impl->file.open(index_file);
+    }
+    catch (std::exception const& e)
+    {
+        error("ERROR: Failed to map unmapped read index '%s': %s", index_file.c_str(), e.what());
+    }
+    _impl->entries = reinterpret_cast<const Entry*>(_impl->file.data() + header.entries_offset);
+    _impl->num_entries = header.num_entries;
+    _impl->read_offsets = reinterpret_cast<const uint64_t*>(_impl->file.data() + header.read_offsets_offset);
+    _impl->num_reads = header.num_reads;
+}
+
+UnmappedReadIndex::~UnmappedReadIndex() = default;
+
+size_t UnmappedReadIndex::numReads() const { return _impl->num_reads; }
+
+size_t
+UnmappedReadIndex::recruitReads(std::vector<std::string> const& sequences, size_t max_num_reads, ReadBuffer& reads) const
+{
+    std::unordered_map<uint32_t, unsigned> kmer_hits;
+    for (const auto& sequence : sequences)
+    {
+        for (const auto& strand : { sequence, graphtools::reverseComplement(sequence) })
+        {
+            if (strand.size() < kKmerLength)
+            {
+                continue;
+            }
+            KmerGenerator generator(strand.begin(), strand.end());
+            unsigned kmer = 0;
+            std::string::const_iterator position;
+            while (generator.next(kmer, position))
+            {
+                const auto range
+                    = std::equal_range(_impl->entries, _impl->entries + _impl->num_entries, kmer, CompareKmer());
+                if (static_cast<size_t>(range.second - range.first) > kMaxKmerReads)
+                {
+                    continue;
+                }
+                for (auto entry = range.first; entry != range.second; ++entry)
+                {
+                    ++kmer_hits[entry->read];
+                }
+            }
+        }
+    }
+
+    // reads with the most shared k-mers first
+    std::vector<std::pair<unsigned, uint32_t>> candidates;
+    for (const auto& hits : kmer_hits)
+    {
+        if (hits.second >= kMinKmerHits)
+        {
+            candidates.emplace_back(hits.second, hits.first);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](std::pair<unsigned, uint32_t> const& a,
+                                                       std::pair<unsigned, uint32_t> const& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    if (candidates.empty())
+    {
+        return 0;
+    }
+
+    std::unordered_set<std::string> known_reads;
+    for (const auto& read : reads)
+    {
+        known_reads.insert(read->fragment_id() + (read->is_first_mate() ? "/1" : "/2"));
+    }
+    std::ifstream in(_impl->index_file, std::ios::binary);
+    size_t num_added = 0;
+    for (auto candidate = candidates.begin(); candidate != candidates.end() && num_added < max_num_reads; ++candidate)
+    {
+        p_Read read(new Read());
+        in.seekg(_impl->read_offsets[candidate->second]);
+        readRead(in, *read);
+        if (!in)
+        {
+            error("ERROR: Failed to read from unmapped read index '%s'", _impl->index_file.c_str());
+        }
+        if (known_reads.insert(read->fragment_id() + (read->is_first_mate() ? "/1" : "/2")).second)
+        {
+            reads.emplace_back(std::move(read));
+            ++num_added;
+        }
+    }
+    return num_added;
+}
+}
@@ -24,6 +24,7 @@
 #include <boost/math/distributions/poisson.hpp>
 #include <boost/math/special_functions/binomial.hpp>
 #include <cmath>
+#include <functional>
 #include <limits>
 #include <math.h>
 #include <numeric>
@@ -40,34 +41,44 @@ namespace genotyping
  * @param genotype_parameters GenotypeParameter class
  */
 BreakpointGenotyper::BreakpointGenotyper(std::unique_ptr<GenotypingParameters> const& param)
-    : n_alleles_(param->numAlleles())
-    , ploidy_(param->ploidy())
-    , coverage_test_cutoff_(param->coverageTestCutoff())
-    , min_pass_gq_(param->minPassGQ())
-    , min_overlap_bases_(param->minOverlapBases())
-    , possible_genotypes(param->possibleGenotypes())
+    : BreakpointGenotyper(*param)
 {
-    if (param->alleleErrorRates().empty())
+}
+
+/**
+ * @param genotype_parameters GenotypeParameter class
+ */
+BreakpointGenotyper::BreakpointGenotyper(GenotypingParameters const& param)
+    : n_alleles_(param.numAlleles())
+    , ploidy_(param.ploidy())
+    , coverage_test_cutoff_(param.coverageTestCutoff())
+    , min_pass_gq_(param.minPassGQ())
+    , min_overlap_bases_(param.minOverlapBases())
+    , possible_genotypes(param.possibleGenotypes())
+    , pruned_search_(param.numPossibleGenotypes() > param.maxExhaustiveGenotypes())
+    , min_supported_allele_fraction_(param.minSupportedAlleleFraction())
+{
+    if (param.alleleErrorRates().empty())
     {
-        allele_error_rate_.push_back(param->otherAlleleErrorRate());
+        allele_error_rate_.push_back(param.otherAlleleErrorRate());
     }
     else
     {
-        allele_error_rate_ = param->alleleErrorRates();
+        allele_error_rate_ = param.alleleErrorRates();
     }
 
-    if (param->hetHaplotypeFractions().empty())
+    if (param.hetHaplotypeFractions().empty())
     {
-        haplotype_read_fraction_.push_back(param->otherHetHaplotypeFraction());
+        haplotype_read_fraction_.push_back(param.otherHetHaplotypeFraction());
     }
     else
     {
-        haplotype_read_fraction_ = param->hetHaplotypeFractions();
+        haplotype_read_fraction_ = param.hetHaplotypeFractions();
     }
 
-    if (!param->genotypeFractions().empty())
+    if (!param.genotypeFractions().empty())
     {
-        genotype_prior_ = param->genotypeFractions();
+        genotype_prior_ = param.genotypeFractions();
         for (auto& phi : genotype_prior_)
         {
             if (phi.first.size() < ploidy_)
@@ -80,6 +91,42 @@ BreakpointGenotyper::BreakpointGenotyper(std::unique_ptr<GenotypingParameters> c
             }
             phi.second = log(phi.second);
         }
+        // the parameters only complete the genotype fractions for genotypes they enumerate
+        other_genotype_log_prior_ = log(param.otherGenotypeFraction());
+    }
+
+    max_allele_copies_ = n_alleles_ > 0 ? ploidy_ : 0;
+    if (!pruned_search_)
+    {
+        genotype_allele_copies_.resize(possible_genotypes.size() * n_alleles_, 0);
+        genotype_log_prior_.reserve(possible_genotypes.size());
+        for (size_t gt_index = 0; gt_index < possible_genotypes.size(); ++gt_index)
+        {
+            const auto& gv = possible_genotypes[gt_index];
+            for (const auto g : gv)
+            {
+                if (g < n_alleles_)
+                {
+                    ++genotype_allele_copies_[gt_index * n_alleles_ + g];
+                }
+            }
+            const auto prior = genotype_prior_.find(gv);
+            genotype_log_prior_.push_back(prior == genotype_prior_.end() ? other_genotype_log_prior_ : prior->second);
+        }
+    }
+
+    // no copies -> all reads supporting this allele will be errors
+    allele_rate_factors_.resize(n_alleles_ * (max_allele_copies_ + 1));
+    for (unsigned int al = 0; al < n_alleles_; ++al)
+    {
+        const double eps = (allele_error_rate_.size() == 1 ? allele_error_rate_[0] : allele_error_rate_[al]);
+        const double mu
+            = (haplotype_read_fraction_.size() == 1 ? haplotype_read_fraction_[0] : haplotype_read_fraction_[al]);
+        allele_rate_factors_[al * (max_allele_copies_ + 1)] = eps;
+        for (unsigned int copies = 1; copies <= max_allele_copies_; ++copies)
+        {
+            allele_rate_factors_[al * (max_allele_copies_ + 1) + copies] = copies * mu;
+        }
     }
 };
 
@@ -109,17 +156,22 @@ Genotype BreakpointGenotyper::genotype(
     // compute GL and GT
     double best_gl = -std::numeric_limits<double>::max();
 
-    for (const auto& igt : possible_genotypes)
+    if (pruned_search_)
+    {
+        prunedGenotypeLikelihoods(lambda, read_counts_per_allele, result.gl_name, result.gl);
+    }
+    else
+    {
+        genotypeLikelihoods(lambda, read_counts_per_allele, result.gl);
+        result.gl_name = possible_genotypes;
+    }
+    for (size_t gt_index = 0; gt_index < result.gl.size(); ++gt_index)
     {
-        const double gl = genotypeLikelihood(lambda, igt, read_counts_per_allele);
-        result.gl_name.push_back(igt);
-        result.gl.push_back(gl);
-
         // update GT if GL is better
-        if (gl > best_gl)
+        if (result.gl[gt_index] > best_gl)
         {
-            best_gl = gl;
-            result.gt = igt;
+            best_gl = result.gl[gt_index];
+            result.gt = result.gl_name[gt_index];
         }
     }
 
@@ -192,65 +244,162 @@ Genotype BreakpointGenotyper::genotype(
 }
 
 /**
- * return genotype likelihood given genotype (using Poisson model with internal parameters)
+ * Poisson log-pmf of the read count of each allele for each number of copies of that allele
+ *
+ * log Poisson pmf = k * log(rate) - rate - log(k!), so we only evaluate one log-factorial per allele and one
+ * log-rate per allele and copy number, genotype likelihoods are sums of table entries.
+ *
  * @param lambda Poisson distribution parameter
- * @param gv Genotype vector
  * @param read_counts Read count vector for each allele
+ * @param log_pdf output, row-major table of n_alleles_ x (max_allele_copies_ + 1)
  */
-double BreakpointGenotyper::genotypeLikelihood(
-    double lambda, const GenotypeVector& gv, const vector<int32_t>& read_counts) const
+void BreakpointGenotyper::alleleLogPdfs(double lambda, const vector<int32_t>& read_counts, vector<double>& log_pdf) const
 {
-    double log_phi;
-    auto it = genotype_prior_.find(gv);
-    if (it == genotype_prior_.end())
-    {
-        log_phi = 0;
-    }
-    else
-    {
-        log_phi = it->second;
-    }
+    // pmf values below this underflow to zero in double precision, which makes the genotype impossible
+    static const double kMinLogPdf = log(std::numeric_limits<double>::denorm_min());
+    const unsigned int n_copy_states = max_allele_copies_ + 1;
 
-    // compute how many copies of each allele we have in this GT
-    vector<int> allele_ploidy;
-    allele_ploidy.resize(n_alleles_, 0);
+    log_pdf.resize(n_alleles_ * n_copy_states);
     for (unsigned int al = 0; al < n_alleles_; ++al)
     {
-        for (const auto g : gv)
+        const double k = read_counts[al];
+        const double log_k_factorial = std::lgamma(k + 1);
+        for (unsigned int copies = 0; copies < n_copy_states; ++copies)
         {
-            if (al == g)
+            const double rate = lambda * allele_rate_factors_[al * n_copy_states + copies];
+            double value;
+            if (k == 0)
+            {
+                value = -rate;
+            }
+            else if (rate <= 0)
             {
-                ++allele_ploidy[al];
+                value = -std::numeric_limits<double>::infinity();
             }
+            else
+            {
+                value = k * log(rate) - rate - log_k_factorial;
+            }
+            log_pdf[al * n_copy_states + copies]
+                = value < kMinLogPdf ? -std::numeric_limits<double>::infinity() : value;
         }
     }
+}
+
+/**
+ * compute the log-likelihoods of all possible genotypes (using Poisson model with internal parameters)
+ * @param lambda Poisson distribution parameter
+ * @param read_counts Read count vector for each allele
+ * @param gls output, one GL per possible genotype
+ */
+void BreakpointGenotyper::genotypeLikelihoods(
+    double lambda, const vector<int32_t>& read_counts, vector<double>& gls) const
+{
+    vector<double> log_pdf;
+    alleleLogPdfs(lambda, read_counts, log_pdf);
+    const unsigned int n_copy_states = max_allele_copies_ + 1;
 
     // compute GL by summing all allele contributions
-    double gl = log_phi;
+    const size_t n_genotypes = genotype_log_prior_.size();
+    gls.resize(n_genotypes);
+    const unsigned int* copies = genotype_allele_copies_.data();
+    for (size_t gt_index = 0; gt_index < n_genotypes; ++gt_index, copies += n_alleles_)
+    {
+        double gl = genotype_log_prior_[gt_index];
+        for (unsigned int al = 0; al < n_alleles_; ++al)
+        {
+            gl += log_pdf[al * n_copy_states + copies[al]];
+        }
+        gls[gt_index] = std::isinf(gl) ? -std::numeric_limits<double>::max() : gl;
+    }
+}
+
+/**
+ * Genotypes with more than one copy of alleles without read support are less likely than those with one copy by
+ * a factor of about exp(-lambda * het_haplotype_fraction) per extra copy, so we leave them out. GQ is computed
+ * over the genotypes we evaluate.
+ *
+ * @param lambda Poisson distribution parameter
+ * @param read_counts Read count vector for each allele
+ * @param gl_names output, the evaluated genotypes in the order of possible_genotypes
+ * @param gls output, one GL per evaluated genotype
+ */
+void BreakpointGenotyper::prunedGenotypeLikelihoods(
+    double lambda, const vector<int32_t>& read_counts, vector<GenotypeVector>& gl_names, vector<double>& gls) const
+{
+    const int32_t total_num_reads = std::accumulate(read_counts.begin(), read_counts.end(), 0);
+    const int32_t max_num_reads = *std::max_element(read_counts.begin(), read_counts.end());
+    vector<uint64_t> supported_alleles;
+    vector<uint64_t> unsupported_alleles;
     for (unsigned int al = 0; al < n_alleles_; ++al)
     {
-        if (allele_ploidy[al] == 0)
+        if (read_counts[al] > 0
+            && (read_counts[al] >= min_supported_allele_fraction_ * total_num_reads || read_counts[al] == max_num_reads))
         {
-            // no copies -> all reads supporting this allele will be errors
-            const double eps = (allele_error_rate_.size() == 1 ? allele_error_rate_[0] : allele_error_rate_[al]);
-            const poisson_distribution<> error_distribution(lambda * eps);
-            gl += log(pdf(error_distribution, read_counts[al]));
+            supported_alleles.push_back(al);
         }
         else
         {
-            const double mu
-                = (haplotype_read_fraction_.size() == 1 ? haplotype_read_fraction_[0] : haplotype_read_fraction_[al]);
-            const double mu_with_ploidy = allele_ploidy[al] * mu;
-
-            const poisson_distribution<> allele_count_distribution(lambda * mu_with_ploidy);
-            gl += log(pdf(allele_count_distribution, read_counts[al]));
+            unsupported_alleles.push_back(al);
         }
-        if (std::isinf(gl))
+    }
+
+    // all multisets of a given size of supported alleles, in ascending order within each genotype
+    gl_names.clear();
+    const std::function<void(size_t, unsigned int, GenotypeVector&, uint64_t)> addGenotypes
+        = [&](size_t first, unsigned int size, GenotypeVector& prefix, uint64_t extra_allele) {
+              if (size == 0)
+              {
+                  gl_names.push_back(prefix);
+                  if (extra_allele < n_alleles_)
+                  {
+                      auto& gv = gl_names.back();
+                      gv.insert(std::upper_bound(gv.begin(), gv.end(), extra_allele), extra_allele);
+                  }
+                  return;
+              }
+              for (size_t index = first; index < supported_alleles.size(); ++index)
+              {
+                  prefix.push_back(supported_alleles[index]);
+                  addGenotypes(index, size - 1, prefix, extra_allele);
+                  prefix.pop_back();
+              }
+          };
+    GenotypeVector prefix;
+    addGenotypes(0, max_allele_copies_, prefix, n_alleles_);
+    if (max_allele_copies_ > 0)
+    {
+        for (const auto al : unsupported_alleles)
         {
-            return -std::numeric_limits<double>::max();
+            addGenotypes(0, max_allele_copies_ - 1, prefix, al);
         }
     }
+    // possible_genotypes are sorted by the last allele first
+    std::sort(gl_names.begin(), gl_names.end(), [](GenotypeVector const& lhs, GenotypeVector const& rhs) {
+        return std::lexicographical_compare(lhs.rbegin(), lhs.rend(), rhs.rbegin(), rhs.rend());
+    });
 
-    return gl;
+    vector<double> log_pdf;
+    alleleLogPdfs(lambda, read_counts, log_pdf);
+    const unsigned int n_copy_states = max_allele_copies_ + 1;
+
+    gls.resize(gl_names.size());
+    vector<unsigned int> copies(n_alleles_);
+    for (size_t gt_index = 0; gt_index < gl_names.size(); ++gt_index)
+    {
+        const auto& gv = gl_names[gt_index];
+        const auto prior = genotype_prior_.find(gv);
+        double gl = prior == genotype_prior_.end() ? other_genotype_log_prior_ : prior->second;
+        std::fill(copies.begin(), copies.end(), 0);
+        for (const auto g : gv)
+        {
+            ++copies[g];
+        }
+        for (unsigned int al = 0; al < n_alleles_; ++al)
+        {
+            gl += log_pdf[al * n_copy_states + copies[al]];
+        }
+        gls[gt_index] = std::isinf(gl) ? -std::numeric_limits<double>::max() : gl;
+    }
 }
 }
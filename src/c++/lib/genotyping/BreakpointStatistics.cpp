@@ -68,6 +68,8 @@ BreakpointStatistics::BreakpointStatistics(Graph const& graph, NodeId node_id, b
         }
     }
 
+    edge_alleles.resize(edge_names.size());
+
     // create canonical alleles
     std::map<std::string, std::list<std::string>> canonical_allele_to_allele;
     for (const auto& allele : allele_edge_sets)
@@ -91,7 +93,7 @@ BreakpointStatistics::BreakpointStatistics(Graph const& graph, NodeId node_id, b
         const auto this_allele_index = canonical_allele_names.size() - 1;
         for (const auto& edge : allele_edge_sets[canonical_allele_name])
         {
-            edgename_to_alleles[edge].push_back(this_allele_index);
+            edge_alleles[edge_name_to_index[edge]].push_back(this_allele_index);
         }
         for (auto const& noncanonical_allele : canonical_allele.second)
         {
@@ -110,34 +112,49 @@ BreakpointStatistics::BreakpointStatistics(Graph const& graph, NodeId node_id, b
  * @param paragraph_json JSON output from alignAndDisambiguate
  */
 void BreakpointStatistics::addCounts(Json::Value const& paragraph_json)
+{
+    addCounts(paragraph_json, edge_counts, allele_counts);
+}
+
+int32_t BreakpointStatistics::getCount(std::string const& edge_or_allele_name) const
+{
+    return getCount(edge_or_allele_name, edge_counts, allele_counts);
+}
+
+/**
+ * Add edge counts from paragraph output to external count arrays
+ * @param paragraph_json JSON output from alignAndDisambiguate
+ * @param edge_counts counts in the order of edgeNames()
+ * @param allele_counts counts in the order of canonicalAlleleNames()
+ */
+void BreakpointStatistics::addCounts(
+    Json::Value const& paragraph_json, AlleleCounts& edge_counts, AlleleCounts& allele_counts) const
 {
     if (!paragraph_json.isMember("read_counts_by_edge"))
     {
         error("Cannot find key read_counts_by_edge in JSON");
     }
-    for (auto const& edge_name : edge_names)
+    auto const& read_counts_by_edge = paragraph_json["read_counts_by_edge"];
+    for (size_t edge_index = 0; edge_index < edge_names.size(); ++edge_index)
     {
-        const auto e_it = edge_name_to_index.find(edge_name);
-        assert(e_it != edge_name_to_index.end());
-        const int this_edge_count = paragraph_json["read_counts_by_edge"].isMember(edge_name)
-            ? paragraph_json["read_counts_by_edge"][edge_name].asInt()
-            : 0;
+        auto const* edge_count = read_counts_by_edge.find(
+            edge_names[edge_index].data(), edge_names[edge_index].data() + edge_names[edge_index].size());
+        const int this_edge_count = edge_count != nullptr ? edge_count->asInt() : 0;
 
         if (this_edge_count == 0)
         {
             continue;
         }
 
-        if (edge_counts.size() <= e_it->second)
+        if (edge_counts.size() <= edge_index)
         {
             edge_counts.resize(edge_names.size(), 0);
-            assert(edge_counts.size() > e_it->second);
         }
 
-        edge_counts[e_it->second] += this_edge_count;
+        edge_counts[edge_index] += this_edge_count;
 
         // add counts for canonical alleles also
-        for (const auto& allele : edgename_to_alleles[edge_name])
+        for (const auto& allele : edge_alleles[edge_index])
         {
             if (allele_counts.size() <= allele)
             {
@@ -149,29 +166,39 @@ void BreakpointStatistics::addCounts(Json::Value const& paragraph_json)
     }
 }
 
-int32_t BreakpointStatistics::getCount(std::string const& edge_or_allele_name) const
+int32_t BreakpointStatistics::getCount(
+    std::string const& edge_or_allele_name, AlleleCounts const& edge_counts, AlleleCounts const& allele_counts) const
+{
+    bool is_edge = false;
+    const int index = countIndex(edge_or_allele_name, is_edge);
+    // unknown edge or allele -- this is allowed since for a complex breakpoint set
+    // we may not see all alleles at all breakpoints
+    if (index < 0)
+    {
+        return 0;
+    }
+    auto const& counts = is_edge ? edge_counts : allele_counts;
+    return static_cast<size_t>(index) >= counts.size() ? 0 : counts[index];
+}
+
+int BreakpointStatistics::countIndex(std::string const& edge_or_allele_name, bool& is_edge) const
 {
     const auto e_it = edge_name_to_index.find(edge_or_allele_name);
     const auto a_it = allele_name_to_index.find(edge_or_allele_name);
-    int32_t result = 0;
     if (e_it != edge_name_to_index.end() && a_it != allele_name_to_index.end())
     {
         error("Allele / sequence name %s is ambiguous with an edge name.", edge_or_allele_name.c_str());
     }
     else if (e_it != edge_name_to_index.end())
     {
-        result = e_it->second >= edge_counts.size() ? 0 : edge_counts[e_it->second];
+        is_edge = true;
+        return static_cast<int>(e_it->second);
     }
     else if (a_it != allele_name_to_index.end())
     {
-        result = a_it->second >= allele_counts.size() ? 0 : allele_counts[a_it->second];
-    }
-    else
-    {
-        // unknown edge or allele -- this is allowed since for a complex breakpoint set
-        // we may not see all alleles at all breakpoints
-        return 0;
+        is_edge = false;
+        return static_cast<int>(a_it->second);
     }
-    return result;
+    return -1;
 }
 }
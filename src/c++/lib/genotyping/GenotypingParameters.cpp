@@ -28,6 +28,7 @@
 #include "genotyping/GenotypingParameters.hh"
 
 #include <algorithm>
+#include <limits>
 
 using std::string;
 using std::vector;
@@ -47,14 +48,37 @@ GenotypingParameters::GenotypingParameters(const vector<string>& _allele_names,
     , other_het_haplotype_fraction(0.5)
     , other_genotype_fraction(1)
     , use_poisson_depth(false)
+    , max_exhaustive_genotypes(256)
+    , min_supported_allele_fraction(0.01)
 {
     setPossibleGenotypes();
 }
 
+uint64_t GenotypingParameters::numPossibleGenotypes() const
+{
+    if (!num_alleles)
+    {
+        return 0;
+    }
+    // (num_alleles + ploidy - 1) choose ploidy, saturated instead of overflowing
+    uint64_t count = 1;
+    for (unsigned int i = 1; i <= ploidy_; ++i)
+    {
+        const uint64_t factor = num_alleles - 1 + i;
+        if (count > std::numeric_limits<uint64_t>::max() / factor)
+        {
+            return std::numeric_limits<uint64_t>::max();
+        }
+        count = count * factor / i;
+    }
+    return count;
+}
+
 void GenotypingParameters::setPossibleGenotypes()
 {
     vector<GenotypeVector> gts;
-    if (num_alleles)
+    // the breakpoint genotyper only evaluates genotypes of supported alleles when there are more
+    if (num_alleles && numPossibleGenotypes() <= max_exhaustive_genotypes)
     {
         // generate all possible GTs (as described in the VCF SPEC)
         const std::function<void(unsigned int, unsigned int, std::vector<uint64_t>)> makeGenotypes
@@ -120,6 +144,19 @@ void GenotypingParameters::setFromJson(Json::Value& param_json)
         {
             ploidy_ = (unsigned int)field.asInt();
         }
+        else if (key == "max_exhaustive_genotypes")
+        {
+            max_exhaustive_genotypes = field.asUInt();
+            setPossibleGenotypes();
+        }
+        else if (key == "min_supported_allele_fraction")
+        {
+            min_supported_allele_fraction = field.asDouble();
+            if (min_supported_allele_fraction < 0 || min_supported_allele_fraction > 1)
+            {
+                error("Error: min_supported_allele_fraction should be between 0~1.");
+            }
+        }
     }
 
     if (param_json.isMember("coverage_test_cutoff"))
@@ -23,6 +23,13 @@
 
 #include "common/Error.hh"
 #include "common/JsonHelpers.hh"
+#include "common/Threads.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 using std::map;
 using std::string;
@@ -31,78 +38,186 @@ using std::vector;
 namespace genotyping
 {
 
-void GraphBreakpointGenotyper::setParameters(const string& genotyping_parameter_path)
+namespace
 {
-    p_genotype_parameter
-        = std::unique_ptr<GenotypingParameters>(new GenotypingParameters(alleleNames(), female_ploidy_));
-    p_male_genotype_parameter
-        = std::unique_ptr<GenotypingParameters>(new GenotypingParameters(alleleNames(), male_ploidy_));
-    if (!genotyping_parameter_path.empty())
+    /**
+     * Most graphs of a run use the same parameter file and often the same allele names, so we keep parsed
+     * parameters and the genotypers derived from them rather than re-reading the file for every graph.
+     */
+    class GenotypingParametersCache
     {
-        Json::Value param_json = common::getJSON(genotyping_parameter_path);
-        p_genotype_parameter->setFromJson(param_json);
-    }
-}
-
-void GraphBreakpointGenotyper::runGenotyping()
-{
-    auto breakpoint_names = breakpointNames();
+    public:
+        struct Entry
+        {
+            std::shared_ptr<const GenotypingParameters> parameters;
+            std::shared_ptr<const BreakpointGenotyper> genotyper;
+        };
 
-    // genotype all breakpoints
-    auto const& allelenames = alleleNames();
-    BreakpointGenotyper genotyper(p_genotype_parameter);
-    BreakpointGenotyper male_genotyper(p_male_genotype_parameter);
-    for (const auto& breakpointname : breakpoint_names)
-    {
-        size_t sample_index = 0;
-        for (const auto& samplename : sampleNames())
+        /**
+         * @param parameter_path path to parameter JSON, empty to use defaults
+         * @param allele_names names of the alleles in the graph
+         * @param ploidy sample ploidy
+         */
+        Entry operator()(string const& parameter_path, vector<string> const& allele_names, unsigned int ploidy)
         {
-            auto const& depth_readlength = getDepthAndReadlength(sample_index);
-            vector<int32_t> counts;
-            counts.reserve(allelenames.size());
-            for (const auto& e : allelenames)
+            std::lock_guard<std::mutex> write_lock(write_mutex);
+            const auto key = std::make_tuple(parameter_path, allele_names, ploidy);
+            auto it = cache.find(key);
+            if (it != cache.end())
             {
-                counts.push_back(getCount(sample_index, breakpointname, e));
+                return it->second;
             }
-            auto sample_ploidy = getSamplePloidy(sample_index);
-            double expected_depth = depth_readlength.first * ((double)sample_ploidy / female_ploidy_);
-            double depth_sd = getDepthSD(sample_index);
-            const BreakpointGenotyperParameter b_param(
-                expected_depth, depth_readlength.second, depth_sd, p_genotype_parameter->usePoissonDepth());
 
-            if (getSamplePloidy(sample_index) == male_ploidy_)
+            // allele names are often specific to a graph, don't let these accumulate
+            static const size_t kMaxCachedParameterSets = 1024;
+            if (cache.size() >= kMaxCachedParameterSets)
             {
-                const auto gt = male_genotyper.genotype(b_param, counts);
-                setGenotype(samplename, breakpointname, gt);
+                cache.clear();
             }
-            else // treat unknown as female
+
+            std::shared_ptr<GenotypingParameters> parameters(new GenotypingParameters(allele_names, ploidy));
+            if (!parameter_path.empty())
             {
-                const auto gt = genotyper.genotype(b_param, counts);
-                setGenotype(samplename, breakpointname, gt);
+                auto json_it = parameter_json.find(parameter_path);
+                if (json_it == parameter_json.end())
+                {
+                    json_it = parameter_json.emplace(parameter_path, common::getJSON(parameter_path)).first;
+                }
+                Json::Value param_json = json_it->second;
+                parameters->setFromJson(param_json);
             }
-            ++sample_index;
+            Entry entry{ parameters, std::make_shared<const BreakpointGenotyper>(*parameters) };
+            cache.emplace(key, entry);
+            return entry;
         }
+
+    private:
+        static std::map<std::tuple<string, vector<string>, unsigned int>, Entry> cache;
+        static std::map<string, Json::Value> parameter_json;
+        static std::mutex write_mutex;
+    };
+
+    std::map<std::tuple<string, vector<string>, unsigned int>, GenotypingParametersCache::Entry>
+        GenotypingParametersCache::cache;
+    std::map<string, Json::Value> GenotypingParametersCache::parameter_json;
+    std::mutex GenotypingParametersCache::write_mutex;
+}
+
+void GraphBreakpointGenotyper::setParameters(const string& genotyping_parameter_path)
+{
+    GenotypingParametersCache cache;
+    const auto female_entry = cache(genotyping_parameter_path, alleleNames(), female_ploidy_);
+    p_genotype_parameter = female_entry.parameters;
+    p_genotyper = female_entry.genotyper;
+
+    // male parameters don't take values from the parameter file
+    const auto male_entry = cache(string(), alleleNames(), male_ploidy_);
+    p_male_genotype_parameter = male_entry.parameters;
+    p_male_genotyper = male_entry.genotyper;
+}
+
+template <typename MakeState, typename Work>
+void GraphBreakpointGenotyper::parallelFor(size_t num_items, MakeState make_state, Work work) const
+{
+    // large enough to keep the shared counter out of the way, small enough to balance load across threads
+    static const size_t kItemsPerChunk = 16;
+    std::atomic<size_t> next_item(0);
+    const auto processChunks = [&]() {
+        auto state = make_state();
+        for (size_t begin = next_item.fetch_add(kItemsPerChunk); begin < num_items;
+             begin = next_item.fetch_add(kItemsPerChunk))
+        {
+            work(state, begin, std::min(num_items, begin + kItemsPerChunk));
+        }
+    };
+    const auto num_chunks = (num_items + kItemsPerChunk - 1) / kItemsPerChunk;
+    if (threads_ > 1 && num_chunks > 1)
+    {
+        common::CPU_THREADS(threads_).execute(
+            processChunks, static_cast<unsigned>(std::min<size_t>(threads_, num_chunks)));
     }
+    else
+    {
+        processChunks();
+    }
+}
+
+void GraphBreakpointGenotyper::runGenotyping()
+{
+    auto const& breakpoint_names = breakpointNames();
+    auto const& sample_names = sampleNames();
+    auto const& allelenames = alleleNames();
+    const size_t num_samples = sample_names.size();
+
+    // genotype all breakpoints. The cached genotypers are shared, each thread only needs its own read counts.
+    const auto makeCounts = []() { return vector<int32_t>(); };
+
+    // genotypes for each breakpoint and sample, written into their own slots
+    vector<Genotype> breakpoint_genotypes(breakpoint_names.size() * num_samples);
+    parallelFor(
+        breakpoint_genotypes.size(), makeCounts,
+        [this, num_samples, &breakpoint_genotypes](vector<int32_t>& counts, size_t begin, size_t end) {
+            for (size_t index = begin; index < end; ++index)
+            {
+                const size_t breakpoint_index = index / num_samples;
+                const size_t sample_index = index % num_samples;
+                auto const& depth_readlength = getDepthAndReadlength(sample_index);
+                getAlleleCounts(sample_index, breakpoint_index, counts);
+                auto sample_ploidy = getSamplePloidy(sample_index);
+                double expected_depth = depth_readlength.first * ((double)sample_ploidy / female_ploidy_);
+                double depth_sd = getDepthSD(sample_index);
+                const BreakpointGenotyperParameter b_param(
+                    expected_depth, depth_readlength.second, depth_sd, p_genotype_parameter->usePoissonDepth());
+
+                if (sample_ploidy == male_ploidy_)
+                {
+                    breakpoint_genotypes[index] = p_male_genotyper->genotype(b_param, counts);
+                }
+                else // treat unknown as female
+                {
+                    breakpoint_genotypes[index] = p_genotyper->genotype(b_param, counts);
+                }
+            }
+        });
 
     // compute combined genotype
-    size_t sample_index = 0;
-    for (const auto& samplename : sampleNames())
+    vector<Genotype> combined_genotypes(num_samples);
+    parallelFor(
+        num_samples, makeCounts,
+        [&](vector<int32_t>&, size_t begin, size_t end) {
+            for (size_t sample_index = begin; sample_index < end; ++sample_index)
+            {
+                GenotypeSet all_breakpoint_gts;
+                for (size_t breakpoint_index = 0; breakpoint_index < breakpoint_names.size(); ++breakpoint_index)
+                {
+                    all_breakpoint_gts.add(
+                        allelenames, breakpoint_genotypes[breakpoint_index * num_samples + sample_index]);
+                }
+                auto const& depth_readlength = getDepthAndReadlength(sample_index);
+                auto depth_sd = getDepthSD(sample_index);
+                const BreakpointGenotyperParameter b_param(
+                    depth_readlength.first, depth_readlength.second, depth_sd,
+                    p_genotype_parameter->usePoissonDepth());
+                combined_genotypes[sample_index]
+                    = combinedGenotype(all_breakpoint_gts, &b_param, p_genotyper.get());
+            }
+        });
+
+    size_t index = 0;
+    for (const auto& breakpointname : breakpoint_names)
     {
-        GenotypeSet all_breakpoint_gts;
-        for (const auto& breakpointname : breakpoint_names)
+        for (const auto& samplename : sample_names)
         {
-            all_breakpoint_gts.add(allelenames, getGenotype(samplename, breakpointname));
+            setGenotype(samplename, breakpointname, std::move(breakpoint_genotypes[index++]));
         }
-        auto const& depth_readlength = getDepthAndReadlength(sample_index);
-        auto depth_sd = getDepthSD(sample_index);
-        const BreakpointGenotyperParameter b_param(
-            depth_readlength.first, depth_readlength.second, depth_sd, p_genotype_parameter->usePoissonDepth());
-        setGenotype(samplename, "", combinedGenotype(all_breakpoint_gts, &b_param, &genotyper));
-        ++sample_index;
+    }
+    for (size_t sample_index = 0; sample_index < num_samples; ++sample_index)
+    {
+        setGenotype(sample_names[sample_index], "", std::move(combined_genotypes[sample_index]));
     }
 }
 
-unsigned int GraphBreakpointGenotyper::getSamplePloidy(size_t sample_index)
+unsigned int GraphBreakpointGenotyper::getSamplePloidy(size_t sample_index) const
 {
     if (getSampleSex(sample_index) == SampleInfo::MALE)
     {
@@ -71,12 +71,15 @@ void GraphGenotyper::reset(Graph const* graph)
     _impl->graph = graph;
 
     // work out allele and edge names
-    const auto bp_map = createBreakpointMap(*_impl->graph);
+    auto bp_map = createBreakpointMap(*_impl->graph);
     set<string> allele_names;
-    for (const auto& bp : bp_map)
+    _impl->breakpoints.reserve(bp_map.size());
+    for (auto& bp : bp_map)
     {
         _impl->breakpointnames.push_back(bp.first);
-        auto const& bp_info = bp.second;
+        _impl->breakpointnameindex[bp.first] = _impl->breakpoints.size();
+        _impl->breakpoints.push_back(std::move(bp.second));
+        auto const& bp_info = _impl->breakpoints.back();
         for (auto const& an : bp_info.canonicalAlleleNames())
         {
             allele_names.insert(an);
@@ -84,6 +87,21 @@ void GraphGenotyper::reset(Graph const* graph)
     }
     _impl->allelenames.resize(allele_names.size());
     std::copy(allele_names.begin(), allele_names.end(), _impl->allelenames.begin());
+
+    // resolve alleles to count arrays once rather than by name for every sample
+    _impl->allele_count_indexes.reserve(_impl->breakpoints.size());
+    for (const auto& breakpoint : _impl->breakpoints)
+    {
+        _impl->allele_count_indexes.emplace_back();
+        auto& indexes = _impl->allele_count_indexes.back();
+        indexes.reserve(_impl->allelenames.size());
+        for (const auto& allele : _impl->allelenames)
+        {
+            bool is_edge = false;
+            const int index = breakpoint.countIndex(allele, is_edge);
+            indexes.emplace_back(is_edge, index);
+        }
+    }
 }
 
 /**
@@ -108,11 +126,16 @@ void GraphGenotyper::addAlignment(SampleInfo const& sampleinfo)
     _impl->samplenames.push_back(samplename);
     _impl->samplenameindex[samplename] = _impl->samplenames.size() - 1;
 
-    // add breakpoint map and counts
-    _impl->breakpoint_maps.push_back(createBreakpointMap(*_impl->graph));
-    for (auto& breakpoint : _impl->breakpoint_maps.back())
+    // add counts
+    _impl->counts.emplace_back(_impl->breakpoints.size());
+    auto& sample_counts = _impl->counts.back();
+    for (size_t breakpoint_index = 0; breakpoint_index < _impl->breakpoints.size(); ++breakpoint_index)
     {
-        breakpoint.second.addCounts(alignment);
+        auto const& breakpoint = _impl->breakpoints[breakpoint_index];
+        auto& breakpoint_counts = sample_counts[breakpoint_index];
+        breakpoint_counts.edge_counts.resize(breakpoint.edgeNames().size(), 0);
+        breakpoint_counts.allele_counts.resize(breakpoint.canonicalAlleleNames().size(), 0);
+        breakpoint.addCounts(alignment, breakpoint_counts.edge_counts, breakpoint_counts.allele_counts);
     }
     _impl->depths.emplace_back(depth, read_length);
     _impl->depth_sds.emplace_back(sampleinfo.depth_sd());
@@ -163,16 +186,16 @@ void GraphGenotyper::addAlignment(SampleInfo const& sampleinfo)
             _impl->basic_info["breakpointinfo"] = Json::arrayValue;
 
             // write edge + allele map
-            const auto& breakpoint_map = _impl->breakpoint_maps.back();
-            for (const auto& breakpoint : breakpoint_map)
+            auto breakpointname = _impl->breakpointnames.begin();
+            for (const auto& breakpoint : _impl->breakpoints)
             {
                 Json::Value value = Json::objectValue;
 
-                value["name"] = breakpoint.first;
+                value["name"] = *breakpointname++;
                 value["mapped_alleles"] = Json::objectValue;
-                for (const auto& allele : breakpoint.second.allAlleleNames())
+                for (const auto& allele : breakpoint.allAlleleNames())
                 {
-                    const auto& canonical_allele = breakpoint.second.getCanonicalAlleleName(allele);
+                    const auto& canonical_allele = breakpoint.getCanonicalAlleleName(allele);
                     if (canonical_allele != allele)
                     {
                         value["mapped_alleles"][allele] = canonical_allele;
@@ -250,16 +273,17 @@ Json::Value GraphGenotyper::getGenotypes()
     for (size_t isample = 0; isample < _impl->samplenames.size(); ++isample)
     {
         const string& samplename = _impl->samplenames[isample];
-        const BreakpointMap& breakpoints = _impl->breakpoint_maps[isample];
 
         // initialize blank GT
         static const std::vector<std::string> no_alleles;
         static const Genotype empty_genotype = Genotype();
 
-        // print breakpoint genotypes (breakpoint_maps doesn't have "" breakpoint)
-        for (const auto& breakpoint : breakpoints)
+        // print breakpoint genotypes (breakpoints doesn't have "" breakpoint)
+        size_t breakpoint_index = 0;
+        for (const auto& breakpointname : _impl->breakpointnames)
         {
-            const std::string& breakpointname = breakpoint.first;
+            const auto& breakpoint = _impl->breakpoints[breakpoint_index];
+            const auto& breakpoint_counts = _impl->counts[isample][breakpoint_index++];
             auto& this_set = genotypeSets[breakpointname];
 
             auto gt_it = _impl->graph_genotypes.find(std::make_pair(samplename, breakpointname));
@@ -272,21 +296,18 @@ Json::Value GraphGenotyper::getGenotypes()
                 breakpoint_json["gt"] = gt_it->second.toJson(allele_names);
 
                 // output read counts
-                const auto breakpoint_it = _impl->breakpoint_maps[isample].find(breakpointname);
-                if (breakpoint_it != _impl->breakpoint_maps[isample].end())
+                breakpoint_json["counts"] = Json::objectValue;
+                breakpoint_json["counts"]["edges"] = Json::objectValue;
+                breakpoint_json["counts"]["alleles"] = Json::objectValue;
+                for (const auto& bp_edgename : breakpoint.edgeNames())
                 {
-                    breakpoint_json["counts"] = Json::objectValue;
-                    breakpoint_json["counts"]["edges"] = Json::objectValue;
-                    breakpoint_json["counts"]["alleles"] = Json::objectValue;
-                    for (const auto& bp_edgename : breakpoint_it->second.edgeNames())
-                    {
-                        breakpoint_json["counts"]["edges"][bp_edgename] = breakpoint_it->second.getCount(bp_edgename);
-                    }
-                    for (const auto& bp_allelename : breakpoint_it->second.canonicalAlleleNames())
-                    {
-                        breakpoint_json["counts"]["alleles"][bp_allelename]
-                            = breakpoint_it->second.getCount(bp_allelename);
-                    }
+                    breakpoint_json["counts"]["edges"][bp_edgename] = breakpoint.getCount(
+                        bp_edgename, breakpoint_counts.edge_counts, breakpoint_counts.allele_counts);
+                }
+                for (const auto& bp_allelename : breakpoint.canonicalAlleleNames())
+                {
+                    breakpoint_json["counts"]["alleles"][bp_allelename] = breakpoint.getCount(
+                        bp_allelename, breakpoint_counts.edge_counts, breakpoint_counts.allele_counts);
                 }
             }
             else
@@ -391,10 +412,33 @@ std::list<std::string> const& GraphGenotyper::breakpointNames() const { return _
 int32_t
 GraphGenotyper::getCount(size_t sample_index, string const& breakpoint, std::string const& edge_or_allele_name) const
 {
-    assert(sample_index < _impl->breakpoint_maps.size());
-    auto bp_it = _impl->breakpoint_maps[sample_index].find(breakpoint);
-    assert(bp_it != _impl->breakpoint_maps[sample_index].end());
-    return bp_it->second.getCount(edge_or_allele_name);
+    assert(sample_index < _impl->counts.size());
+    auto bp_it = _impl->breakpointnameindex.find(breakpoint);
+    assert(bp_it != _impl->breakpointnameindex.end());
+    const auto& breakpoint_counts = _impl->counts[sample_index][bp_it->second];
+    return _impl->breakpoints[bp_it->second].getCount(
+        edge_or_allele_name, breakpoint_counts.edge_counts, breakpoint_counts.allele_counts);
+}
+
+/**
+ * Get the read counts of all alleles on a breakpoint
+ * @param sample_index index of sample (name is in sampleNames[sample_index])
+ * @param breakpoint_index index of the breakpoint in breakpointNames()
+ * @param counts output, one count per allele in alleleNames()
+ */
+void GraphGenotyper::getAlleleCounts(size_t sample_index, size_t breakpoint_index, std::vector<int32_t>& counts) const
+{
+    assert(sample_index < _impl->counts.size() && breakpoint_index < _impl->breakpoints.size());
+    const auto& breakpoint_counts = _impl->counts[sample_index][breakpoint_index];
+    const auto& indexes = _impl->allele_count_indexes[breakpoint_index];
+    counts.resize(indexes.size());
+    for (size_t allele_index = 0; allele_index < indexes.size(); ++allele_index)
+    {
+        const auto& source = indexes[allele_index].first ? breakpoint_counts.edge_counts
+                                                         : breakpoint_counts.allele_counts;
+        const int index = indexes[allele_index].second;
+        counts[allele_index] = index < 0 || static_cast<size_t>(index) >= source.size() ? 0 : source[index];
+    }
 }
 
 /**
@@ -58,9 +58,31 @@ struct GraphGenotyper::GraphGenotyperImpl
     std::vector<SampleInfo::Sex> sexes;
 
     /**
-     *  Read counts for each sample
+     * Breakpoints of the graph in the order of breakpointnames. These only depend on the graph, so we create
+     * them once in reset and keep counts for each sample in separate arrays.
      */
-    std::vector<BreakpointMap> breakpoint_maps;
+    std::vector<BreakpointStatistics> breakpoints;
+
+    /**
+     * breakpoint name -> index
+     */
+    std::unordered_map<std::string, size_t> breakpointnameindex;
+
+    /**
+     * For each breakpoint and each allele in allelenames: index of its count in the edge counts (first = true)
+     * or allele counts (first = false) of the breakpoint, -1 if the allele is not on the breakpoint
+     */
+    std::vector<std::vector<std::pair<bool, int>>> allele_count_indexes;
+
+    /**
+     * Read counts for each sample and breakpoint, by edge and by allele
+     */
+    struct BreakpointCounts
+    {
+        AlleleCounts edge_counts;
+        AlleleCounts allele_counts;
+    };
+    std::vector<std::vector<BreakpointCounts>> counts;
 
     /**
      * Name of each sample
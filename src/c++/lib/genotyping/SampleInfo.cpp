@@ -74,7 +74,8 @@ void SampleInfo::set_sex(std::string sex_string)
  * Load manifest file. A manifest contains
  *
  *  * Sample names
- *  * Sample BAM/CRAM file locations
+ *  * Sample BAM/CRAM file locations, several files of a sample separated by ';'
+ *  * (optionally) read groups of the sample in files shared with other samples, separated by ';'
  *  * Depth estimates, or location of idxdepth output
  *  * (optionally) location of alignment JSON
  *
@@ -107,7 +108,8 @@ Samples loadManifest(const std::string& filename)
             common::stringutil::split(line, header, "\t,");
             static const set<string> legal_header_columns
                 = { "id",    "path",        "index_path", "paragraph",      "idxdepth",
-                    "depth", "read length", "sex",        "depth variance", "depth sd" };
+                    "depth", "read length", "sex",        "depth variance", "depth sd",
+                    "alignment_container", "read_group" };
             size_t j = 0;
             for (auto& h : header)
             {
@@ -160,10 +162,38 @@ Samples loadManifest(const std::string& filename)
             return p.string();
         };
 
-        sid.set_filename(find_file(tokens[header_map["path"]]));
+        // samples split across several files list all of them
+        auto find_files = [&find_file](const std::string& bam_filenames) -> vector<string> {
+            vector<string> paths;
+            common::stringutil::split(bam_filenames, paths, ";");
+            for (auto& path : paths)
+            {
+                path = find_file(path);
+            }
+            return paths;
+        };
+
+        sid.set_filenames(find_files(tokens[header_map["path"]]));
+        if (sid.filenames().empty())
+        {
+            error("Sample %s: no alignment file given", sid.sample_name().c_str());
+        }
         if (header_map.count("index_path") != 0u)
         {
-            sid.set_index_filename(find_file(tokens[header_map["index_path"]]));
+            sid.set_index_filenames(find_files(tokens[header_map["index_path"]]));
+            if (!sid.index_filenames().empty() && sid.index_filenames().size() != sid.filenames().size())
+            {
+                error(
+                    "Sample %s: %d index files given for %d alignment files", sid.sample_name().c_str(),
+                    (int)sid.index_filenames().size(), (int)sid.filenames().size());
+            }
+        }
+
+        if (header_map.count("read_group") != 0u)
+        {
+            vector<string> read_groups;
+            common::stringutil::split(tokens[header_map["read_group"]], read_groups, ";");
+            sid.set_read_groups(read_groups);
         }
 
         double depth = -1;
@@ -194,6 +224,34 @@ Samples loadManifest(const std::string& filename)
             try
             {
                 Json::Value idxdepth_json = common::getJSON(idxdepth_filename);
+                if (!sid.read_groups().empty())
+                {
+                    // the estimates for the whole file include other samples, use the ones for our read groups
+                    if (!idxdepth_json.isMember("read_groups"))
+                    {
+                        error(
+                            "Sample %s: idxdepth output %s has no read group estimates, run idxdepth with "
+                            "--per-read-group",
+                            sid.sample_name().c_str(), idxdepth_filename.c_str());
+                    }
+                    double read_group_depth = 0;
+                    int read_group_read_length = 0;
+                    for (const auto& read_group : sid.read_groups())
+                    {
+                        Json::Value const& read_group_json = idxdepth_json["read_groups"][read_group];
+                        if (!read_group_json.isMember("read_length") || !read_group_json.isMember("autosome"))
+                        {
+                            error(
+                                "Sample %s: no estimate for read group %s in %s", sid.sample_name().c_str(),
+                                read_group.c_str(), idxdepth_filename.c_str());
+                        }
+                        read_group_depth += read_group_json["autosome"]["depth"].asDouble();
+                        read_group_read_length
+                            = std::max(read_group_read_length, read_group_json["read_length"].asInt());
+                    }
+                    idxdepth_json["autosome"]["depth"] = read_group_depth;
+                    idxdepth_json["read_length"] = read_group_read_length;
+                }
                 if (read_length < 0 && idxdepth_json.isMember("read_length"))
                 {
                     read_length = idxdepth_json["read_length"].asInt();
@@ -295,6 +353,10 @@ Samples loadManifest(const std::string& filename)
                 }
             }
         }
+        if (header_map.count("alignment_container") != 0u && !tokens[header_map["alignment_container"]].empty())
+        {
+            sid.set_alignment_container(find_file(tokens[header_map["alignment_container"]]));
+        }
         sampleinfo.push_back(sid);
     }
     return sampleinfo;
@@ -17,6 +17,10 @@
 //
 //
 
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+
 #include <boost/range.hpp>
 
 #include "common/Error.hh"
@@ -63,8 +67,8 @@ template <typename AlignerT> void logAlignerStats(const ValidationAligner<Aligne
  */
 template <typename IteratorT, typename AlignerT>
 static void sequentialAlignReads(
-    const IteratorT begin, IteratorT end, const graphtools::Graph* graph, std::list<graphtools::Path> const& paths,
-    ReadFilter filter, std::vector<common::p_Read>& filtered_reads, AlignerT& aligner)
+    const IteratorT begin, IteratorT end, ReadFilter filter, std::vector<common::p_Read>& filtered_reads,
+    AlignerT& aligner)
 {
     auto logger = LOG();
     logger->info("[Aligning {} reads]", std::distance(begin, end));
@@ -83,15 +87,60 @@ static void sequentialAlignReads(
             filtered_reads.emplace_back(std::move(read));
         }
     }
+}
+
+/**
+ * Reads of one graph split into consecutive chunks which threads pick up one at a time.
+ * Aligned reads are kept per chunk so that the merged result is in input order no matter
+ * which thread aligned which chunk.
+ */
+struct ReadChunks
+{
+    ReadChunks(std::vector<common::p_Read>& reads, std::size_t chunkSize)
+        : reads_(reads)
+        , chunkSize_(chunkSize)
+        , filteredReads_((reads.size() + chunkSize - 1) / chunkSize)
+    {
+    }
 
+    std::vector<common::p_Read>& reads_;
+    const std::size_t chunkSize_;
+    std::vector<std::vector<common::p_Read>> filteredReads_;
+    std::size_t nextChunk_ = 0;
+    bool terminate_ = false;
+    std::mutex mutex_;
+};
+
+template <typename AlignerT> static void alignChunks(ReadChunks& chunks, ReadFilter filter, AlignerT& aligner)
+{
+    std::unique_lock<std::mutex> lock(chunks.mutex_);
+    while (chunks.filteredReads_.size() != chunks.nextChunk_)
+    {
+        const std::size_t chunk = chunks.nextChunk_++;
+        ASYNC_BLOCK_WITH_CLEANUP([&chunks](bool failure) { chunks.terminate_ |= failure; })
+        {
+            if (chunks.terminate_)
+            {
+                LOG()->warn("terminating");
+                break;
+            }
+            common::unlock_guard<std::unique_lock<std::mutex>> unlock(lock);
+            const auto begin = chunks.reads_.begin() + chunk * chunks.chunkSize_;
+            const auto end = begin + std::min(chunks.chunkSize_, chunks.reads_.size() - chunk * chunks.chunkSize_);
+            sequentialAlignReads(begin, end, filter, chunks.filteredReads_[chunk], aligner);
+        }
+    }
+    common::unlock_guard<std::unique_lock<std::mutex>> unlock(lock);
     logAlignerStats(aligner);
 }
 
-template <typename IteratorT>
-static void sequentialAlignReads(
-    const IteratorT begin, IteratorT end, const graphtools::Graph* graph, std::list<graphtools::Path> const& paths,
-    ReadFilter filter, bool path_sequence_matching, bool graph_sequence_matching, bool klib_sequence_matching,
-    bool kmer_sequence_matching, bool validate_alignments, std::vector<common::p_Read>& filtered_reads)
+/**
+ * Set up an aligner for the calling thread and align chunks until none are left
+ */
+static void alignChunks(
+    ReadChunks& chunks, const graphtools::Graph* graph, std::list<graphtools::Path> const& paths, ReadFilter filter,
+    bool path_sequence_matching, bool graph_sequence_matching, bool klib_sequence_matching,
+    bool kmer_sequence_matching, bool validate_alignments)
 {
     if (validate_alignments)
     {
@@ -100,57 +149,69 @@ static void sequentialAlignReads(
                 path_sequence_matching, graph_sequence_matching, klib_sequence_matching, kmer_sequence_matching),
             graph, paths);
         aligner.setGraph(graph, paths);
-        sequentialAlignReads(begin, end, graph, paths, filter, filtered_reads, aligner);
+        alignChunks(chunks, filter, aligner);
     }
     else
     {
         grm::CompositeAligner aligner(
             path_sequence_matching, graph_sequence_matching, klib_sequence_matching, kmer_sequence_matching);
         aligner.setGraph(graph, paths);
-        sequentialAlignReads(begin, end, graph, paths, filter, filtered_reads, aligner);
+        alignChunks(chunks, filter, aligner);
+    }
+}
+
+uint64_t grm::alignmentCost(const graphtools::Graph* graph, std::vector<common::p_Read> const& reads)
+{
+    uint64_t graph_length = 0;
+    for (graphtools::NodeId node_id = 0; node_id != graph->numNodes(); ++node_id)
+    {
+        graph_length += graph->nodeSeq(node_id).size();
     }
+    return graph_length * reads.size();
 }
 
 void grm::alignReads(
     const graphtools::Graph* graph, std::list<graphtools::Path> const& paths, std::vector<common::p_Read>& reads,
     ReadFilter const& filter, bool path_sequence_matching, bool graph_sequence_matching, bool klib_sequence_matching,
-    bool kmer_sequence_matching, bool validate_alignments, uint32_t threads)
+    bool kmer_sequence_matching, bool validate_alignments, uint32_t threads, uint64_t min_split_cost)
 {
-    auto next = reads.begin();
-    const std::size_t step = std::max((reads.size() + threads - 1) / threads, std::size_t(1));
-    std::mutex m;
-    std::vector<common::p_Read> allFilteredReads;
-    bool terminate = false;
-    common::CPU_THREADS(threads).execute(
-        [&]() {
-            std::unique_lock<std::mutex> lock(m);
-            while (reads.end() != next)
-            {
-                const std::size_t ourStep
-                    = std::min<std::size_t>(step, static_cast<const size_t>(std::distance(next, reads.end())));
-                if (ourStep)
-                {
-                    auto begin = next;
-                    next += ourStep;
-                    auto end = next;
-                    std::vector<common::p_Read> filteredReads;
-                    ASYNC_BLOCK_WITH_CLEANUP([&](bool failure) { terminate |= failure; })
-                    {
-                        if (terminate)
-                        {
-                            LOG()->warn("terminating");
-                            break;
-                        }
-                        common::unlock_guard<std::unique_lock<std::mutex>> unlock(lock);
-                        sequentialAlignReads(
-                            begin, end, graph, paths, filter, path_sequence_matching, graph_sequence_matching,
-                            klib_sequence_matching, kmer_sequence_matching, validate_alignments, filteredReads);
-                    }
-                    std::move(filteredReads.begin(), filteredReads.end(), std::back_inserter(allFilteredReads));
-                }
-            }
-        },
-        std::max(reads.size() / step, std::size_t(1)));
+    // Reads are split into one chunk per thread. Stragglers are split into several chunks per thread,
+    // so that threads which become idle while the graph is aligned can still take a share
+    static const std::size_t kChunksPerThread = 4;
+    std::size_t chunkSize = std::max<std::size_t>((reads.size() + threads - 1) / std::max<uint32_t>(threads, 1), 1);
+    if (threads > 1 && reads.size() > 1)
+    {
+        const uint64_t cost = alignmentCost(graph, reads);
+        if (cost >= min_split_cost)
+        {
+            const std::size_t numChunks = std::min<std::size_t>(reads.size(), threads * kChunksPerThread);
+            chunkSize = (reads.size() + numChunks - 1) / numChunks;
+            LOG()->info(
+                "[Alignment cost {} of {} reads reaches {}, splitting into {} parts]", cost, reads.size(),
+                min_split_cost, (reads.size() + chunkSize - 1) / chunkSize);
+        }
+    }
+
+    ReadChunks chunks(reads, chunkSize);
+    const auto alignSomeChunks = [&]() {
+        alignChunks(
+            chunks, graph, paths, filter, path_sequence_matching, graph_sequence_matching, klib_sequence_matching,
+            kmer_sequence_matching, validate_alignments);
+    };
+    if (chunks.filteredReads_.size() > 1)
+    {
+        common::CPU_THREADS(threads).execute(
+            alignSomeChunks, static_cast<unsigned>(std::min<std::size_t>(threads, chunks.filteredReads_.size())));
+    }
+    else
+    {
+        alignSomeChunks();
+    }
 
+    std::vector<common::p_Read> allFilteredReads;
+    for (auto& filteredReads : chunks.filteredReads_)
+    {
+        std::move(filteredReads.begin(), filteredReads.end(), std::back_inserter(allFilteredReads));
+    }
     reads.swap(allFilteredReads);
 }
@@ -227,8 +227,8 @@ struct GraphAligner::GraphAlignerImpl
     }
 
     /** Default alignment parameters. */
-    int8_t match_ = 1;
-    int8_t mismatch_ = 4;
+    int8_t match_ = DEFAULT_MATCH;
+    int8_t mismatch_ = DEFAULT_MISMATCH;
     uint8_t gap_open_ = 6;
     uint8_t gap_extension_ = 1;
 
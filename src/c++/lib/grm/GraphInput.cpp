@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <string>
+#include <tuple>
 
 #include "grm/GraphInput.hh"
 
@@ -214,4 +215,91 @@ std::list<graphtools::Path> pathsFromJson(graphtools::Graph const* graph, Json::
     }
     return paths;
 }
+
+std::list<common::Region> breakpointWindowsFromJson(
+    Json::Value const& in, std::list<common::Region> const& target_regions, int64_t flank, int64_t merge_distance)
+{
+    std::unordered_map<std::string, common::Region> reference_nodes;
+    for (const auto& node : in["nodes"])
+    {
+        if (node.isMember("reference"))
+        {
+            reference_nodes.emplace(node["name"].asString(), common::Region(node["reference"].asString()));
+        }
+    }
+    std::unordered_map<std::string, int> num_in_edges;
+    std::unordered_map<std::string, int> num_out_edges;
+    for (const auto& edge : in["edges"])
+    {
+        ++num_out_edges[edge["from"].asString()];
+        ++num_in_edges[edge["to"].asString()];
+    }
+
+    // edges between reference nodes which are not adjacent on the reference and edges to / from
+    // alt nodes other than source and sink
+    std::vector<common::Region> breakpoints;
+    for (const auto& edge : in["edges"])
+    {
+        const std::string from = edge["from"].asString();
+        const std::string to = edge["to"].asString();
+        const auto from_reference = reference_nodes.find(from);
+        const auto to_reference = reference_nodes.find(to);
+        if (from_reference != reference_nodes.end() && to_reference != reference_nodes.end())
+        {
+            if (from_reference->second.chrom == to_reference->second.chrom
+                && to_reference->second.start == from_reference->second.end + 1)
+            {
+                continue;
+            }
+            breakpoints.emplace_back(
+                from_reference->second.chrom, from_reference->second.end, from_reference->second.end);
+            breakpoints.emplace_back(to_reference->second.chrom, to_reference->second.start, to_reference->second.start);
+        }
+        else if (from_reference != reference_nodes.end() && num_out_edges.count(to) != 0)
+        {
+            breakpoints.emplace_back(
+                from_reference->second.chrom, from_reference->second.end, from_reference->second.end);
+        }
+        else if (to_reference != reference_nodes.end() && num_in_edges.count(from) != 0)
+        {
+            breakpoints.emplace_back(to_reference->second.chrom, to_reference->second.start, to_reference->second.start);
+        }
+    }
+    std::vector<common::Region> windows;
+    for (const auto& breakpoint : breakpoints)
+    {
+        const common::Region window = breakpoint.getExtendedRegion(flank);
+        for (const auto& target_region : target_regions)
+        {
+            if (target_region.chrom == window.chrom && target_region.start <= window.end
+                && window.start <= target_region.end)
+            {
+                windows.emplace_back(
+                    window.chrom, std::max(window.start, target_region.start), std::min(window.end, target_region.end));
+            }
+        }
+    }
+    if (windows.empty())
+    {
+        return target_regions;
+    }
+    std::sort(windows.begin(), windows.end(), [](common::Region const& a, common::Region const& b) {
+        return std::tie(a.chrom, a.start, a.end) < std::tie(b.chrom, b.start, b.end);
+    });
+
+    std::list<common::Region> merged_windows;
+    for (const auto& window : windows)
+    {
+        if (!merged_windows.empty() && merged_windows.back().chrom == window.chrom
+            && window.start <= merged_windows.back().end + merge_distance)
+        {
+            merged_windows.back().end = std::max(merged_windows.back().end, window.end);
+        }
+        else
+        {
+            merged_windows.push_back(window);
+        }
+    }
+    return merged_windows;
+}
 }
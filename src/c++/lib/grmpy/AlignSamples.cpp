@@ -36,6 +36,7 @@
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <random>
@@ -54,9 +55,50 @@
 namespace grmpy
 {
 
+static const std::regex unsafe_characters{ "[^A-Za-z0-9.-]" };
+
+std::string alignmentContainerKey(const paragraph::Parameters& paragraphParameters)
+{
+    Json::Value const& graph = paragraphParameters.description();
+    if (graph.isMember("ID"))
+    {
+        return graph["ID"].asString();
+    }
+    else if (graph.isMember("model_name"))
+    {
+        return graph["model_name"].asString();
+    }
+    std::string key;
+    for (const auto& region : paragraphParameters.target_regions())
+    {
+        key += (key.empty() ? "" : ",") + std::string(region);
+    }
+    return key;
+}
+
+std::string alignmentContainerPath(const Parameters& parameters, genotyping::SampleInfo const& sample)
+{
+    const std::string safe_sample_name = std::regex_replace(sample.sample_name(), unsafe_characters, "_");
+    return (boost::filesystem::path(parameters.alignment_output_folder()) / (safe_sample_name + ".paragraph.bgzf"))
+        .string();
+}
+
+/**
+ * alignments take a lot of memory and are not required for downstream processing.
+ */
+static void removeAlignmentDetails(Json::Value& output)
+{
+    output.removeMember("alignments");
+    output.removeMember("node_coverage");
+    output.removeMember("path_coverage");
+    output.removeMember("phasing");
+    output.removeMember("variants");
+}
+
 static void writeAlignments(
     Json::Value& output, const Parameters& parameters, const paragraph::Parameters& paragraph_parameters,
-    const std::string& referencePath, genotyping::SampleInfo& sample)
+    const std::string& referencePath, genotyping::SampleInfo& sample,
+    common::AlignmentContainerWriter* alignmentContainer)
 {
     using namespace boost::filesystem;
     using namespace boost::algorithm;
@@ -64,7 +106,11 @@ static void writeAlignments(
     output["sample"] = sample.sample_name();
     output["reference"] = referencePath;
 
-    static const std::regex unsafe_characters{ "[^A-Za-z0-9.-]" };
+    if (alignmentContainer != nullptr)
+    {
+        alignmentContainer->add(alignmentContainerKey(paragraph_parameters), common::writeJson(output, false));
+        return;
+    }
 
     const std::string safe_sample_name = std::regex_replace(sample.sample_name(), unsafe_characters, "_");
     const std::string safe_target_regions = std::regex_replace(
@@ -108,15 +154,9 @@ static void writeAlignments(
     fos << common::writeJson(output);
 }
 
-/**
- * Run single sample alignment
- * @param sample sample data structure
- */
-void alignSingleSample(
-    const Parameters& parameters, const std::string& graphPath, const std::string& referencePath,
-    common::BamReader& reader, genotyping::SampleInfo& sample)
+paragraph::Parameters
+loadParagraphParameters(const Parameters& parameters, const std::string& graphPath, const std::string& referencePath)
 {
-    auto logger = LOG();
     const bool write_alignments = !parameters.alignment_output_folder().empty()
         && boost::filesystem::is_directory(parameters.alignment_output_folder());
 
@@ -143,31 +183,140 @@ void alignSingleSample(
         false);
     paragraph_parameters.set_threads(static_cast<uint32_t>(parameters.threads()));
     paragraph_parameters.set_kmer_len(parameters.bad_align_uniq_kmer_len());
+    paragraph_parameters.set_min_split_cost(parameters.min_split_cost());
+    paragraph_parameters.set_reference_prescreen(parameters.reference_prescreen());
+    paragraph_parameters.set_read_triage(parameters.read_triage());
+    paragraph_parameters.set_unmapped_index_dir(parameters.unmapped_index_dir());
+    paragraph_parameters.set_unmapped_index_mapq(parameters.unmapped_index_mapq());
+    paragraph_parameters.set_breakpoint_window(parameters.breakpoint_window());
 
-    logger->info("Loading parameters for sample {} graph {}", sample.sample_name(), graphPath);
     paragraph_parameters.load(graphPath, referencePath);
-    logger->info("Done loading parameters");
+    return paragraph_parameters;
+}
 
-    common::ReadBuffer all_reads;
+double maxReadDensity(const Parameters& parameters, genotyping::SampleInfo const& sample)
+{
+    if (parameters.max_reads_depth_factor() <= 0 || sample.autosome_depth() <= 0 || sample.read_length() == 0)
+    {
+        return 0.0;
+    }
+    // each base of the genome is the start of depth / read length reads on average
+    return parameters.max_reads_depth_factor() * sample.autosome_depth() / sample.read_length();
+}
 
-    common::extractReads(
-        reader, paragraph_parameters.target_regions(), parameters.max_reads(),
-        paragraph_parameters.longest_alt_insertion(), all_reads);
-    Json::Value output = paragraph::alignAndDisambiguate(paragraph_parameters, all_reads);
-    output["bam"] = sample.filename();
+std::unique_ptr<common::MemoryReservation> reserveSampleMemory(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters, common::BamReader& reader,
+    genotyping::SampleInfo const& sample, common::MemoryBudget* memoryBudget)
+{
+    std::unique_ptr<common::MemoryReservation> reservation;
+    if (memoryBudget != nullptr && !memoryBudget->unlimited())
+    {
+        const size_t estimated_reads = common::estimateNumReads(
+            reader, paragraphParameters.target_regions(), parameters.max_reads(), common::kAverageFragmentLength,
+            maxReadDensity(parameters, sample));
+        reservation.reset(new common::MemoryReservation(
+            *memoryBudget, common::estimateReadBufferSize(estimated_reads, sample.read_length())));
+    }
+    return reservation;
+}
+
+void alignExtractedReads(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters, const std::string& referencePath,
+    common::ReadBuffer& reads, genotyping::SampleInfo& sample, common::AlignmentContainerWriter* alignmentContainer)
+{
+    const bool write_alignments = !parameters.alignment_output_folder().empty()
+        && boost::filesystem::is_directory(parameters.alignment_output_folder());
+
+    Json::Value output = paragraph::alignAndDisambiguate(paragraphParameters, reads);
+    if (sample.filenames().size() > 1)
+    {
+        output["bam"] = Json::arrayValue;
+        for (const auto& filename : sample.filenames())
+        {
+            output["bam"].append(filename);
+        }
+    }
+    else
+    {
+        output["bam"] = sample.filename();
+    }
 
     if (write_alignments)
     {
-        writeAlignments(output, parameters, paragraph_parameters, referencePath, sample);
+        writeAlignments(output, parameters, paragraphParameters, referencePath, sample, alignmentContainer);
     }
 
-    // alignments take a lot of memory and are not required for downstream processing.
-    output.removeMember("alignments");
-    output.removeMember("node_coverage");
-    output.removeMember("path_coverage");
-    output.removeMember("phasing");
-    output.removeMember("variants");
+    removeAlignmentDetails(output);
+    sample.set_alignment_data(output);
+}
 
+bool loadContainerAlignments(
+    common::AlignmentContainerReader& alignmentContainer, const std::string& key, genotyping::SampleInfo& sample)
+{
+    std::string record;
+    if (!alignmentContainer.get(key, record))
+    {
+        return false;
+    }
+    Json::Value output;
+    std::istringstream input(record);
+    input >> output;
+    removeAlignmentDetails(output);
     sample.set_alignment_data(output);
+    return true;
+}
+
+/**
+ * Run single sample alignment
+ * @param sample sample data structure
+ * @param memoryBudget if not null, wait until the estimated read footprint fits into this budget
+ * @param alignmentContainer if not null, alignments are written to this container instead of one file per graph
+ */
+void alignSingleSample(
+    const Parameters& parameters, const std::string& graphPath, const std::string& referencePath,
+    common::BamReader& reader, genotyping::SampleInfo& sample, common::MemoryBudget* memoryBudget,
+    common::AlignmentContainerWriter* alignmentContainer)
+{
+    auto logger = LOG();
+    logger->info("Loading parameters for sample {} graph {}", sample.sample_name(), graphPath);
+    const paragraph::Parameters paragraph_parameters = loadParagraphParameters(parameters, graphPath, referencePath);
+    logger->info("Done loading parameters");
+
+    alignSingleSample(
+        parameters, paragraph_parameters, referencePath, reader, sample, memoryBudget, alignmentContainer);
+}
+
+void recruitUnmappedReads(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters,
+    const common::UnmappedReadIndex& unmappedIndex, common::ReadBuffer& reads)
+{
+    // recruited reads count towards the read limit of the graph
+    const std::size_t maxReads = static_cast<std::size_t>(std::max(parameters.max_reads(), 0));
+    const std::size_t recruited = unmappedIndex.recruitReads(
+        paragraphParameters.alt_sequences(), maxReads > reads.size() ? maxReads - reads.size() : 0, reads);
+    if (recruited > 0)
+    {
+        LOG()->info("Recruited {} unmapped or low-MAPQ reads", recruited);
+    }
+}
+
+void alignSingleSample(
+    const Parameters& parameters, const paragraph::Parameters& paragraphParameters, const std::string& referencePath,
+    common::BamReader& reader, genotyping::SampleInfo& sample, common::MemoryBudget* memoryBudget,
+    common::AlignmentContainerWriter* alignmentContainer, const common::UnmappedReadIndex* unmappedIndex)
+{
+    const auto reservation = reserveSampleMemory(parameters, paragraphParameters, reader, sample, memoryBudget);
+
+    common::ReadBuffer all_reads;
+    common::extractReads(
+        reader, paragraphParameters.target_regions(), parameters.max_reads(),
+        paragraphParameters.longest_alt_insertion(), all_reads, common::kAverageFragmentLength,
+        maxReadDensity(parameters, sample), paragraphParameters.recover_mates());
+    if (unmappedIndex)
+    {
+        recruitUnmappedReads(parameters, paragraphParameters, *unmappedIndex, all_reads);
+    }
+
+    alignExtractedReads(parameters, paragraphParameters, referencePath, all_reads, sample, alignmentContainer);
 }
 }
@@ -42,10 +42,11 @@ namespace grmpy
  * @param graphPath               If empty the alignment data of the first sample is used as graph
  * @param genotypingParameterPath path to genotyper settings
  * @param samples                 Collection of samples to genotype. Cannot be empty
+ * @param threads                 number of threads for genotyping breakpoints and samples
  */
 Json::Value countAndGenotype(
     const std::string& graphPath, const std::string& referencePath, const std::string& genotypingParameterPath,
-    const genotyping::Samples& samples)
+    const genotyping::Samples& samples, unsigned int threads)
 {
     LOG()->info("Running genotyper");
     // Initialize walkable graph
@@ -75,7 +76,7 @@ Json::Value countAndGenotype(
 
     LOG()->critical("For graphPath {} setting some parameters", graphPath);
 
-    genotyping::GraphBreakpointGenotyper graph_genotyper(male_ploidy, female_ploidy);
+    genotyping::GraphBreakpointGenotyper graph_genotyper(male_ploidy, female_ploidy, threads);
     graph_genotyper.reset(&graph);
 
     graph_genotyper.setParameters(genotypingParameterPath);
@@ -0,0 +1,412 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Sample x edge read count matrices for genotyping without alignment data
+ *
+ * \file CountMatrix.cpp
+ *
+ */
+
+#include "grmpy/CountMatrix.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "common/JsonHelpers.hh"
+#include "grmpy/CountAndGenotype.hh"
+
+#include "common/Error.hh"
+
+namespace grmpy
+{
+
+namespace
+{
+    const std::vector<std::string> kSampleColumns = { "sample", "depth", "depth_sd", "read_length", "sex" };
+
+    std::vector<std::string> splitLine(std::string const& line)
+    {
+        std::vector<std::string> tokens;
+        boost::split(tokens, line, [](char c) { return c == '\t'; });
+        return tokens;
+    }
+
+    /**
+     * Backslash-escape tabs, line breaks and backslashes in a name, and a leading '#' which would start a new block
+     */
+    std::string escapeName(std::string const& name)
+    {
+        std::string escaped;
+        escaped.reserve(name.size());
+        for (const char c : name)
+        {
+            switch (c)
+            {
+            case '\t':
+                escaped += "\\t";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '#':
+                escaped += escaped.empty() ? "\\#" : "#";
+                break;
+            default:
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string unescapeName(std::string const& escaped)
+    {
+        std::string name;
+        name.reserve(escaped.size());
+        for (auto c = escaped.begin(); c != escaped.end(); ++c)
+        {
+            if (*c != '\\' || c + 1 == escaped.end())
+            {
+                name += *c;
+                continue;
+            }
+            switch (*++c)
+            {
+            case 't':
+                name += '\t';
+                break;
+            case 'n':
+                name += '\n';
+                break;
+            case 'r':
+                name += '\r';
+                break;
+            default:
+                name += *c;
+            }
+        }
+        return name;
+    }
+
+    const char* sexName(genotyping::SampleInfo::Sex sex)
+    {
+        switch (sex)
+        {
+        case genotyping::SampleInfo::MALE:
+            return "male";
+        case genotyping::SampleInfo::FEMALE:
+            return "female";
+        default:
+            return "unknown";
+        }
+    }
+
+    void writeOutputFile(
+        Json::Value const& output, std::string const& graphPath, std::string const& outputFolderPath, bool gzipOutput)
+    {
+        const boost::filesystem::path inputPath(graphPath);
+        boost::filesystem::path outputPath = boost::filesystem::path(outputFolderPath) / inputPath.filename();
+        if (gzipOutput)
+        {
+            outputPath += ".gz";
+        }
+        boost::iostreams::basic_file_sink<char> of(outputPath.string());
+        if (!of.is_open())
+        {
+            error(
+                "ERROR: Failed to open output file '%s'. Error: '%s'", outputPath.string().c_str(),
+                std::strerror(errno));
+        }
+
+        boost::iostreams::filtering_ostream fos;
+        if (gzipOutput)
+        {
+            fos.push(boost::iostreams::gzip_compressor());
+        }
+        fos.push(of);
+        fos << common::writeJson(output);
+    }
+}
+
+CountMatrix makeCountMatrix(std::string const& graph_path, genotyping::Samples const& samples)
+{
+    CountMatrix matrix;
+    matrix.graph_path = graph_path;
+    if (samples.empty())
+    {
+        return matrix;
+    }
+    for (const auto& edge : samples.front().get_alignment_data()["edges"])
+    {
+        matrix.edge_names.push_back(edge["from"].asString() + "_" + edge["to"].asString());
+    }
+
+    matrix.counts.reserve(samples.size() * matrix.edge_names.size());
+    for (const auto& sample : samples)
+    {
+        const Json::Value& read_counts_by_edge = sample.get_alignment_data()["read_counts_by_edge"];
+        for (const auto& edge_name : matrix.edge_names)
+        {
+            const Json::Value* count = read_counts_by_edge.find(edge_name.data(), edge_name.data() + edge_name.size());
+            matrix.counts.push_back(count != nullptr ? count->asInt() : 0);
+        }
+        matrix.samples.push_back(sample);
+        matrix.samples.back().set_alignment_data(Json::nullValue);
+    }
+    return matrix;
+}
+
+void writeCountMatrix(std::ostream& output, CountMatrix const& matrix)
+{
+    output << "#graph\t" << escapeName(matrix.graph_path) << "\n#columns";
+    for (const auto& column : kSampleColumns)
+    {
+        output << "\t" << column;
+    }
+    for (const auto& edge_name : matrix.edge_names)
+    {
+        output << "\t" << escapeName(edge_name);
+    }
+    output << "\n";
+
+    // depths must round-trip exactly to give the same genotypes
+    const auto precision = output.precision(std::numeric_limits<double>::max_digits10);
+    auto count = matrix.counts.begin();
+    for (const auto& sample : matrix.samples)
+    {
+        output << escapeName(sample.sample_name()) << "\t" << sample.autosome_depth() << "\t" << sample.depth_sd()
+               << "\t" << sample.read_length() << "\t" << sexName(sample.sex());
+        for (size_t edge_index = 0; edge_index < matrix.edge_names.size(); ++edge_index)
+        {
+            output << "\t" << *count++;
+        }
+        output << "\n";
+    }
+    output.precision(precision);
+}
+
+bool readCountMatrix(std::istream& input, CountMatrix& matrix)
+{
+    matrix = CountMatrix();
+    std::string line;
+    bool has_graph = false;
+    while (!has_graph && std::getline(input, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        const auto tokens = splitLine(line);
+        if (tokens.size() != 2 || tokens[0] != "#graph")
+        {
+            error("ERROR: Expected a #graph line in count matrix, found: %s", line.c_str());
+        }
+        matrix.graph_path = unescapeName(tokens[1]);
+        has_graph = true;
+    }
+    if (!has_graph)
+    {
+        return false;
+    }
+
+    if (!std::getline(input, line))
+    {
+        error("ERROR: Count matrix for graph %s has no #columns line", matrix.graph_path.c_str());
+    }
+    const auto header = splitLine(line);
+    if (header.size() < kSampleColumns.size() + 1 || header[0] != "#columns"
+        || !std::equal(kSampleColumns.begin(), kSampleColumns.end(), header.begin() + 1))
+    {
+        error("ERROR: Invalid count matrix header for graph %s: %s", matrix.graph_path.c_str(), line.c_str());
+    }
+    for (auto edge_name = header.begin() + 1 + kSampleColumns.size(); edge_name != header.end(); ++edge_name)
+    {
+        matrix.edge_names.push_back(unescapeName(*edge_name));
+    }
+
+    while (input.peek() != std::char_traits<char>::eof() && input.peek() != '#' && std::getline(input, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        const auto tokens = splitLine(line);
+        if (tokens.size() != kSampleColumns.size() + matrix.edge_names.size())
+        {
+            error("ERROR: Invalid count matrix line for graph %s: %s", matrix.graph_path.c_str(), line.c_str());
+        }
+        genotyping::SampleInfo sample;
+        try
+        {
+            sample.set_sample_name(unescapeName(tokens[0]));
+            sample.set_depth_sd(std::stod(tokens[2]));
+            sample.set_autosome_depth(std::stod(tokens[1]));
+            sample.set_read_length(static_cast<unsigned int>(std::stoul(tokens[3])));
+            sample.set_sex(tokens[4]);
+            for (size_t column = kSampleColumns.size(); column < tokens.size(); ++column)
+            {
+                matrix.counts.push_back(static_cast<int32_t>(std::stol(tokens[column])));
+            }
+        }
+        catch (std::logic_error const&)
+        {
+            error("ERROR: Invalid count matrix line for graph %s: %s", matrix.graph_path.c_str(), line.c_str());
+        }
+        matrix.samples.push_back(sample);
+    }
+    return true;
+}
+
+Json::Value genotypeCountMatrix(
+    CountMatrix const& matrix, std::string const& referencePath, std::string const& genotypingParameterPath,
+    unsigned int threads)
+{
+    if (matrix.samples.empty())
+    {
+        error("ERROR: Count matrix for graph %s has no samples", matrix.graph_path.c_str());
+    }
+    if (!boost::filesystem::is_regular_file(matrix.graph_path))
+    {
+        error("ERROR: Graph %s of count matrix does not exist", matrix.graph_path.c_str());
+    }
+
+    // the genotyper only reads edge counts from the alignments, and graph information from the first one
+    genotyping::Samples samples = matrix.samples;
+    auto count = matrix.counts.begin();
+    for (auto& sample : samples)
+    {
+        Json::Value alignment = &sample == &samples.front() ? common::getJSON(matrix.graph_path) : Json::objectValue;
+        Json::Value& read_counts_by_edge = alignment["read_counts_by_edge"];
+        read_counts_by_edge = Json::objectValue;
+        for (const auto& edge_name : matrix.edge_names)
+        {
+            if (*count != 0)
+            {
+                read_counts_by_edge[edge_name] = *count;
+            }
+            ++count;
+        }
+        sample.set_alignment_data(alignment);
+    }
+    return countAndGenotype(std::string(), referencePath, genotypingParameterPath, samples, threads);
+}
+
+void genotypeCountMatrices(
+    std::string const& countMatrixPath, std::string const& referencePath, std::string const& genotypingParameterPath,
+    std::string const& outputFilePath, std::string const& outputFolderPath, bool gzipOutput, unsigned int threads)
+{
+    std::ifstream inputFile(countMatrixPath, std::ios::binary);
+    if (!inputFile)
+    {
+        error(
+            "ERROR: Failed to open count matrix file '%s'. Error: '%s'", countMatrixPath.c_str(), std::strerror(errno));
+    }
+    boost::iostreams::filtering_istream input;
+    if (boost::algorithm::ends_with(countMatrixPath, ".gz"))
+    {
+        input.push(boost::iostreams::gzip_decompressor());
+    }
+    input.push(inputFile);
+
+    boost::iostreams::filtering_ostream fos;
+    if (!outputFilePath.empty())
+    {
+        if (gzipOutput)
+        {
+            fos.push(boost::iostreams::gzip_compressor());
+        }
+        if ("-" != outputFilePath)
+        {
+            LOG()->info("Output file path: {}", outputFilePath);
+            boost::iostreams::basic_file_sink<char> of(outputFilePath);
+            if (!of.is_open())
+            {
+                error(
+                    "ERROR: Failed to open output file '%s'. Error: '%s'", outputFilePath.c_str(),
+                    std::strerror(errno));
+            }
+            fos.push(of);
+        }
+        else
+        {
+            LOG()->info("Output to stdout");
+            fos.push(std::cout);
+        }
+    }
+
+    // like the alignment workflow, write a list only for more than one graph
+    std::string firstOutput;
+    size_t numGraphs = 0;
+    CountMatrix matrix;
+    while (readCountMatrix(input, matrix))
+    {
+        LOG()->info("Genotyping {} samples for graph {}", matrix.samples.size(), matrix.graph_path);
+        const Json::Value output = genotypeCountMatrix(matrix, referencePath, genotypingParameterPath, threads);
+        if (!outputFolderPath.empty())
+        {
+            writeOutputFile(output, matrix.graph_path, outputFolderPath, gzipOutput);
+        }
+        if (!outputFilePath.empty())
+        {
+            if (numGraphs == 0)
+            {
+                firstOutput = common::writeJson(output);
+            }
+            else
+            {
+                if (numGraphs == 1)
+                {
+                    fos << "[" << firstOutput;
+                }
+                fos << ',' << common::writeJson(output);
+            }
+        }
+        ++numGraphs;
+    }
+
+    if (!outputFilePath.empty())
+    {
+        if (numGraphs == 1)
+        {
+            fos << firstOutput;
+        }
+        else if (numGraphs > 1)
+        {
+            fos << "]\n";
+        }
+    }
+    LOG()->info("Genotyped {} graphs from count matrices", numGraphs);
+}
+}
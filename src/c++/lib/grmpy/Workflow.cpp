@@ -26,11 +26,20 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <mutex>
+#include <numeric>
+#include <sstream>
 #include <thread>
+#include <tuple>
+#include <unordered_map>
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -41,6 +50,7 @@
 #include "common/Threads.hh"
 #include "grmpy/AlignSamples.hh"
 #include "grmpy/CountAndGenotype.hh"
+#include "grmpy/CountMatrix.hh"
 #include "grmpy/Workflow.hh"
 #include "paragraph/Disambiguation.hh"
 
@@ -59,8 +69,20 @@ Workflow::Workflow(
     , gzipOutput_(gzipOutput)
     , parameters_(parameters)
     , referencePath_(referencePath)
+    , memoryBudget_(parameters.max_memory())
+    , resultCache_(parameters.alignment_output_folder().empty() ? parameters.cache_dir() : std::string())
     , progress_(progress)
 {
+    if (!parameters.cache_dir().empty() && !resultCache_.enabled())
+    {
+        // cached results don't include the alignments themselves
+        LOG()->warn("Result cache is not used when writing alignments.");
+    }
+    if (parameters.deduplicate_graphs() && !parameters.alignment_output_folder().empty())
+    {
+        // alignments are written per graph
+        LOG()->warn("Graphs are not deduplicated when writing alignments.");
+    }
     alignedSamples_.resize(std::max<std::size_t>(1, graphSpecPaths_.size()));
     for (const genotyping::SampleInfo& sample : manifest_)
     {
@@ -79,6 +101,48 @@ Workflow::Workflow(
             assert(!sample.get_alignment_data().isNull());
             alignedSamples_[0].push_back(sample);
         }
+
+        std::unique_ptr<common::AlignmentContainerReader> containerReader;
+        if (!sample.alignment_container().empty())
+        {
+            containerReader.reset(new common::AlignmentContainerReader(sample.alignment_container()));
+            LOG()->info(
+                "Sample {}: {} graphs in alignment container {}", sample.sample_name(), containerReader->size(),
+                sample.alignment_container());
+        }
+        std::unique_ptr<common::AlignmentContainerWriter> containerWriter;
+        if (parameters_.alignment_container() && !parameters_.alignment_output_folder().empty())
+        {
+            const std::string containerPath = alignmentContainerPath(parameters_, sample);
+            if (containerReader && boost::filesystem::equivalent(containerPath, containerReader->path()))
+            {
+                error(
+                    "ERROR: Alignment container %s of sample %s would be overwritten", containerPath.c_str(),
+                    sample.sample_name().c_str());
+            }
+            containerWriter.reset(new common::AlignmentContainerWriter(containerPath));
+        }
+        alignmentContainerReaders_.push_back(std::move(containerReader));
+        alignmentContainerWriters_.push_back(std::move(containerWriter));
+    }
+
+    // samples in the same files are told apart by their read groups. The first sample of each set of files
+    // extracts the reads for all of them in one pass, the others are not scheduled on their own.
+    readGroupSamples_.resize(manifest_.size());
+    std::map<std::vector<std::string>, std::size_t> firstReadGroupSample;
+    for (std::size_t sampleIndex = 0; sampleIndex != manifest_.size(); ++sampleIndex)
+    {
+        const genotyping::SampleInfo& sample = manifest_[sampleIndex];
+        if (sample.read_groups().empty() || !sample.get_alignment_data().isNull())
+        {
+            continue;
+        }
+        const auto inserted = firstReadGroupSample.emplace(sample.filenames(), sampleIndex);
+        readGroupSamples_[inserted.first->second].push_back(sampleIndex);
+        if (!inserted.second)
+        {
+            unalignedSamples_[sampleIndex].unprocessedGraphs_ = std::end(graphSpecPaths_);
+        }
     }
 }
 
@@ -105,6 +169,201 @@ void Workflow::makeOutputFile(const Json::Value& output, const std::string& grap
     fos << common::writeJson(output);
 }
 
+/**
+ * Alignments depend on the graph, the alignment settings, the sample BAM and the reference,
+ * but not on genotyping parameters.
+ * @return cache key, empty if caching is disabled
+ */
+std::string Workflow::alignmentCacheKey(
+    const paragraph::Parameters& paragraphParameters, genotyping::SampleInfo const& sample) const
+{
+    if (!resultCache_.enabled())
+    {
+        return std::string();
+    }
+    common::CacheKey key;
+    key.add("paragraph", paragraphParameters.fingerprint());
+    key.add("sample", sample.sample_name());
+    for (const auto& filename : sample.filenames())
+    {
+        key.addFile("bam", filename);
+    }
+    for (const auto& read_group : sample.read_groups())
+    {
+        key.add("read_group", read_group);
+    }
+    const double maxReadDensity = grmpy::maxReadDensity(parameters_, sample);
+    if (maxReadDensity > 0)
+    {
+        key.add("max_read_density", std::to_string(maxReadDensity));
+    }
+    key.addFile("reference", referencePath_);
+    return key.digest();
+}
+
+bool Workflow::loadCachedAlignments(const std::string& cacheKey, genotyping::SampleInfo& sample) const
+{
+    std::string cached;
+    if (cacheKey.empty() || !resultCache_.get(cacheKey, cached))
+    {
+        return false;
+    }
+    Json::Value alignments;
+    std::istringstream input(cached);
+    input >> alignments;
+    sample.set_alignment_data(alignments);
+    LOG()->info("Using cached alignments for sample {}", sample.sample_name());
+    return true;
+}
+
+void Workflow::storeCachedAlignments(const std::string& cacheKey, genotyping::SampleInfo const& sample) const
+{
+    if (!cacheKey.empty())
+    {
+        resultCache_.put(cacheKey, common::writeJson(sample.get_alignment_data(), false));
+    }
+}
+
+/**
+ * Use the alignments from the sample's alignment container if it has a record for the graph
+ * @return true if the sample doesn't need to be aligned to the graph
+ */
+bool Workflow::loadStoredAlignments(
+    std::size_t sampleIndex, const paragraph::Parameters& paragraphParameters, genotyping::SampleInfo& sample)
+{
+    common::AlignmentContainerReader* reader = alignmentContainerReaders_[sampleIndex].get();
+    if (reader == nullptr)
+    {
+        return false;
+    }
+    const std::string key = alignmentContainerKey(paragraphParameters);
+    if (!loadContainerAlignments(*reader, key, sample))
+    {
+        LOG()->warn("Alignment container {} has no record for {}, aligning", reader->path(), key);
+        return false;
+    }
+    LOG()->info("Using alignments for sample {} graph {} from {}", sample.sample_name(), key, reader->path());
+    return true;
+}
+
+/**
+ * Open the BAM reader for a sample unless it is open already
+ */
+void Workflow::openReader(std::size_t sampleIndex, std::unique_ptr<common::BamReader>& reader) const
+{
+    if (!reader)
+    {
+        const genotyping::SampleInfo& sample = unalignedSamples_[sampleIndex].sample_;
+        reader.reset(new common::BamReader(sample.filenames(), sample.index_filenames(), referencePath_));
+        reader->enableReadCache(parameters_.read_cache_size());
+    }
+}
+
+/**
+ * Extract the reads of all samples in the read group set of a sample in one pass over their shared files
+ * @param extracted reads for each sample of the set whose alignments are not stored or cached
+ */
+void Workflow::extractReadGroupSamples(
+    std::size_t sampleIndex, std::size_t graphIndex, const paragraph::Parameters& paragraphParameters,
+    std::unique_ptr<common::BamReader>& reader, std::vector<ExtractedGraph>& extracted)
+{
+    std::vector<std::string> sampleNames;
+    std::vector<std::vector<std::string>> readGroups;
+    for (const std::size_t member : readGroupSamples_[sampleIndex])
+    {
+        genotyping::SampleInfo& sample = alignedSamples_.at(graphIndex).at(member);
+        ExtractedGraph extractedGraph;
+        extractedGraph.cacheKey_ = alignmentCacheKey(paragraphParameters, sample);
+        if (loadStoredAlignments(member, paragraphParameters, sample)
+            || loadCachedAlignments(extractedGraph.cacheKey_, sample))
+        {
+            continue;
+        }
+        extractedGraph.sampleIndex_ = member;
+        extractedGraph.graphIndex_ = graphIndex;
+        extractedGraph.paragraphParameters_ = paragraphParameters;
+        sampleNames.push_back(sample.sample_name());
+        readGroups.push_back(sample.read_groups());
+        extracted.push_back(std::move(extractedGraph));
+    }
+    if (extracted.empty())
+    {
+        return;
+    }
+
+    openReader(sampleIndex, reader);
+    // the estimate covers the reads of all samples in the files, so it is held until the last of them is aligned
+    const std::shared_ptr<common::MemoryReservation> reservation = reserveSampleMemory(
+        parameters_, paragraphParameters, *reader, unalignedSamples_[sampleIndex].sample_, &memoryBudget_);
+    for (auto& extractedGraph : extracted)
+    {
+        extractedGraph.reservation_ = reservation;
+    }
+    std::vector<common::ReadBuffer> sampleReads;
+    common::extractReadGroupReads(
+        *reader, paragraphParameters.target_regions(), parameters_.max_reads(),
+        paragraphParameters.longest_alt_insertion(), sampleNames, readGroups, sampleReads,
+        common::kAverageFragmentLength, paragraphParameters.recover_mates());
+    for (std::size_t i = 0; i != extracted.size(); ++i)
+    {
+        extracted[i].reads_ = std::move(sampleReads[i]);
+    }
+}
+
+/**
+ * Align one sample to one graph unless the alignments are stored in the sample's container or cached
+ * @param reader BAM reader for the sample, opened on first use since samples with an alignment container might not
+ *               need it
+ */
+void Workflow::alignGraph(
+    std::size_t sampleIndex, std::size_t graphIndex, std::unique_ptr<common::BamReader>& reader)
+{
+    if (isDuplicate(graphIndex))
+    {
+        return;
+    }
+    const UnalignedSample& input = unalignedSamples_[sampleIndex];
+    const std::string& graphPath = graphSpecPaths_[graphIndex];
+    genotyping::SampleInfo& sample = alignedSamples_.at(graphIndex).at(sampleIndex);
+
+    LOG()->info("Loading parameters for sample {} graph {}", sample.sample_name(), graphPath);
+    const paragraph::Parameters paragraphParameters = loadParagraphParameters(parameters_, graphPath, referencePath_);
+    LOG()->info("Done loading parameters");
+
+    if (!readGroupSamples_[sampleIndex].empty())
+    {
+        std::vector<ExtractedGraph> extracted;
+        extractReadGroupSamples(sampleIndex, graphIndex, paragraphParameters, reader, extracted);
+        for (ExtractedGraph& extractedGraph : extracted)
+        {
+            genotyping::SampleInfo& memberSample = alignedSamples_.at(graphIndex).at(extractedGraph.sampleIndex_);
+            alignExtractedReads(
+                parameters_, paragraphParameters, referencePath_, extractedGraph.reads_, memberSample,
+                alignmentContainerWriters_[extractedGraph.sampleIndex_].get());
+            storeCachedAlignments(extractedGraph.cacheKey_, memberSample);
+        }
+    }
+    else
+    {
+        const std::string cacheKey = alignmentCacheKey(paragraphParameters, sample);
+        if (!loadStoredAlignments(sampleIndex, paragraphParameters, sample) && !loadCachedAlignments(cacheKey, sample))
+        {
+            openReader(sampleIndex, reader);
+            alignSingleSample(
+                parameters_, paragraphParameters, referencePath_, *reader, sample, &memoryBudget_,
+                alignmentContainerWriters_[sampleIndex].get(), unmappedIndexes_[sampleIndex].get());
+            storeCachedAlignments(cacheKey, sample);
+        }
+    }
+
+    if (progress_)
+    {
+        LOG()->critical(
+            "Sample {}: Alignment {} / {} finished", input.sample_.sample_name(), graphIndex + 1,
+            alignedSamples_.size());
+    }
+}
+
 void Workflow::alignSamples()
 {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -117,7 +376,7 @@ void Workflow::alignSamples()
                 "Starting alignment for sample {} ({}/{})", input.sample_.sample_name(), i + 1,
                 unalignedSamples_.size());
         }
-        common::BamReader reader(input.sample_.filename(), input.sample_.index_filename(), referencePath_);
+        std::unique_ptr<common::BamReader> reader;
         while (graphSpecPaths_.end() != input.unprocessedGraphs_)
         {
             const GraphSpecPaths::const_iterator ourGraph = input.unprocessedGraphs_++;
@@ -129,31 +388,320 @@ void Workflow::alignSamples()
                     break;
                 }
                 common::unlock_guard<std::mutex> unlock(mutex_);
+                alignGraph(i, static_cast<std::size_t>(std::distance(graphSpecPaths_.begin(), ourGraph)), reader);
+            }
+        }
+    }
+}
+
+/**
+ * Sort graphs by the start of their first target region so that the sample-major schedule
+ * reads each BAM file mostly sequentially
+ */
+void Workflow::orderGraphsByLocus()
+{
+    std::vector<common::Region> firstRegions(graphSpecPaths_.size());
+    for (std::size_t graphIndex = 0; graphIndex < graphSpecPaths_.size(); ++graphIndex)
+    {
+        const std::list<common::Region> targetRegions
+            = loadParagraphParameters(parameters_, graphSpecPaths_[graphIndex], referencePath_).target_regions();
+        if (!targetRegions.empty())
+        {
+            firstRegions[graphIndex] = targetRegions.front();
+        }
+    }
+
+    graphOrder_.resize(graphSpecPaths_.size());
+    std::iota(graphOrder_.begin(), graphOrder_.end(), 0);
+    std::stable_sort(graphOrder_.begin(), graphOrder_.end(), [&firstRegions](std::size_t a, std::size_t b) {
+        return std::tie(firstRegions[a].chrom, firstRegions[a].start)
+            < std::tie(firstRegions[b].chrom, firstRegions[b].start);
+    });
+}
+
+/**
+ * Find graphs which only differ in their annotations, so each sample is aligned to them only once
+ */
+void Workflow::findDuplicateGraphs()
+{
+    std::vector<std::string> fingerprints(graphSpecPaths_.size());
+    std::vector<Json::Value> descriptions(graphSpecPaths_.size());
+    std::atomic<std::size_t> nextGraph(0);
+    common::CPU_THREADS(parameters_.threads()).execute([this, &fingerprints, &descriptions, &nextGraph]() {
+        for (std::size_t graphIndex = nextGraph++; graphIndex < graphSpecPaths_.size(); graphIndex = nextGraph++)
+        {
+            const paragraph::Parameters paragraphParameters
+                = loadParagraphParameters(parameters_, graphSpecPaths_[graphIndex], referencePath_);
+            fingerprints[graphIndex] = common::CacheKey().add("graph", paragraphParameters.graphFingerprint()).digest();
+            descriptions[graphIndex] = paragraphParameters.description();
+        }
+    });
+
+    std::unordered_map<std::string, std::size_t> firstGraph;
+    representatives_.resize(graphSpecPaths_.size());
+    duplicateDescriptions_.assign(graphSpecPaths_.size(), Json::Value());
+    std::size_t duplicates = 0;
+    for (std::size_t graphIndex = 0; graphIndex != graphSpecPaths_.size(); ++graphIndex)
+    {
+        const auto inserted = firstGraph.emplace(fingerprints[graphIndex], graphIndex);
+        const std::size_t representative = inserted.first->second;
+        representatives_[graphIndex] = representative;
+        if (!inserted.second)
+        {
+            // only the descriptions needed to relabel the copied alignments are kept
+            if (duplicateDescriptions_[representative].isNull())
+            {
+                duplicateDescriptions_[representative].swap(descriptions[representative]);
+            }
+            duplicateDescriptions_[graphIndex].swap(descriptions[graphIndex]);
+            ++duplicates;
+        }
+    }
+    LOG()->info("{} of {} graphs are duplicates of other graphs", duplicates, graphSpecPaths_.size());
+}
 
-                auto ourGraphIndex = static_cast<unsigned long>(std::distance(graphSpecPaths_.begin(), ourGraph));
-                alignSingleSample(
-                    parameters_, *ourGraph, referencePath_, reader, alignedSamples_.at(ourGraphIndex).at(i));
+/**
+ * Build or map the unmapped read index of each sample, one sample per thread
+ */
+void Workflow::openUnmappedIndexes()
+{
+    boost::filesystem::create_directories(parameters_.unmapped_index_dir());
+    std::atomic<std::size_t> nextSample(0);
+    common::CPU_THREADS(parameters_.threads()).execute([this, &nextSample]() {
+        for (std::size_t sampleIndex = nextSample++; sampleIndex < manifest_.size(); sampleIndex = nextSample++)
+        {
+            const genotyping::SampleInfo& sample = manifest_[sampleIndex];
+            if (!sample.get_alignment_data().isNull())
+            {
+                continue;
+            }
+            if (!sample.read_groups().empty())
+            {
+                LOG()->warn(
+                    "Sample {} is stored as read groups, not recruiting reads from an unmapped read index",
+                    sample.sample_name());
+                continue;
+            }
+            const boost::filesystem::path indexPath
+                = boost::filesystem::path(parameters_.unmapped_index_dir()) / (sample.sample_name() + ".unmapped.idx");
+            unmappedIndexes_[sampleIndex] = common::UnmappedReadIndex::open(
+                sample.filenames(), referencePath_, indexPath.string(), parameters_.unmapped_index_mapq());
+        }
+    });
+}
 
-                if (progress_)
+/**
+ * Give duplicate graphs the alignments of the first graph with the same graph fingerprint
+ */
+void Workflow::copyDuplicateAlignments()
+{
+    for (std::size_t graphIndex = 0; graphIndex != graphSpecPaths_.size(); ++graphIndex)
+    {
+        if (!isDuplicate(graphIndex))
+        {
+            continue;
+        }
+        const std::size_t representative = representatives_[graphIndex];
+        const Json::Value& representativeDescription = duplicateDescriptions_[representative];
+        const Json::Value& description = duplicateDescriptions_[graphIndex];
+        for (std::size_t sampleIndex = 0; sampleIndex != manifest_.size(); ++sampleIndex)
+        {
+            // pre-aligned samples keep the alignments from the manifest
+            if (!manifest_[sampleIndex].get_alignment_data().isNull())
+            {
+                continue;
+            }
+            alignedSamples_[graphIndex][sampleIndex].set_alignment_data(paragraph::relabelResult(
+                alignedSamples_[representative][sampleIndex].get_alignment_data(), representativeDescription,
+                description));
+        }
+    }
+}
+
+/**
+ * Each thread claims one sample at a time and aligns it to all graphs in locus order,
+ * so each BAM file is opened once and read mostly sequentially
+ */
+void Workflow::alignSamplesByLocus()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!terminate_ && unclaimedSample_ < unalignedSamples_.size())
+    {
+        const std::size_t i = unclaimedSample_++;
+        UnalignedSample& input = unalignedSamples_[i];
+        if (graphSpecPaths_.end() == input.unprocessedGraphs_)
+        {
+            continue;
+        }
+        input.unprocessedGraphs_ = graphSpecPaths_.end();
+
+        ASYNC_BLOCK_WITH_CLEANUP([this](bool failure) { terminate_ |= failure; })
+        {
+            common::unlock_guard<std::mutex> unlock(mutex_);
+            if (progress_)
+            {
+                LOG()->critical(
+                    "Starting alignment for sample {} ({}/{})", input.sample_.sample_name(), i + 1,
+                    unalignedSamples_.size());
+            }
+            std::unique_ptr<common::BamReader> reader;
+            for (const std::size_t graphIndex : graphOrder_)
+            {
                 {
-                    LOG()->critical(
-                        "Sample {}: Alignment {} / {} finished", input.sample_.sample_name(), ourGraphIndex + 1,
-                        alignedSamples_.size());
+                    std::lock_guard<std::mutex> terminateLock(mutex_);
+                    if (terminate_)
+                    {
+                        LOG()->warn("terminating");
+                        break;
+                    }
                 }
+                alignGraph(i, graphIndex, reader);
+            }
+        }
+    }
+}
+
+/**
+ * Runs on the prefetch thread: extract reads for the next sample and graph. Samples are
+ * processed one after the other so that each BAM file is opened once.
+ * @return false when reads for all samples and graphs have been extracted
+ */
+bool Workflow::prefetchGraph(ExtractedGraph& extractedGraph)
+{
+    while (true)
+    {
+        if (!prefetchPending_.empty())
+        {
+            extractedGraph = std::move(prefetchPending_.front());
+            prefetchPending_.pop_front();
+            return true;
+        }
+        while (prefetchSample_ < unalignedSamples_.size()
+               && graphSpecPaths_.end() == unalignedSamples_[prefetchSample_].unprocessedGraphs_)
+        {
+            ++prefetchSample_;
+            prefetchReader_.reset();
+        }
+        if (prefetchSample_ == unalignedSamples_.size())
+        {
+            return false;
+        }
+
+        UnalignedSample& input = unalignedSamples_[prefetchSample_];
+        const GraphSpecPaths::const_iterator ourGraph = input.unprocessedGraphs_++;
+        extractedGraph.sampleIndex_ = prefetchSample_;
+        extractedGraph.graphIndex_ = static_cast<std::size_t>(std::distance(graphSpecPaths_.begin(), ourGraph));
+        if (isDuplicate(extractedGraph.graphIndex_))
+        {
+            continue;
+        }
+
+        LOG()->info("Loading parameters for sample {} graph {}", input.sample_.sample_name(), *ourGraph);
+        extractedGraph.paragraphParameters_ = loadParagraphParameters(parameters_, *ourGraph, referencePath_);
+        LOG()->info("Done loading parameters");
+
+        if (!readGroupSamples_[prefetchSample_].empty())
+        {
+            if (!prefetchReader_ && progress_)
+            {
+                LOG()->critical(
+                    "Starting alignment for sample {} ({}/{})", input.sample_.sample_name(), prefetchSample_ + 1,
+                    unalignedSamples_.size());
+            }
+            std::vector<ExtractedGraph> extracted;
+            extractReadGroupSamples(
+                prefetchSample_, extractedGraph.graphIndex_, extractedGraph.paragraphParameters_, prefetchReader_,
+                extracted);
+            std::move(extracted.begin(), extracted.end(), std::back_inserter(prefetchPending_));
+            continue;
+        }
+
+        genotyping::SampleInfo& sample = alignedSamples_.at(extractedGraph.graphIndex_).at(prefetchSample_);
+        extractedGraph.cacheKey_ = alignmentCacheKey(extractedGraph.paragraphParameters_, sample);
+        if (loadStoredAlignments(prefetchSample_, extractedGraph.paragraphParameters_, sample)
+            || loadCachedAlignments(extractedGraph.cacheKey_, sample))
+        {
+            continue;
+        }
+
+        if (!prefetchReader_)
+        {
+            if (progress_)
+            {
+                LOG()->critical(
+                    "Starting alignment for sample {} ({}/{})", input.sample_.sample_name(), prefetchSample_ + 1,
+                    unalignedSamples_.size());
+            }
+            openReader(prefetchSample_, prefetchReader_);
+        }
+
+        extractedGraph.reservation_ = reserveSampleMemory(
+            parameters_, extractedGraph.paragraphParameters_, *prefetchReader_, input.sample_, &memoryBudget_);
+        common::extractReads(
+            *prefetchReader_, extractedGraph.paragraphParameters_.target_regions(), parameters_.max_reads(),
+            extractedGraph.paragraphParameters_.longest_alt_insertion(), extractedGraph.reads_,
+            common::kAverageFragmentLength, maxReadDensity(parameters_, input.sample_),
+            extractedGraph.paragraphParameters_.recover_mates());
+        if (unmappedIndexes_[prefetchSample_])
+        {
+            recruitUnmappedReads(
+                parameters_, extractedGraph.paragraphParameters_, *unmappedIndexes_[prefetchSample_],
+                extractedGraph.reads_);
+        }
+        return true;
+    }
+}
+
+void Workflow::alignPrefetchedGraphs(common::Prefetcher<ExtractedGraph>& prefetcher)
+{
+    // stop extraction for the remaining graphs if alignment fails
+    const auto cleanup = [this, &prefetcher](bool failure) {
+        terminate_ |= failure;
+        if (failure)
+        {
+            prefetcher.cancel();
+        }
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!terminate_)
+    {
+        ASYNC_BLOCK_WITH_CLEANUP(cleanup)
+        {
+            common::unlock_guard<std::mutex> unlock(mutex_);
+            ExtractedGraph extractedGraph;
+            if (!prefetcher.next(extractedGraph))
+            {
+                break;
+            }
+            genotyping::SampleInfo& sample
+                = alignedSamples_.at(extractedGraph.graphIndex_).at(extractedGraph.sampleIndex_);
+            alignExtractedReads(
+                parameters_, extractedGraph.paragraphParameters_, referencePath_, extractedGraph.reads_, sample,
+                alignmentContainerWriters_[extractedGraph.sampleIndex_].get());
+            storeCachedAlignments(extractedGraph.cacheKey_, sample);
+
+            if (progress_)
+            {
+                LOG()->critical(
+                    "Sample {}: Alignment {} / {} finished", sample.sample_name(), extractedGraph.graphIndex_ + 1,
+                    alignedSamples_.size());
             }
         }
     }
 }
 
 void Workflow::genotypeGraphs(
-    std::ostream& outputFileStream, std::vector<genotyping::Samples>::const_iterator& ungenotypedSamples)
+    std::ostream& outputFileStream, std::ostream* countMatrixStream,
+    std::vector<genotyping::Samples>::const_iterator& ungenotypedSamples)
 {
     std::lock_guard<std::mutex> lock(mutex_);
     while (alignedSamples_.end() != ungenotypedSamples)
     {
         const std::vector<genotyping::Samples>::const_iterator ourGraphSamples = ungenotypedSamples++;
         const auto graphIndex = static_cast<unsigned long>(std::distance(alignedSamples_.cbegin(), ourGraphSamples));
+        const std::string& graphSpecPath = graphSpecPaths_.empty() ? std::string() : graphSpecPaths_.at(graphIndex);
         Json::Value output;
+        CountMatrix countMatrix;
 
         ASYNC_BLOCK_WITH_CLEANUP([this](bool failure) { terminate_ |= failure; })
         {
@@ -165,8 +713,13 @@ void Workflow::genotypeGraphs(
             common::unlock_guard<std::mutex> unlock(mutex_);
 
             LOG()->critical("Working on genotyping {} / {}", graphIndex + 1, alignedSamples_.size());
-            const std::string& graphSpecPath = graphSpecPaths_.empty() ? std::string() : graphSpecPaths_.at(graphIndex);
-            output = countAndGenotype(graphSpecPath, referencePath_, genotypingParameterPath_, *ourGraphSamples);
+            if (nullptr != countMatrixStream)
+            {
+                countMatrix = makeCountMatrix(graphSpecPath, *ourGraphSamples);
+            }
+            output = countAndGenotype(
+                graphSpecPath, referencePath_, genotypingParameterPath_, *ourGraphSamples,
+                static_cast<unsigned int>(parameters_.threads()));
             if (!outputFolderPath_.empty())
             {
                 makeOutputFile(output, graphSpecPath);
@@ -177,6 +730,10 @@ void Workflow::genotypeGraphs(
             }
         }
 
+        if (nullptr != countMatrixStream)
+        {
+            writeCountMatrix(*countMatrixStream, countMatrix);
+        }
         if (!outputFilePath_.empty())
         {
             if (firstPrinted_)
@@ -222,13 +779,71 @@ void Workflow::run()
         fos << "[";
     }
 
+    boost::iostreams::filtering_ostream countMatrixStream;
+    if (!parameters_.count_matrix_output().empty())
+    {
+        if (graphSpecPaths_.empty())
+        {
+            error("ERROR: Count matrices can only be written for graphs given on the command line");
+        }
+        LOG()->info("Count matrix output file path: {}", parameters_.count_matrix_output());
+        // readCountMatrix decompresses by the extension as well
+        if (boost::algorithm::ends_with(parameters_.count_matrix_output(), ".gz"))
+        {
+            countMatrixStream.push(boost::iostreams::gzip_compressor());
+        }
+        boost::iostreams::basic_file_sink<char> of(parameters_.count_matrix_output());
+        if (!of.is_open())
+        {
+            error(
+                "ERROR: Failed to open count matrix file '%s'. Error: '%s'",
+                parameters_.count_matrix_output().c_str(), std::strerror(errno));
+        }
+        countMatrixStream.push(of);
+    }
+
+    if (parameters_.deduplicate_graphs() && parameters_.alignment_output_folder().empty())
+    {
+        findDuplicateGraphs();
+    }
+
+    unmappedIndexes_.resize(unalignedSamples_.size());
+    if (!parameters_.unmapped_index_dir().empty())
+    {
+        openUnmappedIndexes();
+    }
+
     LOG()->info("Aligning for {} graphs", graphSpecPaths_.size());
-    common::CPU_THREADS(parameters_.threads()).execute([this]() { alignSamples(); });
+    if (parameters_.prefetch_graphs() > 0)
+    {
+        common::Prefetcher<ExtractedGraph> prefetcher(
+            parameters_.prefetch_graphs(),
+            [this](ExtractedGraph& extractedGraph) -> bool { return prefetchGraph(extractedGraph); });
+        common::CPU_THREADS(parameters_.threads()).execute([this, &prefetcher]() {
+            alignPrefetchedGraphs(prefetcher);
+        });
+    }
+    else if (parameters_.sample_major())
+    {
+        orderGraphsByLocus();
+        common::CPU_THREADS(parameters_.threads()).execute([this]() { alignSamplesByLocus(); });
+    }
+    else
+    {
+        common::CPU_THREADS(parameters_.threads()).execute([this]() { alignSamples(); });
+    }
+
+    if (!representatives_.empty())
+    {
+        copyDuplicateAlignments();
+    }
 
     LOG()->info("Genotyping {} samples", alignedSamples_.size());
     std::vector<genotyping::Samples>::const_iterator ungenotypedSamples = alignedSamples_.begin();
-    common::CPU_THREADS(parameters_.threads()).execute([this, &fos, &ungenotypedSamples]() {
-        genotypeGraphs(fos, ungenotypedSamples);
+    std::ostream* const countMatrixOutput
+        = parameters_.count_matrix_output().empty() ? nullptr : &static_cast<std::ostream&>(countMatrixStream);
+    common::CPU_THREADS(parameters_.threads()).execute([this, &fos, countMatrixOutput, &ungenotypedSamples]() {
+        genotypeGraphs(fos, countMatrixOutput, ungenotypedSamples);
     });
 
     if (!outputFilePath_.empty() && 1 < graphSpecPaths_.size())
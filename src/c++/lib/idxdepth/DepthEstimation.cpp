@@ -18,6 +18,7 @@
 //
 
 #include <chrono>
+#include <map>
 #include <htslib/sam.h>
 #include <regex>
 #include <set>
@@ -159,6 +160,9 @@ Json::Value estimateDepths(Parameters const& parameters)
     output["contigs"] = Json::arrayValue;
 
     std::unordered_map<std::string, std::unique_ptr<common::DepthInfo>> per_chromosome_depths;
+    // contig -> read group -> depth, when estimating per read group
+    std::unordered_map<std::string, std::map<std::string, std::unique_ptr<common::DepthInfo>>>
+        per_chromosome_read_group_depths;
 
     size_t read_length = 0;
     bool has_read_length = false;
@@ -201,7 +205,18 @@ Json::Value estimateDepths(Parameters const& parameters)
                 contig_info["length"] = header->target_len[i];
                 contig_info["non_n_length"] = (Json::UInt64)reference.contigNonNSize(contig);
 
-                auto dp_info = depthEstimator.estimateDepth(header->target_name[i]);
+                std::unique_ptr<common::DepthInfo> dp_info;
+                std::map<std::string, std::unique_ptr<common::DepthInfo>> read_group_depths;
+                if (parameters.per_read_group())
+                {
+                    read_group_depths = depthEstimator.estimateReadGroupDepths(header->target_name[i]);
+                    dp_info = std::move(read_group_depths[""]);
+                    read_group_depths.erase("");
+                }
+                else
+                {
+                    dp_info = depthEstimator.estimateDepth(header->target_name[i]);
+                }
 
                 contig_info["depth"] = dp_info->depth_median;
                 contig_info["depth_variance"] = dp_info->depth_variance;
@@ -224,6 +239,7 @@ Json::Value estimateDepths(Parameters const& parameters)
                     read_length = std::max(dp_info->read_length, read_length);
                     has_read_length = true;
                     per_chromosome_depths[contig] = std::move(dp_info);
+                    per_chromosome_read_group_depths[contig] = std::move(read_group_depths);
                 }
 
                 auto t1 = std::chrono::high_resolution_clock::now();
@@ -280,6 +296,42 @@ Json::Value estimateDepths(Parameters const& parameters)
         output["autosome"] = sc_info;
     }
 
+    if (parameters.per_read_group())
+    {
+        // same summary as above for each read group: longest read length, autosome depth
+        std::map<std::string, double> rg_depth;
+        std::map<std::string, size_t> rg_length;
+        std::map<std::string, size_t> rg_read_length;
+        for (const auto& contig_depths : per_chromosome_read_group_depths)
+        {
+            const bool is_autosome = autosome.count(contig_depths.first) != 0;
+            for (const auto& rg_info : contig_depths.second)
+            {
+                if (rg_info.second->read_count > 0)
+                {
+                    size_t& read_length = rg_read_length[rg_info.first];
+                    read_length = std::max(read_length, rg_info.second->read_length);
+                }
+                if (is_autosome)
+                {
+                    rg_depth[rg_info.first] += reference.contigSize(contig_depths.first) * rg_info.second->depth_median;
+                    rg_length[rg_info.first] += reference.contigSize(contig_depths.first);
+                }
+            }
+        }
+        output["read_groups"] = Json::objectValue;
+        for (const auto& read_length : rg_read_length)
+        {
+            Json::Value rg_info;
+            rg_info["read_length"] = (Json::UInt64)read_length.second;
+            if (rg_length[read_length.first] > 0)
+            {
+                rg_info["autosome"]["depth"] = rg_depth[read_length.first] / rg_length[read_length.first];
+            }
+            output["read_groups"][read_length.first] = rg_info;
+        }
+    }
+
     if (!sex_chromosomes.empty())
     {
         Json::Value sc_info;
@@ -26,6 +26,7 @@
  *
  */
 
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <set>
@@ -50,6 +51,7 @@
 #include "paragraph/HaplotypePaths.hh"
 #include "paragraph/ReadCounting.hh"
 #include "paragraph/ReadFilter.hh"
+#include "paragraph/ReferencePrescreen.hh"
 #include "variant/Variant.hh"
 
 #include "spdlog/spdlog.h"
@@ -178,14 +180,31 @@ Json::Value alignAndDisambiguate(const Parameters& parameters, common::ReadBuffe
     const size_t total_reads_input = all_reads.size();
     std::map<std::string, size_t> read_filter_counts;
     std::mutex output_mutex;
-    auto read_filter_function
-        = [&read_filter, &read_filter_counts, &parameters, &output, &output_reads, &output_mutex](Read& r) -> bool {
+
+    // reads may be aligned on several threads, filtered reads are output in input order
+    std::unordered_map<const Read*, size_t> input_index;
+    if (parameters.output_enabled(Parameters::FILTERED_ALIGNMENTS))
+    {
+        for (size_t index = 0; index != all_reads.size(); ++index)
+        {
+            input_index[all_reads[index].get()] = index;
+        }
+    }
+    struct FilteredRead
+    {
+        size_t input_index;
+        std::string error;
+        common::p_Read read;
+    };
+    std::vector<FilteredRead> filtered_reads;
+
+    auto read_filter_function = [&read_filter, &read_filter_counts, &parameters, &input_index, &filtered_reads,
+                                 &output_mutex](Read& r) -> bool {
         const auto result_and_error = read_filter->filterRead(r);
         if (result_and_error.first && parameters.output_enabled(Parameters::FILTERED_ALIGNMENTS))
         {
             r.set_graph_mapping_status(common::Read::BAD_ALIGN);
-            Json::Value r_json = r.toJson();
-            r_json["error"] = result_and_error.second;
+            FilteredRead filtered_read{ input_index.at(&r), result_and_error.second, common::p_Read(new Read(r)) };
             {
                 std::lock_guard<std::mutex> output_guard(output_mutex);
                 auto count_it = read_filter_counts.find(result_and_error.second);
@@ -197,17 +216,74 @@ Json::Value alignAndDisambiguate(const Parameters& parameters, common::ReadBuffe
                 {
                     count_it->second++;
                 }
-                output["alignments"].append(r_json);
-                output_reads.emplace_back(new Read(r));
+                filtered_reads.push_back(std::move(filtered_read));
             }
         }
         return result_and_error.first;
     };
 
+    // when no read has an alt-specific k-mer, reads are placed on the reference path without graph alignment.
+    // With read triage, this is also done for single reads which can only support a reference flank.
+    common::ReadBuffer reference_reads;
+    std::unordered_map<const Read*, size_t> reference_order;
+    if (parameters.reference_prescreen() || parameters.read_triage() != Parameters::NO_TRIAGE)
+    {
+        const ReferencePrescreen prescreen(&graph, parameters.description());
+        const bool reference_only = parameters.reference_prescreen() && prescreen.enabled()
+            && std::none_of(all_reads.begin(), all_reads.end(),
+                            [&prescreen](common::p_Read const& read) { return prescreen.hasAltKmer(*read); });
+        const double triage_mismatch_fraction = parameters.read_triage() == Parameters::TRIAGE_EXACT ? 0.0 : 0.05;
+        if (prescreen.enabled() && (reference_only || parameters.read_triage() != Parameters::NO_TRIAGE))
+        {
+            common::ReadBuffer unplaced_reads;
+            for (size_t index = 0; index != all_reads.size(); ++index)
+            {
+                auto& read = all_reads[index];
+                reference_order[read.get()] = index;
+                const bool placed = reference_only ? prescreen.alignToReference(*read)
+                                                   : prescreen.alignToFlank(*read, triage_mismatch_fraction);
+                // a placed read which the filter rejects is aligned to the graph instead, only the filter calls
+                // of the aligners record it as filtered
+                if (placed && !read_filter->filterRead(*read).first)
+                {
+                    reference_reads.emplace_back(std::move(read));
+                    continue;
+                }
+                unplaced_reads.emplace_back(std::move(read));
+            }
+            all_reads = std::move(unplaced_reads);
+            logger->info(
+                "[{} placed {} of {} reads on the reference path]",
+                reference_only ? "Reference prescreen" : "Read triage", reference_reads.size(), total_reads_input);
+        }
+    }
+
     grm::alignReads(
         &graph, grm::pathsFromJson(&graph, parameters.description()["paths"]), all_reads, read_filter_function,
         parameters.path_sequence_matching(), parameters.graph_sequence_matching(), parameters.klib_sequence_matching(),
-        parameters.kmer_sequence_matching(), parameters.validate_alignments(), parameters.threads());
+        parameters.kmer_sequence_matching(), parameters.validate_alignments(), parameters.threads(),
+        parameters.min_split_cost());
+
+    if (!reference_reads.empty())
+    {
+        std::move(reference_reads.begin(), reference_reads.end(), std::back_inserter(all_reads));
+        std::stable_sort(
+            all_reads.begin(), all_reads.end(), [&reference_order](common::p_Read const& a, common::p_Read const& b) {
+                return reference_order.at(a.get()) < reference_order.at(b.get());
+            });
+    }
+
+    // the composite aligner filters a read again after each aligner it tries, keep the order of these
+    std::stable_sort(
+        filtered_reads.begin(), filtered_reads.end(),
+        [](FilteredRead const& a, FilteredRead const& b) { return a.input_index < b.input_index; });
+    for (FilteredRead& filtered_read : filtered_reads)
+    {
+        Json::Value r_json = filtered_read.read->toJson();
+        r_json["error"] = filtered_read.error;
+        output["alignments"].append(r_json);
+        output_reads.emplace_back(std::move(filtered_read.read));
+    }
 
     auto nodefilter = [&graph, &node_id_map](Read& read, const std::string& node) -> bool {
         try
@@ -359,4 +435,19 @@ Json::Value alignAndDisambiguate(const Parameters& parameters, common::ReadBuffe
 
     return output;
 }
+
+Json::Value
+relabelResult(Json::Value const& result, Json::Value const& result_description, Json::Value const& description)
+{
+    Json::Value relabeled = description;
+    for (const auto& key : result.getMemberNames())
+    {
+        // keep everything that was computed or updated during alignment
+        if (!result_description.isMember(key) || result[key] != result_description[key])
+        {
+            relabeled[key] = result[key];
+        }
+    }
+    return relabeled;
+}
 }
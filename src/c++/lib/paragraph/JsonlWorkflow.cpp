@@ -0,0 +1,180 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Streaming workflow for graphs given one per line
+ *
+ * \file JsonlWorkflow.cpp
+ *
+ */
+
+#include "paragraph/JsonlWorkflow.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "common/Threads.hh"
+#include "paragraph/Server.hh"
+
+#include "common/Error.hh"
+
+namespace paragraph
+{
+
+JsonlWorkflow::JsonlWorkflow(
+    const InputPaths& inputPaths, const InputPaths& inputIndexPaths, const std::string& graphJsonlPath,
+    const std::string& outputFilePath, bool gzipOutput, const Parameters& parameters,
+    const std::string& referencePath, const std::string& targetRegions)
+    : inputPaths_(inputPaths)
+    , inputIndexPaths_(inputIndexPaths)
+    , graphJsonlPath_(graphJsonlPath)
+    , outputFilePath_(outputFilePath)
+    , gzipOutput_(gzipOutput)
+    , parameters_(parameters)
+    , referencePath_(referencePath)
+    , targetRegions_(targetRegions)
+    , memoryBudget_(parameters.max_memory())
+    , readLength_(estimateInputReadLength(inputPaths, inputIndexPaths, referencePath, memoryBudget_))
+{
+}
+
+void JsonlWorkflow::run()
+{
+    boost::iostreams::filtering_istream input;
+    std::ifstream inputFile;
+    if ("-" == graphJsonlPath_)
+    {
+        LOG()->info("Reading graphs from stdin");
+        input.push(std::cin);
+    }
+    else
+    {
+        LOG()->info("Reading graphs from {}", graphJsonlPath_);
+        inputFile.open(graphJsonlPath_, std::ios::binary);
+        if (!inputFile)
+        {
+            error("ERROR: Failed to open graph file '%s'. Error: '%s'", graphJsonlPath_.c_str(), std::strerror(errno));
+        }
+        if (boost::algorithm::ends_with(graphJsonlPath_, ".gz"))
+        {
+            input.push(boost::iostreams::gzip_decompressor());
+        }
+        input.push(inputFile);
+    }
+
+    boost::iostreams::filtering_ostream output;
+    if (gzipOutput_)
+    {
+        output.push(boost::iostreams::gzip_compressor());
+    }
+    if ("-" != outputFilePath_)
+    {
+        LOG()->info("Output file path: {}", outputFilePath_);
+        boost::iostreams::basic_file_sink<char> of(outputFilePath_);
+        if (!of.is_open())
+        {
+            error("ERROR: Failed to open output file '%s'. Error: '%s'", outputFilePath_.c_str(), std::strerror(errno));
+        }
+        output.push(of);
+    }
+    else
+    {
+        LOG()->info("Output to stdout");
+        output.push(std::cout);
+    }
+
+    processStream(input, output);
+}
+
+void JsonlWorkflow::processStream(std::istream& input, std::ostream& output)
+{
+    common::CPU_THREADS(parameters_.threads()).execute([this, &input, &output]() { processGraphs(input, output); });
+    output.flush();
+    LOG()->info("Processed {} graphs", linesWritten_);
+}
+
+void JsonlWorkflow::processGraphs(std::istream& input, std::ostream& output)
+{
+    // readers are opened once per thread and shared by all graphs this thread processes
+    std::vector<common::BamReader> readers;
+    for (size_t i = 0; i != inputPaths_.size(); ++i)
+    {
+        LOG()->info("Opening {}/{} with {}", inputPaths_[i], inputIndexPaths_[i], referencePath_);
+        readers.emplace_back(inputPaths_[i], inputIndexPaths_[i], referencePath_);
+        readers.back().enableReadCache(parameters_.read_cache_size());
+    }
+
+    // graphs are only read this far ahead of the next output, so a slow graph doesn't make the others pile up
+    const std::size_t maxPendingLines = 2 * std::max<std::size_t>(1, parameters_.threads());
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        outputWritten_.wait(lock, [this, maxPendingLines]() {
+            return terminate_ || linesRead_ - linesWritten_ < maxPendingLines;
+        });
+        std::string line;
+        if (terminate_ || !std::getline(input, line))
+        {
+            break;
+        }
+        boost::algorithm::trim(line);
+        if (line.empty())
+        {
+            continue;
+        }
+        const std::size_t lineIndex = linesRead_++;
+
+        std::string graphOutput;
+        ASYNC_BLOCK_WITH_CLEANUP([this](bool failure) {
+            if (failure)
+            {
+                terminate_ = true;
+                outputWritten_.notify_all();
+            }
+        })
+        {
+            common::unlock_guard<std::mutex> unlock(mutex_);
+            graphOutput = processGraphRequest(
+                line, parameters_, referencePath_, targetRegions_, inputPaths_, readers, memoryBudget_, readLength_);
+        }
+
+        pendingOutputs_[lineIndex] = std::move(graphOutput);
+        for (auto next = pendingOutputs_.begin(); next != pendingOutputs_.end() && next->first == linesWritten_;
+             next = pendingOutputs_.erase(next))
+        {
+            output << next->second << '\n';
+            if (!output)
+            {
+                error("ERROR: Failed to write output to '%s' error: '%s'", outputFilePath_.c_str(), std::strerror(errno));
+            }
+            ++linesWritten_;
+        }
+        outputWritten_.notify_all();
+    }
+}
+}
@@ -28,9 +28,14 @@
 
 #include "paragraph/Parameters.hh"
 #include "common/Error.hh"
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 
+#include "common/JsonHelpers.hh"
+#include "common/ReadExtraction.hh"
 #include "common/StringUtil.hh"
+#include "grm/GraphInput.hh"
 #include "json/json.h"
 
 namespace paragraph
@@ -39,11 +44,16 @@ namespace paragraph
 void Parameters::load(
     const std::string& graph_path, const std::string& reference_path, const std::string& override_target_regions)
 {
-    reference_path_ = reference_path;
-
     Json::Value root;
     std::ifstream graph_desc(graph_path);
     graph_desc >> root;
+    loadDescription(root, reference_path, override_target_regions);
+}
+
+void Parameters::loadDescription(
+    Json::Value root, const std::string& reference_path, const std::string& override_target_regions)
+{
+    reference_path_ = reference_path;
 
     // compatibility with graph key
     if (root.isMember("graph"))
@@ -80,12 +90,90 @@ void Parameters::load(
         max_reads_ = root["max_reads"].asUInt64();
     }
 
+    alt_sequences_.clear();
     for (auto& node : description_["nodes"])
     {
         if (node.isMember("sequence") && node["sequence"].asString().size() > longest_alt_insertion_)
         {
             longest_alt_insertion_ = node["sequence"].asString().size();
         }
+        if (node.isMember("sequence") && !node.isMember("reference"))
+        {
+            alt_sequences_.push_back(node["sequence"].asString());
+        }
+    }
+
+    recover_mates_ = false;
+    if (breakpoint_window_ > 0 && override_target_regions.empty())
+    {
+        // reads are extracted with three average fragment lengths of flank around each region, so closer windows
+        // would read the same records twice
+        const int64_t merge_distance = 2 * 3 * common::kAverageFragmentLength;
+        target_regions_
+            = grm::breakpointWindowsFromJson(description_, target_regions_, breakpoint_window_, merge_distance);
+
+        // mates between the windows are not read
+        for (auto window = target_regions_.begin(); window != target_regions_.end(); ++window)
+        {
+            const auto next_window = std::next(window);
+            if (next_window != target_regions_.end() && next_window->chrom == window->chrom)
+            {
+                recover_mates_ = true;
+            }
+        }
+    }
+}
+
+Json::Value Parameters::alignmentSettings() const
+{
+    Json::Value settings;
+    settings["max_reads"] = static_cast<Json::UInt64>(max_reads_);
+    settings["min_reads_for_variant"] = min_reads_for_variant_;
+    settings["min_frac_for_variant"] = min_frac_for_variant_;
+    settings["bad_align_frac"] = bad_align_frac_;
+    settings["output_options"] = output_options_;
+    settings["path_sequence_matching"] = path_sequence_matching_;
+    settings["graph_sequence_matching"] = graph_sequence_matching_;
+    settings["klib_sequence_matching"] = klib_sequence_matching_;
+    settings["kmer_sequence_matching"] = kmer_sequence_matching_;
+    settings["validate_alignments"] = validate_alignments_;
+    settings["kmer_len"] = kmer_len_;
+    settings["remove_nonuniq_reads"] = remove_nonuniq_reads_;
+    settings["target_regions"] = Json::arrayValue;
+    for (const auto& region : target_regions_)
+    {
+        settings["target_regions"].append(std::string(region));
+    }
+    if (reference_prescreen_)
+    {
+        settings["reference_prescreen"] = true;
+    }
+    if (read_triage_ != NO_TRIAGE)
+    {
+        settings["read_triage"] = read_triage_;
+    }
+    if (!unmapped_index_dir_.empty())
+    {
+        settings["unmapped_index_mapq"] = unmapped_index_mapq_;
+    }
+    return settings;
+}
+
+std::string Parameters::fingerprint() const
+{
+    Json::Value settings = alignmentSettings();
+    settings["graph"] = description_;
+    return common::writeJson(settings, false);
+}
+
+std::string Parameters::graphFingerprint() const
+{
+    Json::Value settings = alignmentSettings();
+    // IDs, model names and other annotations don't change how reads align to the graph
+    for (const char* key : { "nodes", "edges", "paths", "sequencenames" })
+    {
+        settings["graph"][key] = description_[key];
     }
+    return common::writeJson(settings, false);
 }
 }
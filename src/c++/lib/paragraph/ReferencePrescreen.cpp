@@ -0,0 +1,350 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Prescreen reads for alt-specific k-mers to skip graph alignment at reference-only loci
+ *
+ * \file ReferencePrescreen.cpp
+ *
+ */
+
+#include "paragraph/ReferencePrescreen.hh"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/Region.hh"
+#include "graphalign/GraphAlignmentOperations.hh"
+#include "graphalign/KmerIndex.hh"
+#include "graphcore/Path.hh"
+#include "grm/GraphAligner.hh"
+#include "oligo/KmerBloomFilter.hh"
+#include "oligo/KmerGenerator.hh"
+
+#include "common/Error.hh"
+
+namespace paragraph
+{
+
+using graphtools::NodeId;
+
+namespace
+{
+    // same k-mer length as the KmerAligner
+    const unsigned kKmerLength = 16;
+    typedef oligo::KmerGenerator<kKmerLength, unsigned, std::string::const_iterator> KmerGenerator;
+}
+
+struct ReferencePrescreen::Impl
+{
+    graphtools::Graph const* graph = nullptr;
+    bool enabled = false;
+
+    // 0-based start of the reference path on the linear reference
+    int64_t reference_start = 0;
+    std::string reference_sequence;
+    // start of each reference node in reference_sequence
+    std::vector<int64_t> node_starts;
+    std::unique_ptr<graphtools::Path> reference_path;
+
+    // k-mers which only occur on non-reference paths
+    std::unordered_set<unsigned> alt_kmers;
+    // k-mers which occur once in the graph, on the reference path
+    std::unordered_set<unsigned> unique_reference_kmers;
+    // k-mers which span an edge or lie on a non-reference node
+    std::unique_ptr<oligo::KmerBloomFilter<unsigned>> informative_kmers;
+
+    bool loadReferencePath(Json::Value const& description);
+    void indexKmers();
+};
+
+/**
+ * Find the reference path and check that its nodes follow each other on the linear reference
+ * @return false if there is no such path
+ */
+bool ReferencePrescreen::Impl::loadReferencePath(Json::Value const& description)
+{
+    std::unordered_map<std::string, NodeId> node_ids;
+    for (NodeId node_id = 0; node_id != graph->numNodes(); ++node_id)
+    {
+        node_ids[graph->nodeName(node_id)] = node_id;
+    }
+    std::unordered_map<std::string, Json::Value const*> node_descriptions;
+    for (const auto& node : description["nodes"])
+    {
+        node_descriptions[node["name"].asString()] = &node;
+    }
+
+    for (const auto& path : description["paths"])
+    {
+        if (path["sequence"].asString() != "REF" || path["nodes"].empty())
+        {
+            continue;
+        }
+        std::vector<NodeId> nodes;
+        common::Region previous;
+        for (const auto& node_name : path["nodes"])
+        {
+            const auto node_id = node_ids.find(node_name.asString());
+            const auto node_description = node_descriptions.find(node_name.asString());
+            if (node_id == node_ids.end() || node_description == node_descriptions.end()
+                || !node_description->second->isMember("reference"))
+            {
+                return false;
+            }
+            const common::Region region((*node_description->second)["reference"].asString());
+            if (region.length() != static_cast<int64_t>(graph->nodeSeq(node_id->second).size())
+                || (!nodes.empty() && (region.chrom != previous.chrom || region.start != previous.end + 1)))
+            {
+                return false;
+            }
+            if (nodes.empty())
+            {
+                reference_start = region.start;
+            }
+            previous = region;
+            node_starts.push_back(static_cast<int64_t>(reference_sequence.size()));
+            nodes.push_back(node_id->second);
+            reference_sequence += graph->nodeSeq(node_id->second);
+        }
+        reference_path.reset(new graphtools::Path(
+            graph, 0, nodes, static_cast<int32_t>(graph->nodeSeq(nodes.back()).size() - 1)));
+        return true;
+    }
+    return false;
+}
+
+void ReferencePrescreen::Impl::indexKmers()
+{
+    std::unordered_map<NodeId, size_t> reference_index;
+    for (size_t index = 0; index != reference_path->numNodes(); ++index)
+    {
+        reference_index[reference_path->nodeIds()[index]] = index;
+    }
+    const auto is_on_reference = [&reference_index](graphtools::Path const& path) -> bool {
+        size_t previous_index = 0;
+        for (size_t index = 0; index != path.numNodes(); ++index)
+        {
+            const auto node_index = reference_index.find(path.nodeIds()[index]);
+            if (node_index == reference_index.end() || (index > 0 && node_index->second != previous_index + 1))
+            {
+                return false;
+            }
+            previous_index = node_index->second;
+        }
+        return true;
+    };
+
+    const graphtools::KmerIndex index(*graph, kKmerLength);
+    informative_kmers.reset(new oligo::KmerBloomFilter<unsigned>(index.kmers().size()));
+    for (const auto& kmer_sequence : index.kmers())
+    {
+        unsigned kmer = 0;
+        std::string::const_iterator position;
+        KmerGenerator generator(kmer_sequence.begin(), kmer_sequence.end());
+        if (!generator.next(kmer, position))
+        {
+            // has an N
+            continue;
+        }
+        const auto& paths = index.getPaths(kmer_sequence);
+        if (std::any_of(paths.begin(), paths.end(), [&reference_index](graphtools::Path const& path) {
+                return path.numNodes() > 1 || reference_index.count(path.nodeIds().front()) == 0;
+            }))
+        {
+            informative_kmers->insert(kmer);
+        }
+        if (std::none_of(paths.begin(), paths.end(), is_on_reference))
+        {
+            alt_kmers.insert(kmer);
+        }
+        else if (paths.size() == 1)
+        {
+            unique_reference_kmers.insert(kmer);
+        }
+    }
+}
+
+ReferencePrescreen::ReferencePrescreen(graphtools::Graph const* graph, Json::Value const& description)
+    : impl_(new Impl())
+{
+    impl_->graph = graph;
+    impl_->enabled = impl_->loadReferencePath(description);
+    if (impl_->enabled)
+    {
+        impl_->indexKmers();
+    }
+}
+
+ReferencePrescreen::~ReferencePrescreen() = default;
+
+bool ReferencePrescreen::enabled() const { return impl_->enabled; }
+
+bool ReferencePrescreen::hasAltKmer(common::Read const& read) const
+{
+    if (read.bases().size() < kKmerLength)
+    {
+        return false;
+    }
+    KmerGenerator generator(read.bases().begin(), read.bases().end());
+    unsigned kmer = 0;
+    std::string::const_iterator position;
+    while (generator.next(kmer, position))
+    {
+        if (impl_->alt_kmers.count(kmer) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReferencePrescreen::hasInformativeKmer(common::Read const& read) const
+{
+    if (!impl_->enabled || read.bases().size() < kKmerLength)
+    {
+        return true;
+    }
+    KmerGenerator generator(read.bases().begin(), read.bases().end());
+    unsigned kmer = 0;
+    std::string::const_iterator position;
+    while (generator.next(kmer, position))
+    {
+        if (impl_->informative_kmers->mayContain(kmer))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReferencePrescreen::alignToFlank(common::Read& read, double max_mismatch_fraction) const
+{
+    // mismatches can hide the k-mers of reads that overlap a neighbouring node by a few bases
+    const int64_t offset = read.pos() - impl_->reference_start;
+    const int64_t end = offset + static_cast<int64_t>(read.bases().size());
+    if (!impl_->enabled || offset < 0 || hasInformativeKmer(read))
+    {
+        return false;
+    }
+    const auto next_node = std::upper_bound(impl_->node_starts.begin(), impl_->node_starts.end(), offset);
+    if (next_node != impl_->node_starts.end() && *next_node < end)
+    {
+        return false;
+    }
+    return alignToReference(read, max_mismatch_fraction);
+}
+
+bool ReferencePrescreen::alignToReference(common::Read& read, double max_mismatch_fraction) const
+{
+    const std::string& bases = read.bases();
+    if (!impl_->enabled || !read.has_single_match_cigar() || bases.size() < kKmerLength)
+    {
+        return false;
+    }
+
+    // reads which overhang the reference path are left to the graph aligners, which decide how to clip them
+    const int64_t offset = read.pos() - impl_->reference_start;
+    if (offset < 0
+        || offset + static_cast<int64_t>(bases.size()) > static_cast<int64_t>(impl_->reference_sequence.size()))
+    {
+        return false;
+    }
+
+    // score like the local alignment of the graph aligner: the highest scoring segment of the ungapped
+    // alignment is kept and the remaining ends are clipped
+    int64_t mismatches = 0;
+    int32_t score = 0;
+    size_t segment_start = 0;
+    int32_t best_score = 0;
+    size_t best_start = 0;
+    size_t best_end = 0;
+    for (size_t query_pos = 0; query_pos != bases.size(); ++query_pos)
+    {
+        const bool is_match = bases[query_pos] == impl_->reference_sequence[offset + query_pos];
+        mismatches += is_match ? 0 : 1;
+        score += is_match ? grm::GraphAligner::DEFAULT_MATCH : -grm::GraphAligner::DEFAULT_MISMATCH;
+        if (score <= 0)
+        {
+            score = 0;
+            segment_start = query_pos + 1;
+        }
+        else if (score > best_score)
+        {
+            best_score = score;
+            best_start = segment_start;
+            best_end = query_pos + 1;
+        }
+    }
+    if (mismatches > bases.size() * max_mismatch_fraction || best_score == 0)
+    {
+        return false;
+    }
+
+    std::string cigar = best_start > 0 ? std::to_string(best_start) + "S" : std::string();
+    char operation = 0;
+    int64_t operation_length = 0;
+    for (size_t query_pos = best_start; query_pos != best_end; ++query_pos)
+    {
+        const char current_operation = bases[query_pos] == impl_->reference_sequence[offset + query_pos] ? 'M' : 'X';
+        if (current_operation != operation && operation_length > 0)
+        {
+            cigar += std::to_string(operation_length) + operation;
+            operation_length = 0;
+        }
+        operation = current_operation;
+        ++operation_length;
+    }
+    cigar += std::to_string(operation_length) + operation;
+    if (best_end < bases.size())
+    {
+        cigar += std::to_string(bases.size() - best_end) + "S";
+    }
+
+    // the read must have a k-mer which places it uniquely, otherwise the graph aligners would not either
+    KmerGenerator generator(bases.begin(), bases.end());
+    unsigned kmer = 0;
+    std::string::const_iterator position;
+    bool is_unique = false;
+    while (!is_unique && generator.next(kmer, position))
+    {
+        is_unique = impl_->unique_reference_kmers.count(kmer) != 0;
+    }
+    if (!is_unique)
+    {
+        return false;
+    }
+
+    const graphtools::GraphAlignment alignment = graphtools::projectAlignmentOntoGraph(
+        graphtools::Alignment(static_cast<uint32_t>(offset + best_start), cigar), *impl_->reference_path);
+    // BAM records store bases on the forward strand of the reference
+    read.set_is_graph_reverse_strand(read.is_reverse_strand());
+    read.set_graph_pos(alignment.path().startPosition());
+    read.set_graph_cigar(alignment.generateCigar());
+    read.set_graph_alignment_score(best_score);
+    // the graph aligner gives unique alignments a MAPQ of 60
+    read.set_graph_mapq(60);
+    read.set_is_graph_alignment_unique(true);
+    read.set_graph_mapping_status(common::Read::MAPPED);
+    return true;
+}
+}
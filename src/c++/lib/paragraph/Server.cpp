@@ -0,0 +1,335 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ * \brief Paragraph server implementation
+ *
+ * \file Server.cpp
+ *
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common/JsonHelpers.hh"
+#include "common/ReadExtraction.hh"
+#include "common/Threads.hh"
+#include "paragraph/Disambiguation.hh"
+#include "paragraph/Server.hh"
+
+#include "common/Error.hh"
+
+namespace paragraph
+{
+
+/**
+ * Read the next newline-terminated line from a socket
+ * @param buffer data received but not consumed yet, kept between calls
+ * @return false when the peer has closed the connection and no data is left
+ */
+static bool readLine(int connection, std::string& buffer, std::string& line)
+{
+    size_t newline = buffer.find('\n');
+    while (std::string::npos == newline)
+    {
+        char chunk[65536];
+        const ssize_t received = ::recv(connection, chunk, sizeof(chunk), 0);
+        if (received < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (received < 0)
+        {
+            error("ERROR: Failed to read request: '%s'", std::strerror(errno));
+        }
+        if (0 == received)
+        {
+            // allow the last request to be terminated by closing the write side of the socket
+            line.swap(buffer);
+            buffer.clear();
+            return !line.empty();
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+        newline = buffer.find('\n');
+    }
+    line = buffer.substr(0, newline);
+    buffer.erase(0, newline + 1);
+    return true;
+}
+
+static void writeAll(int connection, const std::string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        const ssize_t result = ::send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (result < 0)
+        {
+            error("ERROR: Failed to write response: '%s'", std::strerror(errno));
+        }
+        sent += static_cast<size_t>(result);
+    }
+}
+
+Server::Server(
+    const std::string& socketPath, const InputPaths& inputPaths, const InputPaths& inputIndexPaths,
+    const Parameters& parameters, const std::string& referencePath, const std::string& targetRegions)
+    : socketPath_(socketPath)
+    , inputPaths_(inputPaths)
+    , inputIndexPaths_(inputIndexPaths)
+    , parameters_(parameters)
+    , referencePath_(referencePath)
+    , targetRegions_(targetRegions)
+    , reference_(referencePath)
+    , memoryBudget_(parameters.max_memory())
+    , readLength_(estimateInputReadLength(inputPaths, inputIndexPaths, referencePath, memoryBudget_))
+    , stopped_(false)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath_.size() >= sizeof(address.sun_path))
+    {
+        error("ERROR: Socket path '%s' is too long", socketPath_.c_str());
+    }
+    std::strncpy(address.sun_path, socketPath_.c_str(), sizeof(address.sun_path) - 1);
+
+    listenSocket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket_ < 0)
+    {
+        error("ERROR: Failed to create socket: '%s'", std::strerror(errno));
+    }
+    // remove a stale socket left behind by a previous server, but never any other file
+    struct stat existing;
+    if (::lstat(socketPath_.c_str(), &existing) == 0)
+    {
+        if (!S_ISSOCK(existing.st_mode))
+        {
+            ::close(listenSocket_);
+            error("ERROR: '%s' exists and is not a socket", socketPath_.c_str());
+        }
+        ::unlink(socketPath_.c_str());
+    }
+    // requests name files to read, so only the owner may connect
+    const mode_t previousUmask = ::umask(S_IRWXG | S_IRWXO | S_IXUSR);
+    const int bindResult = ::bind(listenSocket_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    const int bindErrno = errno;
+    ::umask(previousUmask);
+    if (bindResult < 0 || ::listen(listenSocket_, SOMAXCONN) < 0)
+    {
+        const int listenErrno = bindResult < 0 ? bindErrno : errno;
+        ::close(listenSocket_);
+        error("ERROR: Failed to listen on '%s': '%s'", socketPath_.c_str(), std::strerror(listenErrno));
+    }
+    LOG()->info("Listening on {}", socketPath_);
+}
+
+Server::~Server()
+{
+    if (listenSocket_ >= 0)
+    {
+        ::close(listenSocket_);
+        ::unlink(socketPath_.c_str());
+    }
+}
+
+void Server::stop()
+{
+    if (!stopped_.exchange(true))
+    {
+        LOG()->info("Shutting down server on {}", socketPath_);
+        // wakes up all threads waiting in accept
+        ::shutdown(listenSocket_, SHUT_RDWR);
+    }
+}
+
+void Server::run()
+{
+    common::CPU_THREADS(parameters_.threads()).execute([this]() { serveConnections(); });
+}
+
+void Server::serveConnections()
+{
+    ASYNC_BLOCK_WITH_CLEANUP([this](bool failure) {
+        if (failure)
+        {
+            stop();
+        }
+    })
+    {
+        std::vector<common::BamReader> readers;
+        for (size_t i = 0; i != inputPaths_.size(); ++i)
+        {
+            LOG()->info("Opening {}/{} with {}", inputPaths_[i], inputIndexPaths_[i], referencePath_);
+            readers.emplace_back(inputPaths_[i], inputIndexPaths_[i], referencePath_);
+            readers.back().enableReadCache(parameters_.read_cache_size());
+        }
+
+        while (!stopped_)
+        {
+            const int connection = ::accept(listenSocket_, nullptr, nullptr);
+            if (connection < 0)
+            {
+                if (stopped_)
+                {
+                    break;
+                }
+                if (EINTR == errno || ECONNABORTED == errno)
+                {
+                    continue;
+                }
+                error("ERROR: Failed to accept connection on '%s': '%s'", socketPath_.c_str(), std::strerror(errno));
+            }
+            try
+            {
+                serveConnection(connection, readers);
+            }
+            catch (const std::exception& e)
+            {
+                // the client has gone away, keep serving others
+                LOG()->warn("Connection closed: {}", e.what());
+            }
+            ::close(connection);
+        }
+    }
+}
+
+void Server::serveConnection(int connection, std::vector<common::BamReader>& readers)
+{
+    std::string buffer;
+    std::string request;
+    while (readLine(connection, buffer, request))
+    {
+        boost::algorithm::trim(request);
+        if (request.empty())
+        {
+            continue;
+        }
+        if ("shutdown" == request)
+        {
+            stop();
+            return;
+        }
+
+        std::string response;
+        try
+        {
+            response = processRequest(request, readers);
+        }
+        catch (const std::exception& e)
+        {
+            LOG()->warn("Request failed: {}", e.what());
+            Json::Value errorJson;
+            errorJson["error"] = e.what();
+            response = common::writeJson(errorJson, false);
+        }
+        writeAll(connection, response + "\n");
+    }
+}
+
+std::string Server::processRequest(const std::string& request, std::vector<common::BamReader>& readers)
+{
+    return processGraphRequest(
+        request, parameters_, referencePath_, targetRegions_, inputPaths_, readers, memoryBudget_, readLength_);
+}
+
+std::string processGraphRequest(
+    const std::string& request, const Parameters& defaultParameters, const std::string& referencePath,
+    const std::string& targetRegions, const std::vector<std::string>& inputPaths,
+    std::vector<common::BamReader>& readers, common::MemoryBudget& memoryBudget, std::size_t readLength)
+{
+    Json::Value graph;
+    if ('{' == request.front())
+    {
+        std::istringstream input(request);
+        input >> graph;
+    }
+    else if (boost::filesystem::is_regular_file(request))
+    {
+        graph = common::getJSON(request);
+    }
+    else
+    {
+        error("ERROR: Graph file '%s' does not exist", request.c_str());
+    }
+
+    Parameters parameters = defaultParameters;
+    parameters.loadDescription(graph, referencePath, targetRegions);
+
+    std::size_t estimatedReads = 0;
+    if (!memoryBudget.unlimited())
+    {
+        for (common::BamReader& reader : readers)
+        {
+            estimatedReads
+                += common::estimateNumReads(reader, parameters.target_regions(), (int)(parameters.max_reads()));
+        }
+    }
+    common::MemoryReservation reservation(memoryBudget, common::estimateReadBufferSize(estimatedReads, readLength));
+
+    common::ReadBuffer allReads;
+    for (common::BamReader& reader : readers)
+    {
+        common::extractReads(
+            reader, parameters.target_regions(), (int)(parameters.max_reads()), parameters.longest_alt_insertion(),
+            allReads, common::kAverageFragmentLength, 0.0, parameters.recover_mates());
+    }
+
+    Json::Value outputJson = alignAndDisambiguate(parameters, allReads);
+    if (inputPaths.size() == 1)
+    {
+        outputJson["bam"] = inputPaths.front();
+    }
+    else
+    {
+        outputJson["bam"] = Json::arrayValue;
+        for (const auto& inputPath : inputPaths)
+        {
+            outputJson["bam"].append(inputPath);
+        }
+    }
+    return common::writeJson(outputJson, false);
+}
+
+std::size_t estimateInputReadLength(
+    const std::vector<std::string>& inputPaths, const std::vector<std::string>& inputIndexPaths,
+    const std::string& referencePath, const common::MemoryBudget& memoryBudget)
+{
+    if (memoryBudget.unlimited() || inputPaths.empty())
+    {
+        return 0;
+    }
+    common::BamReader reader(inputPaths.front(), inputIndexPaths.front(), referencePath);
+    const std::size_t readLength = common::estimateReadLength(reader);
+    LOG()->info("Estimated read length of {}: {}", inputPaths.front(), readLength);
+    return readLength;
+}
+}
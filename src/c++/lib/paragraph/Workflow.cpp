@@ -26,10 +26,15 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <mutex>
+#include <sstream>
 #include <thread>
+#include <unordered_map>
 
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/device/file.hpp>
@@ -58,6 +63,8 @@ Workflow::Workflow(
     , parameters_(parameters)
     , referencePath_(reference_path)
     , targetRegions_(target_regions)
+    , memoryBudget_(parameters.max_memory())
+    , resultCache_(parameters.cache_dir())
 {
     if (jointInputs)
     {
@@ -84,17 +91,92 @@ static void dumpOutput(const std::string& output, std::ostream& os, const std::s
     }
 }
 
-std::string Workflow::processGraph(
-    const std::string& graphSpecPath, const Parameters& parameters, const InputPaths& inputPaths,
-    std::vector<common::BamReader>& readers)
+/**
+ * Results depend on the graph, the settings, the input files and the reference
+ */
+std::string Workflow::cacheKey(const Parameters& parameters, const InputPaths& inputPaths) const
+{
+    common::CacheKey key;
+    key.add("paragraph", parameters.fingerprint());
+    for (const auto& inputPath : inputPaths)
+    {
+        key.addFile("bam", inputPath);
+    }
+    key.addFile("reference", referencePath_);
+    return key.digest();
+}
+
+std::unique_ptr<common::MemoryReservation>
+Workflow::reserveMemory(const Parameters& parameters, const Input& input, std::vector<common::BamReader>& readers)
+{
+    std::size_t estimatedReads = 0;
+    if (!memoryBudget_.unlimited())
+    {
+        for (common::BamReader& reader : readers)
+        {
+            estimatedReads
+                += common::estimateNumReads(reader, parameters.target_regions(), (int)(parameters.max_reads()));
+        }
+    }
+    return std::unique_ptr<common::MemoryReservation>(new common::MemoryReservation(
+        memoryBudget_, common::estimateReadBufferSize(estimatedReads, input.readLength_)));
+}
+
+void Workflow::extractGraphReads(
+    const Parameters& parameters, const Input& input, std::vector<common::BamReader>& readers,
+    common::ReadBuffer& allReads)
 {
-    common::ReadBuffer allReads;
     for (common::BamReader& reader : readers)
     {
         common::extractReads(
             reader, parameters.target_regions(), (int)(parameters.max_reads()), parameters.longest_alt_insertion(),
-            allReads);
+            allReads, common::kAverageFragmentLength, 0.0, parameters.recover_mates());
     }
+    recruitUnmappedReads(input, parameters, allReads);
+}
+
+/**
+ * Build or map the unmapped read index of each input, one input per thread
+ */
+void Workflow::openUnmappedIndexes()
+{
+    boost::filesystem::create_directories(parameters_.unmapped_index_dir());
+    std::atomic<std::size_t> nextInput(0);
+    common::CPU_THREADS(parameters_.threads()).execute([this, &nextInput]() {
+        for (std::size_t i = nextInput++; i < unprocessedInputs_.size(); i = nextInput++)
+        {
+            Input& input = unprocessedInputs_[i];
+            const boost::filesystem::path indexPath = boost::filesystem::path(parameters_.unmapped_index_dir())
+                / (boost::filesystem::path(input.inputPaths_.front()).filename().string() + ".unmapped.idx");
+            input.unmappedIndex_ = common::UnmappedReadIndex::open(
+                input.inputPaths_, referencePath_, indexPath.string(), parameters_.unmapped_index_mapq());
+        }
+    });
+}
+
+/**
+ * Add reads from the unmapped read index which share k-mers with the non-reference nodes of the graph
+ */
+void Workflow::recruitUnmappedReads(
+    const Input& input, const Parameters& parameters, common::ReadBuffer& allReads) const
+{
+    if (!input.unmappedIndex_)
+    {
+        return;
+    }
+    // recruited reads count towards the read limit of the graph
+    const std::size_t maxReads = parameters.max_reads();
+    const std::size_t recruited = input.unmappedIndex_->recruitReads(
+        parameters.alt_sequences(), maxReads > allReads.size() ? maxReads - allReads.size() : 0, allReads);
+    if (recruited > 0)
+    {
+        LOG()->info("Recruited {} unmapped or low-MAPQ reads", recruited);
+    }
+}
+
+std::string
+Workflow::alignGraph(const Parameters& parameters, const InputPaths& inputPaths, common::ReadBuffer& allReads)
+{
     Json::Value outputJson = alignAndDisambiguate(parameters, allReads);
     if (inputPaths.size() == 1)
     {
@@ -111,6 +193,29 @@ std::string Workflow::processGraph(
     return common::writeJson(outputJson);
 }
 
+std::string Workflow::processGraph(
+    const std::string& graphSpecPath, const Parameters& parameters, const Input& input,
+    std::vector<common::BamReader>& readers)
+{
+    std::string output;
+    const std::string key = resultCache_.enabled() ? cacheKey(parameters, input.inputPaths_) : std::string();
+    if (!key.empty() && resultCache_.get(key, output))
+    {
+        LOG()->info("Using cached result for {}", graphSpecPath);
+        return output;
+    }
+
+    const auto reservation = reserveMemory(parameters, input, readers);
+    common::ReadBuffer allReads;
+    extractGraphReads(parameters, input, readers, allReads);
+    output = alignGraph(parameters, input.inputPaths_, allReads);
+    if (!key.empty())
+    {
+        resultCache_.put(key, output);
+    }
+    return output;
+}
+
 void Workflow::makeOutputFile(const std::string& output, const std::string& graphSpecPath)
 {
     const boost::filesystem::path inputPath(graphSpecPath);
@@ -135,27 +240,113 @@ void Workflow::makeOutputFile(const std::string& output, const std::string& grap
     dumpOutput(output, fos, outputPath.string());
 }
 
+/**
+ * Find graphs which only differ in their annotations, so we align and disambiguate them only once
+ */
+void Workflow::findDuplicateGraphs()
+{
+    std::vector<std::string> fingerprints(graphSpecPaths_.size());
+    std::atomic<std::size_t> nextGraph(0);
+    common::CPU_THREADS(parameters_.threads()).execute([this, &fingerprints, &nextGraph]() {
+        for (std::size_t graphIndex = nextGraph++; graphIndex < graphSpecPaths_.size(); graphIndex = nextGraph++)
+        {
+            Parameters parameters = parameters_;
+            parameters.load(graphSpecPaths_[graphIndex], referencePath_, targetRegions_);
+            fingerprints[graphIndex] = common::CacheKey().add("graph", parameters.graphFingerprint()).digest();
+        }
+    });
+
+    std::unordered_map<std::string, std::size_t> firstGraph;
+    representatives_.resize(graphSpecPaths_.size());
+    duplicates_.assign(graphSpecPaths_.size(), std::vector<std::size_t>());
+    std::size_t duplicates = 0;
+    for (std::size_t graphIndex = 0; graphIndex != graphSpecPaths_.size(); ++graphIndex)
+    {
+        const auto inserted = firstGraph.emplace(fingerprints[graphIndex], graphIndex);
+        representatives_[graphIndex] = inserted.first->second;
+        if (!inserted.second)
+        {
+            duplicates_[inserted.first->second].push_back(graphIndex);
+            ++duplicates;
+        }
+    }
+    LOG()->info("{} of {} graphs are duplicates of other graphs", duplicates, graphSpecPaths_.size());
+}
+
+void Workflow::keepRepresentativeResult(
+    const Input& input, std::size_t graphIndex, const Parameters& parameters, const std::string& output)
+{
+    if (!representatives_.empty() && !duplicates_[graphIndex].empty())
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        RepresentativeResult& result = representativeResults_[std::make_pair(&input, graphIndex)];
+        result.description = parameters.description();
+        result.output = output;
+        result.remainingDuplicates = duplicates_[graphIndex].size();
+        representativeResultAdded_.notify_all();
+    }
+}
+
+/**
+ * Copy the result of the representative of a duplicate graph. Representatives come first in the input order,
+ * so another thread is already processing it if its result isn't there yet. The result is dropped once it
+ * was copied to the last duplicate.
+ */
+std::string Workflow::duplicateOutput(const Input& input, std::size_t graphIndex, const Parameters& parameters)
+{
+    const auto key = std::make_pair(&input, representatives_[graphIndex]);
+    std::unique_lock<std::mutex> lock(mutex_);
+    representativeResultAdded_.wait(
+        lock, [this, &key]() { return terminate_ || representativeResults_.end() != representativeResults_.find(key); });
+    const auto representative = representativeResults_.find(key);
+    if (representativeResults_.end() == representative)
+    {
+        error(
+            "ERROR: No result for %s to copy to its duplicate %s", graphSpecPaths_[key.second].c_str(),
+            graphSpecPaths_[graphIndex].c_str());
+    }
+    RepresentativeResult representativeResult;
+    if (--representative->second.remainingDuplicates == 0)
+    {
+        representativeResult = std::move(representative->second);
+        representativeResults_.erase(representative);
+    }
+    else
+    {
+        representativeResult = representative->second;
+    }
+    lock.unlock();
+
+    Json::Value result;
+    std::istringstream representativeOutput(representativeResult.output);
+    representativeOutput >> result;
+    return common::writeJson(relabelResult(result, representativeResult.description, parameters.description()));
+}
+
 void Workflow::processGraphs(std::ostream& outputFileStream)
 {
     for (Input& input : unprocessedInputs_)
     {
+        // readers are opened once per thread and input and shared by all graphs this thread processes
+        std::vector<common::BamReader> readers;
         std::lock_guard<std::mutex> lock(mutex_);
         while (graphSpecPaths_.end() != input.unprocessedGraphs_)
         {
+            const std::size_t graphIndex = input.unprocessedGraphs_ - graphSpecPaths_.begin();
             const std::string& graphSpecPath = *(input.unprocessedGraphs_++);
             std::string output;
-            ASYNC_BLOCK_WITH_CLEANUP([this](bool failure) { terminate_ |= failure; })
+            ASYNC_BLOCK_WITH_CLEANUP([this](bool failure) {
+                terminate_ |= failure;
+                representativeResultAdded_.notify_all();
+            })
             {
-                std::vector<common::BamReader> readers;
-                //        for (const std::string& inputPath : input.inputPaths_)
-                for (size_t i = 0; i != input.inputPaths_.size(); ++i)
+                for (size_t i = readers.size(); i != input.inputPaths_.size(); ++i)
                 {
-                    //            LOG()->info("Opening {} with {}", inputPath, referencePath_);
-                    //            readers.push_back(common::BamReader(inputPath, referencePath_));
                     const auto& bamPath = input.inputPaths_[i];
                     const auto& bamIndexPath = input.inputIndexPaths_[i];
                     LOG()->info("Opening {}/{} with {}", bamPath, bamIndexPath, referencePath_);
                     readers.emplace_back(bamPath, bamIndexPath, referencePath_);
+                    readers.back().enableReadCache(parameters_.read_cache_size());
                 }
                 if (terminate_)
                 {
@@ -168,7 +359,15 @@ void Workflow::processGraphs(std::ostream& outputFileStream)
                 parameters.load(graphSpecPath, referencePath_, targetRegions_);
                 LOG()->info("Done loading parameters");
 
-                output = processGraph(graphSpecPath, parameters, input.inputPaths_, readers);
+                if (isDuplicate(graphIndex))
+                {
+                    output = duplicateOutput(input, graphIndex, parameters);
+                }
+                else
+                {
+                    output = processGraph(graphSpecPath, parameters, input, readers);
+                    keepRepresentativeResult(input, graphIndex, parameters, output);
+                }
 
                 if (!outputFolderPath_.empty())
                 {
@@ -176,16 +375,307 @@ void Workflow::processGraphs(std::ostream& outputFileStream)
                 }
             }
 
-            if (!outputFilePath_.empty())
+            writeOutput(output, outputFileStream);
+        }
+    }
+}
+
+/**
+ * Runs on the prefetch thread: load the next graph and extract its reads
+ * @return false when all graphs for all inputs have been extracted
+ */
+bool Workflow::prefetchGraph(ExtractedGraph& extractedGraph)
+{
+    while (unprocessedInputs_.end() != prefetchInput_ && graphSpecPaths_.end() == prefetchInput_->unprocessedGraphs_)
+    {
+        ++prefetchInput_;
+        prefetchReaders_.clear();
+    }
+    if (unprocessedInputs_.end() == prefetchInput_)
+    {
+        return false;
+    }
+    Input& input = *prefetchInput_;
+    for (size_t i = prefetchReaders_.size(); i != input.inputPaths_.size(); ++i)
+    {
+        const auto& bamPath = input.inputPaths_[i];
+        const auto& bamIndexPath = input.inputIndexPaths_[i];
+        LOG()->info("Opening {}/{} with {}", bamPath, bamIndexPath, referencePath_);
+        prefetchReaders_.emplace_back(bamPath, bamIndexPath, referencePath_);
+        prefetchReaders_.back().enableReadCache(parameters_.read_cache_size());
+    }
+
+    const std::size_t graphIndex = (input.unprocessedGraphs_++) - graphSpecPaths_.begin();
+    if (loadGraph(input, graphIndex, extractedGraph))
+    {
+        return true;
+    }
+
+    extractedGraph.reservation_ = reserveMemory(extractedGraph.parameters_, input, prefetchReaders_);
+    extractGraphReads(extractedGraph.parameters_, input, prefetchReaders_, extractedGraph.reads_);
+    return true;
+}
+
+/**
+ * Load the parameters of a graph for the prefetch thread and look up its cached result
+ * @return true if the graph needs no reads because its result is cached or copied from its representative
+ */
+bool Workflow::loadGraph(Input& input, std::size_t graphIndex, ExtractedGraph& extractedGraph)
+{
+    extractedGraph.input_ = &input;
+    extractedGraph.graphIndex_ = graphIndex;
+    extractedGraph.graphSpecPath_ = graphSpecPaths_[graphIndex];
+    extractedGraph.parameters_ = parameters_;
+    LOG()->info("Loading parameters {}", extractedGraph.graphSpecPath_);
+    extractedGraph.parameters_.load(extractedGraph.graphSpecPath_, referencePath_, targetRegions_);
+    LOG()->info("Done loading parameters");
+
+    if (isDuplicate(graphIndex))
+    {
+        extractedGraph.duplicate_ = true;
+        return true;
+    }
+    if (resultCache_.enabled())
+    {
+        extractedGraph.cacheKey_ = cacheKey(extractedGraph.parameters_, input.inputPaths_);
+        extractedGraph.cached_ = resultCache_.get(extractedGraph.cacheKey_, extractedGraph.output_);
+        if (extractedGraph.cached_)
+        {
+            LOG()->info("Using cached result for {}", extractedGraph.graphSpecPath_);
+        }
+    }
+    return extractedGraph.cached_;
+}
+
+/**
+ * Load the target regions of all graphs and find the graphs with cached results before sweeping
+ */
+void Workflow::planSweep()
+{
+    sweepTargets_.resize(graphSpecPaths_.size());
+    std::atomic<std::size_t> nextGraph(0);
+    common::CPU_THREADS(parameters_.threads()).execute([this, &nextGraph]() {
+        for (std::size_t graphIndex = nextGraph++; graphIndex < graphSpecPaths_.size(); graphIndex = nextGraph++)
+        {
+            if (isDuplicate(graphIndex))
             {
-                if (firstPrinted_)
+                continue;
+            }
+            Parameters parameters = parameters_;
+            parameters.load(graphSpecPaths_[graphIndex], referencePath_, targetRegions_);
+            SweepTarget& sweepTarget = sweepTargets_[graphIndex];
+            sweepTarget.targetRegions_ = parameters.target_regions();
+            sweepTarget.maxReads_ = (int)(parameters.max_reads());
+            sweepTarget.longestAltInsertion_ = parameters.longest_alt_insertion();
+            sweepTarget.recoverMates_ = parameters.recover_mates();
+            if (resultCache_.enabled())
+            {
+                std::string output;
+                for (const Input& input : unprocessedInputs_)
                 {
-                    outputFileStream << ',';
+                    sweepTarget.cached_.push_back(resultCache_.get(cacheKey(parameters, input.inputPaths_), output));
                 }
-                dumpOutput(output, outputFileStream, outputFilePath_);
-                firstPrinted_ = true;
             }
         }
+    });
+}
+
+/**
+ * Open one sweep for each BAM file of the input and add the graphs which need reads from it
+ */
+void Workflow::startSweep(const Input& input, std::size_t inputIndex)
+{
+    sweeps_.clear();
+    for (std::size_t i = 0; i != input.inputPaths_.size(); ++i)
+    {
+        LOG()->info("Opening {}/{} with {}", input.inputPaths_[i], input.inputIndexPaths_[i], referencePath_);
+        sweeps_.emplace_back(new common::ReadSweep(input.inputPaths_[i], input.inputIndexPaths_[i], referencePath_));
+    }
+    sweepsFinished_.assign(sweeps_.size(), false);
+    nextSweep_ = 0;
+    sweepGraphs_.clear();
+    sweptGraphs_.clear();
+    for (std::size_t graphIndex = 0; graphIndex != graphSpecPaths_.size(); ++graphIndex)
+    {
+        const SweepTarget& sweepTarget = sweepTargets_[graphIndex];
+        if (isDuplicate(graphIndex))
+        {
+            continue;
+        }
+        if (!sweepTarget.cached_.empty() && sweepTarget.cached_[inputIndex])
+        {
+            sweepReadyGraphs_.push_back(graphIndex);
+            continue;
+        }
+        for (auto& sweep : sweeps_)
+        {
+            sweep->addTarget(
+                sweepTarget.targetRegions_, sweepTarget.maxReads_, sweepTarget.longestAltInsertion_,
+                common::kAverageFragmentLength, sweepTarget.recoverMates_);
+        }
+        sweepGraphs_.push_back(graphIndex);
+    }
+}
+
+/**
+ * Runs on the prefetch thread instead of prefetchGraph when sweeping: advance the sweeps of the
+ * BAM files in turn until one graph has its reads from all of them
+ * @return false when all graphs for all inputs have been extracted
+ */
+bool Workflow::sweepGraph(ExtractedGraph& extractedGraph)
+{
+    while (unprocessedInputs_.end() != prefetchInput_)
+    {
+        Input& input = *prefetchInput_;
+        if (sweeps_.empty())
+        {
+            startSweep(input, prefetchInput_ - unprocessedInputs_.begin());
+        }
+        if (!sweepReadyGraphs_.empty())
+        {
+            const std::size_t graphIndex = sweepReadyGraphs_.front();
+            sweepReadyGraphs_.pop_front();
+            if (!loadGraph(input, graphIndex, extractedGraph))
+            {
+                error("ERROR: Cached result for %s was removed during the run", graphSpecPaths_[graphIndex].c_str());
+            }
+            queueSweepDuplicates(graphIndex);
+            return true;
+        }
+
+        std::size_t target = 0;
+        common::ReadBuffer reads;
+        while (std::find(sweepsFinished_.begin(), sweepsFinished_.end(), false) != sweepsFinished_.end())
+        {
+            const std::size_t sweep = nextSweep_;
+            nextSweep_ = (nextSweep_ + 1) % sweeps_.size();
+            if (sweepsFinished_[sweep])
+            {
+                continue;
+            }
+            if (!sweeps_[sweep]->next(target, reads))
+            {
+                sweepsFinished_[sweep] = true;
+                continue;
+            }
+            SweptGraph& sweptGraph = sweptGraphs_[target];
+            sweptGraph.reads_.resize(sweeps_.size());
+            sweptGraph.reads_[sweep] = std::move(reads);
+            if (++sweptGraph.sweepsDone_ != sweeps_.size())
+            {
+                continue;
+            }
+            if (!loadGraph(input, sweepGraphs_[target], extractedGraph))
+            {
+                // same order as extractGraphReads
+                for (auto& sweepReads : sweptGraph.reads_)
+                {
+                    std::move(sweepReads.begin(), sweepReads.end(), std::back_inserter(extractedGraph.reads_));
+                }
+                recruitUnmappedReads(input, extractedGraph.parameters_, extractedGraph.reads_);
+                // the reads are already extracted, this holds back the sweep until aligned graphs free memory
+                if (!memoryBudget_.unlimited() && !extractedGraph.reads_.empty())
+                {
+                    std::size_t totalLength = 0;
+                    for (const auto& read : extractedGraph.reads_)
+                    {
+                        totalLength += read->bases().size();
+                    }
+                    extractedGraph.reservation_.reset(new common::MemoryReservation(
+                        memoryBudget_,
+                        common::estimateReadBufferSize(
+                            extractedGraph.reads_.size(), totalLength / extractedGraph.reads_.size())));
+                }
+            }
+            sweptGraphs_.erase(target);
+            queueSweepDuplicates(sweepGraphs_[target]);
+            return true;
+        }
+        sweeps_.clear();
+        ++prefetchInput_;
+    }
+    return false;
+}
+
+/**
+ * The sweep produces graphs out of input order, so duplicates follow right after their representative
+ */
+void Workflow::queueSweepDuplicates(std::size_t graphIndex)
+{
+    if (!representatives_.empty())
+    {
+        const std::vector<std::size_t>& duplicates = duplicates_[graphIndex];
+        sweepReadyGraphs_.insert(sweepReadyGraphs_.begin(), duplicates.begin(), duplicates.end());
+    }
+}
+
+void Workflow::alignPrefetchedGraphs(common::Prefetcher<ExtractedGraph>& prefetcher, std::ostream& outputFileStream)
+{
+    // stop extraction for the remaining graphs if alignment fails
+    const auto cleanup = [this, &prefetcher](bool failure) {
+        terminate_ |= failure;
+        if (failure)
+        {
+            prefetcher.cancel();
+        }
+        representativeResultAdded_.notify_all();
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!terminate_)
+    {
+        std::string output;
+        ASYNC_BLOCK_WITH_CLEANUP(cleanup)
+        {
+            common::unlock_guard<std::mutex> unlock(mutex_);
+            ExtractedGraph extractedGraph;
+            if (!prefetcher.next(extractedGraph))
+            {
+                break;
+            }
+            if (extractedGraph.duplicate_)
+            {
+                output = duplicateOutput(
+                    *extractedGraph.input_, extractedGraph.graphIndex_, extractedGraph.parameters_);
+            }
+            else if (extractedGraph.cached_)
+            {
+                output = extractedGraph.output_;
+            }
+            else
+            {
+                output = alignGraph(
+                    extractedGraph.parameters_, extractedGraph.input_->inputPaths_, extractedGraph.reads_);
+                if (!extractedGraph.cacheKey_.empty())
+                {
+                    resultCache_.put(extractedGraph.cacheKey_, output);
+                }
+            }
+            if (!extractedGraph.duplicate_)
+            {
+                keepRepresentativeResult(
+                    *extractedGraph.input_, extractedGraph.graphIndex_, extractedGraph.parameters_, output);
+            }
+
+            if (!outputFolderPath_.empty())
+            {
+                makeOutputFile(output, extractedGraph.graphSpecPath_);
+            }
+        }
+
+        writeOutput(output, outputFileStream);
+    }
+}
+
+void Workflow::writeOutput(const std::string& output, std::ostream& outputFileStream)
+{
+    if (!outputFilePath_.empty())
+    {
+        if (firstPrinted_)
+        {
+            outputFileStream << ',';
+        }
+        dumpOutput(output, outputFileStream, outputFilePath_);
+        firstPrinted_ = true;
     }
 }
 
@@ -222,7 +712,52 @@ void Workflow::run()
         fos << "[";
     }
 
-    common::CPU_THREADS(parameters_.threads()).execute([this, &fos]() { processGraphs(fos); });
+    if (parameters_.deduplicate_graphs())
+    {
+        findDuplicateGraphs();
+    }
+
+    if (!parameters_.unmapped_index_dir().empty())
+    {
+        openUnmappedIndexes();
+    }
+
+    if (!memoryBudget_.unlimited())
+    {
+        for (Input& input : unprocessedInputs_)
+        {
+            common::BamReader reader(input.inputPaths_.front(), input.inputIndexPaths_.front(), referencePath_);
+            input.readLength_ = common::estimateReadLength(reader);
+            LOG()->info("Estimated read length of {}: {}", input.inputPaths_.front(), input.readLength_);
+        }
+    }
+
+    if (parameters_.sweep_bam())
+    {
+        planSweep();
+        prefetchInput_ = unprocessedInputs_.begin();
+        common::Prefetcher<ExtractedGraph> prefetcher(
+            std::max(parameters_.prefetch_graphs(), parameters_.threads()),
+            [this](ExtractedGraph& extractedGraph) -> bool { return sweepGraph(extractedGraph); });
+        common::CPU_THREADS(parameters_.threads()).execute([this, &prefetcher, &fos]() {
+            alignPrefetchedGraphs(prefetcher, fos);
+        });
+    }
+    else if (parameters_.prefetch_graphs() > 0)
+    {
+        prefetchInput_ = unprocessedInputs_.begin();
+        common::Prefetcher<ExtractedGraph> prefetcher(
+            parameters_.prefetch_graphs(), [this](ExtractedGraph& extractedGraph) -> bool {
+                return prefetchGraph(extractedGraph);
+            });
+        common::CPU_THREADS(parameters_.threads()).execute([this, &prefetcher, &fos]() {
+            alignPrefetchedGraphs(prefetcher, fos);
+        });
+    }
+    else
+    {
+        common::CPU_THREADS(parameters_.threads()).execute([this, &fos]() { processGraphs(fos); });
+    }
 
     if (!outputFilePath_.empty() && 1 < graphSpecPaths_.size())
     {
@@ -35,11 +35,13 @@
 
 #include "spdlog/spdlog.h"
 
+#include "grmpy/CountMatrix.hh"
 #include "grmpy/Parameters.hh"
 #include "grmpy/Workflow.hh"
 
 #include "common/Error.hh"
 #include "common/Program.hh"
+#include "common/StringUtil.hh"
 
 // define to dump argc/argv
 // #define GRMPY_TRACE
@@ -65,6 +67,7 @@ public:
     string genotyping_parameter_path;
     int sample_threads = std::thread::hardware_concurrency();
     int max_reads_per_event = 10000;
+    double max_reads_depth_factor = 0.0;
     float bad_align_frac = 0.8f;
     bool path_sequence_matching = false;
     bool graph_sequence_matching = true;
@@ -72,7 +75,22 @@ public:
     bool kmer_sequence_matching = false;
     int bad_align_uniq_kmer_len = 0;
     string alignment_output_path;
+    bool alignment_container = false;
     bool infer_read_haplotypes = false;
+    size_t max_memory = 0;
+    unsigned prefetch_graphs = 0;
+    string cache_dir;
+    bool sample_major = false;
+    size_t read_cache_size = 0;
+    uint64_t min_split_cost = 10000000;
+    bool deduplicate_graphs = false;
+    bool reference_prescreen = false;
+    int read_triage = 0;
+    string unmapped_index_dir;
+    int unmapped_index_mapq = 1;
+    int breakpoint_window = 0;
+    string count_matrix_output;
+    string count_matrix_input;
 
     bool gzip_output = false;
     bool progress = true;
@@ -101,11 +119,21 @@ Options::Options()
             ("alignment-output-folder,A", po::value<string>(&alignment_output_path)->default_value(alignment_output_path),
              "Output folder for alignments. Note these can become very large and are only required"
              "for curation / visualisation or faster reanalysis.")
+            ("alignment-container",
+             po::value<bool>(&alignment_container)->default_value(alignment_container)->implicit_value(true),
+             "Write the alignments of each sample into one indexed BGZF container <sample>.paragraph.bgzf in the "
+             "alignment output folder instead of one file per sample and graph. Containers can be passed back "
+             "in the alignment_container manifest column to genotype without realigning.")
             ("infer-read-haplotypes",
              po::value<bool>(&infer_read_haplotypes)->default_value(infer_read_haplotypes)->implicit_value(true),
              "Infer haplotype paths using read and fragment information.")
             ("max-reads-per-event,M", po::value<int>(&max_reads_per_event)->default_value(max_reads_per_event),
              "Maximum number of reads to process for a single event.")
+            ("max-reads-depth-factor",
+             po::value<double>(&max_reads_depth_factor)->default_value(max_reads_depth_factor),
+             "Derive the read limit of each target region from the sample depth and read length in the manifest "
+             "instead of using -M: regions with more than this many times the expected number of reads are "
+             "subsampled uniformly by read pair. Samples without depth use -M. 0: always use -M.")
             ("bad-align-frac", po::value<float>(&bad_align_frac)->default_value(bad_align_frac),
              "Fraction of read that needs to be mapped in order for it to be used.")
             ("path-sequence-matching",
@@ -124,6 +152,59 @@ Options::Options()
              "Kmer length for uniqueness check during read filtering.")
             ("sample-threads,t", po::value<int>(&sample_threads)->default_value(sample_threads),
              "Number of threads for parallel sample processing.")
+            ("max-memory", po::value<string>(),
+             "Memory budget for reads of graphs aligned in parallel, e.g. 16G. A graph is only started "
+             "when its footprint estimated from the BAM index fits into the budget. Unlimited if not given.")
+            ("prefetch-graphs", po::value<unsigned>(&prefetch_graphs)->default_value(prefetch_graphs),
+             "Extract reads for up to this many sample / graph pairs on a separate I/O thread ahead of "
+             "alignment. 0 extracts and aligns on the same thread.")
+            ("sample-major", po::value<bool>(&sample_major)->default_value(sample_major)->implicit_value(true),
+             "Give each thread one sample at a time and align it to all graphs in order of their target regions, "
+             "so each BAM file is opened once and read mostly sequentially. Best with at least as many samples "
+             "as threads.")
+            ("min-split-cost", po::value<uint64_t>(&min_split_cost)->default_value(min_split_cost),
+             "Reads of each sample / graph pair are split into one part per thread. Pairs whose alignment cost "
+             "(number of reads x graph sequence length) exceeds this are split into more parts, which threads that "
+             "become idle align in parallel. 0 splits all of them further.")
+            ("read-cache", po::value<size_t>(&read_cache_size)->default_value(read_cache_size),
+             "Number of decoded reads each BAM reader keeps from the last target region. Graphs with overlapping "
+             "target regions that are aligned one after the other reuse these reads and recovered mates. Most "
+             "effective with --sample-major or --prefetch-graphs. 0 disables the cache.")
+            ("deduplicate-graphs",
+             po::value<bool>(&deduplicate_graphs)->default_value(deduplicate_graphs)->implicit_value(true),
+             "Align each sample once to graphs which only differ in their ID or other annotations and copy the "
+             "alignments to all of them. Genotyping still runs for every graph.")
+            ("reference-prescreen",
+             po::value<bool>(&reference_prescreen)->default_value(reference_prescreen)->implicit_value(true),
+             "Check the reads of each sample / graph pair for k-mers which only occur on non-reference paths. "
+             "When there are none, reads are placed on the reference path using their BAM alignment and only "
+             "the remaining reads are aligned to the graph.")
+            ("read-triage", po::value<int>(&read_triage)->default_value(read_triage),
+             "Place reads without k-mers that span an edge or lie on a non-reference node on the reference path "
+             "using their BAM alignment instead of aligning them to the graph. 0: off, 1: only reads which match "
+             "the reference exactly, 2: also reads with up to 5% mismatches.")
+            ("unmapped-index-dir", po::value<string>(&unmapped_index_dir),
+             "Directory for k-mer indexes of the unmapped and low-MAPQ reads of each sample. Missing or outdated "
+             "indexes are built with one pass over the BAM/CRAM files before alignment starts. Reads which share "
+             "k-mers with the non-reference nodes of a graph are added to the reads extracted for it, which "
+             "finds reads from long insertions.")
+            ("unmapped-index-mapq", po::value<int>(&unmapped_index_mapq)->default_value(unmapped_index_mapq),
+             "Mapped reads with a MAPQ below this are added to the unmapped read index. 0 only indexes reads "
+             "flagged as unmapped, including those placed at the position of their mate.")
+            ("breakpoint-window", po::value<int>(&breakpoint_window)->default_value(breakpoint_window),
+             "Only extract reads within this distance of the breakpoints of each graph instead of from its whole "
+             "target regions, which skips reads from the inside of large deletions and inversions. Mates of reads "
+             "near a breakpoint are recovered. About one fragment length works well. 0: use the target regions.")
+            ("count-matrix-output", po::value<string>(&count_matrix_output),
+             "Also write the edge read counts of all samples for each graph into this tab-separated file (gzipped if "
+             "the name ends in .gz), together with the sample depths, read lengths and sexes. Graphs can be "
+             "genotyped again from this file with --count-matrix-input.")
+            ("count-matrix-input", po::value<string>(&count_matrix_input),
+             "Genotype from a file written with --count-matrix-output instead of aligning reads. No manifest "
+             "is needed; the graphs are read from the paths recorded in the file.")
+            ("cache-dir", po::value<string>(&cache_dir),
+             "Directory for cached alignment results. Sample / graph pairs whose alignment parameters, BAM "
+             "and reference are unchanged since an earlier run with the same directory are not realigned.")
             ("gzip-output,z", po::value<bool>(&gzip_output)->default_value(gzip_output)->implicit_value(true),
              "gzip-compress output files. If -O is used, output file names are appended with .gz")
             ("progress", po::value<bool>(&progress)->default_value(progress)->implicit_value(true))
@@ -158,6 +239,16 @@ void Options::postProcess(boost::program_options::variables_map& vm)
         error("Error: Reference genome path is missing.");
     }
 
+    if (!count_matrix_input.empty())
+    {
+        logger->info("Count matrix input: {}", count_matrix_input);
+        assertFileExists(count_matrix_input);
+        if (vm.count("graph-spec") != 0u || vm.count("manifest") != 0u)
+        {
+            error("Error: --count-matrix-input cannot be combined with graphs or a manifest.");
+        }
+    }
+
     if (vm.count("graph-spec") != 0u)
     {
         graph_spec_paths = vm["graph-spec"].as<std::vector<string>>();
@@ -203,6 +294,45 @@ void Options::postProcess(boost::program_options::variables_map& vm)
             boost::filesystem::create_directory(alignment_output_path);
         }
     }
+    else if (alignment_container)
+    {
+        error("Error: --alignment-container requires an alignment output folder.");
+    }
+
+    if (sample_major && prefetch_graphs > 0)
+    {
+        // the prefetch thread already reads one sample at a time
+        logger->warn("--sample-major has no effect with --prefetch-graphs");
+    }
+
+    if (vm.count("max-memory"))
+    {
+        const string max_memory_string = vm["max-memory"].as<string>();
+        try
+        {
+            max_memory = common::stringutil::parseMemorySize(max_memory_string);
+        }
+        catch (const std::exception&)
+        {
+            error("Error: Invalid memory size: %s", max_memory_string.c_str());
+        }
+        logger->info("Memory budget: {} bytes", max_memory);
+    }
+
+    if (read_triage < 0 || read_triage > 2)
+    {
+        error("Error: Invalid read triage level: %i", read_triage);
+    }
+
+    if (breakpoint_window < 0)
+    {
+        error("Error: Invalid breakpoint window: %i", breakpoint_window);
+    }
+
+    if (max_reads_depth_factor < 0)
+    {
+        error("Error: Invalid max reads depth factor: %f", max_reads_depth_factor);
+    }
 
     if (vm.count("manifest"))
     {
@@ -238,7 +368,7 @@ void Options::postProcess(boost::program_options::variables_map& vm)
             }
         }
     }
-    else
+    else if (count_matrix_input.empty())
     {
         error("Error: Manifest file is missing.");
     }
@@ -246,10 +376,34 @@ void Options::postProcess(boost::program_options::variables_map& vm)
 
 static void runGrmpy(const Options& options)
 {
+    if (!options.count_matrix_input.empty())
+    {
+        genotypeCountMatrices(
+            options.count_matrix_input, options.reference_path, options.genotyping_parameter_path,
+            options.output_file_path, options.output_folder_path, options.gzip_output,
+            static_cast<unsigned int>(options.sample_threads));
+        return;
+    }
+
     Parameters parameters(
         options.sample_threads, options.max_reads_per_event, options.bad_align_frac, options.path_sequence_matching,
         options.graph_sequence_matching, options.klib_sequence_matching, options.kmer_sequence_matching,
         options.bad_align_uniq_kmer_len, options.alignment_output_path, options.infer_read_haplotypes);
+    parameters.set_max_memory(options.max_memory);
+    parameters.set_prefetch_graphs(options.prefetch_graphs);
+    parameters.set_cache_dir(options.cache_dir);
+    parameters.set_sample_major(options.sample_major);
+    parameters.set_read_cache_size(options.read_cache_size);
+    parameters.set_min_split_cost(options.min_split_cost);
+    parameters.set_deduplicate_graphs(options.deduplicate_graphs);
+    parameters.set_reference_prescreen(options.reference_prescreen);
+    parameters.set_read_triage(options.read_triage);
+    parameters.set_unmapped_index_dir(options.unmapped_index_dir);
+    parameters.set_unmapped_index_mapq(options.unmapped_index_mapq);
+    parameters.set_breakpoint_window(options.breakpoint_window);
+    parameters.set_max_reads_depth_factor(options.max_reads_depth_factor);
+    parameters.set_alignment_container(options.alignment_container);
+    parameters.set_count_matrix_output(options.count_matrix_output);
     std::cerr << "starting workflow" << std::endl;
     grmpy::Workflow workflow(
         options.graph_spec_paths, options.genotyping_parameter_path, options.manifest, options.output_file_path,
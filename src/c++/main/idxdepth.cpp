@@ -70,6 +70,8 @@ int main(int argc, char const* argv[])
              "Regex to identify sex chromosome names (default: '(chr)?[XY]?'")
             ("threads", po::value<int>()->default_value(std::thread::hardware_concurrency()),
              "Number of threads to use for parallel estimation.")
+            ("per-read-group", po::value<bool>()->default_value(false),
+             "Also estimate depth and read length for each read group, e.g. for BAMs holding several samples.")
             ("log-level", po::value<string>()->default_value("info"), "Set log level (error, warning, info).")
             ("log-file", po::value<string>()->default_value(""), "Log to a file instead of stderr.")
             ("log-async", po::value<bool>()->default_value(true), "Enable / disable async logging.");
@@ -137,6 +139,7 @@ int main(int argc, char const* argv[])
         parameters.set_autosome_regex(vm["autosome-regex"].as<string>());
         parameters.set_sex_chromosome_regex(vm["sex-chromosome-regex"].as<string>());
         parameters.set_threads(vm["threads"].as<int>());
+        parameters.set_per_read_group(vm["per-read-group"].as<bool>());
 
         Json::Value output = idxdepth::estimateDepths(parameters);
 
@@ -26,9 +26,11 @@
  *
  */
 
+#include <fstream>
 #include <iostream>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
 #include "common/Error.hh"
@@ -36,6 +38,8 @@
 #include "common/StringUtil.hh"
 
 #include "paragraph/Parameters.hh"
+#include "paragraph/JsonlWorkflow.hh"
+#include "paragraph/Server.hh"
 #include "paragraph/Workflow.hh"
 
 using std::string;
@@ -73,10 +77,25 @@ public:
     bool validate_alignments = false;
     int bad_align_uniq_kmer_len = 0;
     bool bad_align_nonuniq = true;
+    size_t max_memory = 0;
+    unsigned prefetch_graphs = 0;
+    string cache_dir;
+    size_t read_cache_size = 0;
+    uint64_t min_split_cost = 10000000;
+    bool deduplicate_graphs = false;
+    bool sweep_bam = false;
+    bool reference_prescreen = false;
+    int read_triage = 0;
+    string unmapped_index_dir;
+    int unmapped_index_mapq = 1;
+    int breakpoint_window = 0;
+    string server_socket_path;
+    string graph_jsonl_path;
 
     std::string usagePrefix() const override
     {
-        return "paragraph -r <reference> -g <graph(s)> -b <input cram(s)/bam(s)> [optional arguments]";
+        return "paragraph -r <reference> -g <graph(s)> | -G <graph list> | --graph-jsonl <file> | --server <socket> "
+               "-b <input cram(s)/bam(s)> [optional arguments]";
     }
 };
 
@@ -86,7 +105,11 @@ Options::Options()
     namedOptions_.add_options()
         ("bam,b", po::value<std::vector<string>>()->multitoken(),
          "Input BAM file(s) for read extraction. We align all reads to all graphs.")
-        ("graph-spec,g", po::value<std::vector<string>>(&graph_spec_paths)->multitoken(), "JSON file(s) describing the graph(s)")
+        ("graph-spec,g", po::value<std::vector<string>>(&graph_spec_paths)->multitoken(),
+         "JSON file(s) describing the graph(s). Directories are expanded to all .json files they contain.")
+        ("graph-spec-list,G", po::value<std::vector<string>>()->multitoken(),
+         "Text file(s) listing one graph JSON file per line. All graphs are processed in a single "
+         "run sharing BAM readers, the reference and parameters.")
         ("output-file,o", po::value<string>(&output_file_path),
          "Output file name. Will output to stdout if '-' or neither of output-file or output-folder provided.")
         ("output-folder,O", po::value<string>(&output_folder_path),
@@ -136,6 +159,64 @@ Options::Options()
          "Kmer length for uniqueness check during read filtering.")
         ("reference,r", po::value<string>(&reference_path), "Reference genome fasta file.")
         ("threads", po::value<int>(&threads)->default_value(threads), "Number of threads to use for parallel alignment.")
+        ("max-memory", po::value<string>(),
+         "Memory budget for reads of graphs processed in parallel, e.g. 16G. A graph is only started "
+         "when its footprint estimated from the BAM index fits into the budget. With --sweep-bam, graphs "
+         "whose reads the pass has collected wait for the budget before they are aligned. Unlimited if not "
+         "given.")
+        ("prefetch-graphs", po::value<unsigned>(&prefetch_graphs)->default_value(prefetch_graphs),
+         "Extract reads for up to this many graphs on a separate I/O thread ahead of alignment. "
+         "0 extracts and aligns on the same thread.")
+        ("cache-dir", po::value<string>(&cache_dir),
+         "Directory for cached per-graph results. Graphs whose parameters, inputs and reference are "
+         "unchanged since an earlier run with the same directory are not realigned.")
+        ("min-split-cost", po::value<uint64_t>(&min_split_cost)->default_value(min_split_cost),
+         "Reads of each graph are split into one part per thread. Graphs whose alignment cost (number of reads x "
+         "graph sequence length) exceeds this are split into more parts, which threads that become idle align "
+         "in parallel, so long events don't hold up the run. 0 splits all graphs further.")
+        ("read-cache", po::value<size_t>(&read_cache_size)->default_value(read_cache_size),
+         "Number of decoded reads each BAM reader keeps from the last target region. Graphs with overlapping "
+         "target regions that are processed one after the other reuse these reads and recovered mates instead "
+         "of reading them again. 0 disables the cache.")
+        ("deduplicate-graphs",
+         po::value<bool>(&deduplicate_graphs)->default_value(deduplicate_graphs)->implicit_value(true),
+         "Align graphs which only differ in their ID or other annotations once and copy the result to all of "
+         "them. Requires loading all graphs before processing starts.")
+        ("sweep-bam", po::value<bool>(&sweep_bam)->default_value(sweep_bam)->implicit_value(true),
+         "Extract the reads for all graphs with one sequential pass over each coordinate-sorted BAM/CRAM "
+         "instead of an index lookup per target region, which is faster for large numbers of graphs. Graphs "
+         "are aligned as soon as the pass has moved beyond their target regions. Works without an index; "
+         "mates outside the target regions are then found in a second pass.")
+        ("reference-prescreen",
+         po::value<bool>(&reference_prescreen)->default_value(reference_prescreen)->implicit_value(true),
+         "Check the reads of each graph for k-mers which only occur on non-reference paths. When there are "
+         "none, reads are placed on the reference path using their BAM alignment and only the remaining reads "
+         "are aligned to the graph.")
+        ("read-triage", po::value<int>(&read_triage)->default_value(read_triage),
+         "Place reads without k-mers that span an edge or lie on a non-reference node on the reference path "
+         "using their BAM alignment instead of aligning them to the graph. 0: off, 1: only reads which match "
+         "the reference exactly, 2: also reads with up to 5% mismatches.")
+        ("unmapped-index-dir", po::value<string>(&unmapped_index_dir),
+         "Directory for k-mer indexes of the unmapped and low-MAPQ reads of each input. Missing or outdated "
+         "indexes are built with one pass over the BAM/CRAM files before alignment starts. Reads which share "
+         "k-mers with the non-reference nodes of a graph are added to the reads extracted for it, which "
+         "finds reads from long insertions.")
+        ("unmapped-index-mapq", po::value<int>(&unmapped_index_mapq)->default_value(unmapped_index_mapq),
+         "Mapped reads with a MAPQ below this are added to the unmapped read index. 0 only indexes reads "
+         "flagged as unmapped, including those placed at the position of their mate.")
+        ("breakpoint-window", po::value<int>(&breakpoint_window)->default_value(breakpoint_window),
+         "Only extract reads within this distance of the breakpoints of each graph instead of from its whole "
+         "target regions, which skips reads from the inside of large deletions and inversions. Mates of reads "
+         "near a breakpoint are recovered. About one fragment length works well. 0: use the target regions.")
+        ("graph-jsonl", po::value<string>(&graph_jsonl_path),
+         "JSONL file with one graph description or graph file path per line, '-' for stdin, .gz files are "
+         "decompressed. Graphs are read as threads become free and the output is written as one JSON line per "
+         "graph in input order, so memory use doesn't grow with the number of graphs.")
+        ("server", po::value<string>(&server_socket_path),
+         "Run as a server on this Unix domain socket instead of processing -g/-G graphs. The reference and "
+         "BAM readers are kept open, each request line is a graph JSON or the path to one, each response "
+         "line is the JSON output for that graph. Send 'shutdown' to stop the server. The socket is created "
+         "with owner-only permissions, an existing file at this path is only replaced if it is a socket.")
         ("gzip-output,z", po::value<bool>(&gzip_output)->default_value(gzip_output)->implicit_value(true),
          "gzip-compress output files. If -O is used, output file names are appended with .gz");
 }
@@ -153,6 +234,61 @@ Options::Action Options::parse(const char* moduleName, int argc, const char* arg
     return ret;
 }
 
+/**
+ * \brief read graph file names from a list file, one per line. Relative paths are
+ *        resolved against the location of the list file.
+ */
+static void readGraphSpecList(const string& list_path, std::vector<string>& graph_spec_paths)
+{
+    std::ifstream list_file(list_path);
+    if (!list_file.is_open())
+    {
+        error("ERROR: Cannot open graph list %s", list_path.c_str());
+    }
+    string line;
+    while (std::getline(list_file, line))
+    {
+        boost::algorithm::trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        boost::filesystem::path p(line);
+        if (p.is_relative() && !boost::filesystem::exists(p))
+        {
+            p = boost::filesystem::path(list_path).parent_path() / p;
+        }
+        graph_spec_paths.push_back(p.string());
+    }
+}
+
+/**
+ * \brief replace directories by the .json files they contain, in lexicographical order
+ */
+static std::vector<string> expandGraphSpecDirectories(const std::vector<string>& graph_spec_paths)
+{
+    std::vector<string> result;
+    for (const auto& graph_spec_path : graph_spec_paths)
+    {
+        if (!boost::filesystem::is_directory(graph_spec_path))
+        {
+            result.push_back(graph_spec_path);
+            continue;
+        }
+        std::vector<string> directory_graphs;
+        for (boost::filesystem::directory_iterator it(graph_spec_path), end; it != end; ++it)
+        {
+            if (boost::filesystem::is_regular_file(it->path()) && it->path().extension() == ".json")
+            {
+                directory_graphs.push_back(it->path().string());
+            }
+        }
+        std::sort(directory_graphs.begin(), directory_graphs.end());
+        result.insert(result.end(), directory_graphs.begin(), directory_graphs.end());
+    }
+    return result;
+}
+
 void Options::postProcess(boost::program_options::variables_map& vm)
 {
     if (vm.count("bam") != 0u)
@@ -184,9 +320,44 @@ void Options::postProcess(boost::program_options::variables_map& vm)
         error("ERROR: BAM file is missing.");
     }
 
+    if (vm.count("graph-spec-list") != 0u)
+    {
+        for (const auto& list_path : vm["graph-spec-list"].as<std::vector<string>>())
+        {
+            readGraphSpecList(list_path, graph_spec_paths);
+        }
+    }
+    graph_spec_paths = expandGraphSpecDirectories(graph_spec_paths);
+    if (!server_socket_path.empty() && !graph_spec_paths.empty())
+    {
+        error("ERROR: Graphs are sent as requests in server mode and cannot be given on the command line.");
+    }
+    if (!graph_jsonl_path.empty())
+    {
+        if (!graph_spec_paths.empty() || !server_socket_path.empty())
+        {
+            error("ERROR: --graph-jsonl cannot be combined with -g/-G or --server.");
+        }
+        if (!output_folder_path.empty())
+        {
+            error("ERROR: --graph-jsonl writes all results to the output file, an output folder is not supported.");
+        }
+        if ("-" != graph_jsonl_path)
+        {
+            assertFileExists(graph_jsonl_path);
+        }
+    }
+
     if (!graph_spec_paths.empty())
     {
-        LOG()->info("Graph spec: {}", boost::join(graph_spec_paths, ","));
+        if (graph_spec_paths.size() > 10)
+        {
+            LOG()->info("Graph spec: {} graphs", graph_spec_paths.size());
+        }
+        else
+        {
+            LOG()->info("Graph spec: {}", boost::join(graph_spec_paths, ","));
+        }
         assertFilesExist(graph_spec_paths.begin(), graph_spec_paths.end());
         if (!output_folder_path.empty())
         {
@@ -195,7 +366,7 @@ void Options::postProcess(boost::program_options::variables_map& vm)
             assertFileNamesUnique(graph_spec_paths.begin(), graph_spec_paths.end());
         }
     }
-    else
+    else if (server_socket_path.empty() && graph_jsonl_path.empty())
     {
         error("ERROR: File with variant specification is missing.");
     }
@@ -226,6 +397,30 @@ void Options::postProcess(boost::program_options::variables_map& vm)
         LOG()->info("Overriding target regions: {}", target_regions);
     }
 
+    if (vm.count("max-memory") != 0u)
+    {
+        const string max_memory_string = vm["max-memory"].as<string>();
+        try
+        {
+            max_memory = common::stringutil::parseMemorySize(max_memory_string);
+        }
+        catch (const std::exception&)
+        {
+            error("ERROR: Invalid memory size: %s", max_memory_string.c_str());
+        }
+        LOG()->info("Memory budget: {} bytes", max_memory);
+    }
+
+    if (read_triage < 0 || read_triage > 2)
+    {
+        error("ERROR: Invalid read triage level: %i", read_triage);
+    }
+
+    if (breakpoint_window < 0)
+    {
+        error("ERROR: Invalid breakpoint window: %i", breakpoint_window);
+    }
+
     if (vm["output-alignments"].as<bool>())
     {
         output_options |= Parameters::output_options::ALIGNMENTS;
@@ -270,6 +465,36 @@ static void runParagraph(const Options& options)
     parameters.set_threads(options.threads);
     parameters.set_kmer_len(options.bad_align_uniq_kmer_len);
     parameters.set_remove_nonuniq_reads(options.bad_align_nonuniq);
+    parameters.set_max_memory(options.max_memory);
+    parameters.set_prefetch_graphs(options.prefetch_graphs);
+    parameters.set_cache_dir(options.cache_dir);
+    parameters.set_read_cache_size(options.read_cache_size);
+    parameters.set_min_split_cost(options.min_split_cost);
+    parameters.set_deduplicate_graphs(options.deduplicate_graphs);
+    parameters.set_sweep_bam(options.sweep_bam);
+    parameters.set_reference_prescreen(options.reference_prescreen);
+    parameters.set_read_triage(options.read_triage);
+    parameters.set_unmapped_index_dir(options.unmapped_index_dir);
+    parameters.set_unmapped_index_mapq(options.unmapped_index_mapq);
+    parameters.set_breakpoint_window(options.breakpoint_window);
+
+    if (!options.server_socket_path.empty())
+    {
+        Server server(
+            options.server_socket_path, options.bam_paths, options.bam_index_paths, parameters,
+            options.reference_path, options.target_regions);
+        server.run();
+        return;
+    }
+
+    if (!options.graph_jsonl_path.empty())
+    {
+        JsonlWorkflow workflow(
+            options.bam_paths, options.bam_index_paths, options.graph_jsonl_path, options.output_file_path,
+            options.gzip_output, parameters, options.reference_path, options.target_regions);
+        workflow.run();
+        return;
+    }
 
     Workflow workflow(
             1 != options.bam_paths.size(), options.bam_paths, options.bam_index_paths, options.graph_spec_paths,
@@ -0,0 +1,66 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_alignmentcontainer.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include "common/AlignmentContainer.hh"
+
+using namespace common;
+
+TEST(AlignmentContainer, RandomAccess)
+{
+    const std::string path
+        = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.paragraph.bgzf"))
+              .string();
+
+    std::vector<std::string> records;
+    {
+        AlignmentContainerWriter writer(path);
+        for (int i = 0; i < 100; ++i)
+        {
+            records.push_back("{\"ID\": \"graph" + std::to_string(i) + "\", \"data\": \"" + std::string(i * 37, 'A')
+                              + "\"}");
+            writer.add("graph" + std::to_string(i), records.back());
+        }
+        writer.add("graph7", "{\"ID\": \"graph7\", \"replaced\": true}");
+    }
+
+    AlignmentContainerReader reader(path);
+    ASSERT_EQ(100ull, reader.size());
+    ASSERT_FALSE(reader.contains("graph100"));
+
+    std::string json;
+    for (int i = 99; i >= 0; i -= 3)
+    {
+        ASSERT_TRUE(reader.get("graph" + std::to_string(i), json));
+        ASSERT_EQ(i == 7 ? "{\"ID\": \"graph7\", \"replaced\": true}" : records[i], json);
+    }
+    ASSERT_FALSE(reader.get("graph100", json));
+
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(path + ".idx");
+}
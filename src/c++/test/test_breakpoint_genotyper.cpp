@@ -20,6 +20,9 @@
 #include "genotyping/BreakpointGenotyper.hh"
 #include "genotyping/GenotypingParameters.hh"
 #include "gmock/gmock.h"
+#include <algorithm>
+#include <boost/math/distributions/poisson.hpp>
+#include <limits>
 #include <math.h>
 #include <string>
 #include <vector>
@@ -71,4 +74,76 @@ TEST(BreakpointGenotyper, GenotypesWellCoveredBreakpoints)
     auto param2 = std::unique_ptr<GenotypingParameters>(new GenotypingParameters(alleles2, 2));
     BreakpointGenotyper genotyper_q(param2);
     EXPECT_EQ("1/3", (string)genotyper_q.genotype(b_param, { 1, 20, 2, 20, 2 }));
-}
\ No newline at end of file
+}
+
+TEST(BreakpointGenotyper, MatchesPoissonLikelihoods)
+{
+    const vector<string> alleles = { "REF", "ALT1", "ALT2" };
+    auto param = std::unique_ptr<GenotypingParameters>(new GenotypingParameters(alleles, 2));
+    BreakpointGenotyper genotyper(param);
+
+    const double read_depth = 40.0;
+    const int32_t read_length = 100;
+    const BreakpointGenotyperParameter b_param(read_depth, read_length, 20, false);
+    const double lambda = read_depth * (read_length - param->minOverlapBases()) / (double)read_length;
+
+    for (const auto& counts : vector<vector<int32_t>>{ { 20, 0, 0 }, { 11, 9, 1 }, { 0, 3, 30 }, { 300, 2, 0 } })
+    {
+        const Genotype result = genotyper.genotype(b_param, counts);
+        ASSERT_EQ(param->possibleGenotypes().size(), result.gl.size());
+        for (size_t gt_index = 0; gt_index < result.gl.size(); ++gt_index)
+        {
+            double expected_gl = 0;
+            for (unsigned int al = 0; al < alleles.size(); ++al)
+            {
+                const auto copies = std::count(result.gl_name[gt_index].begin(), result.gl_name[gt_index].end(), al);
+                const double rate = copies == 0 ? param->otherAlleleErrorRate()
+                                                : copies * param->otherHetHaplotypeFraction();
+                expected_gl += log(pdf(boost::math::poisson_distribution<>(lambda * rate), counts[al]));
+            }
+            if (std::isinf(expected_gl))
+            {
+                EXPECT_EQ(-std::numeric_limits<double>::max(), result.gl[gt_index]);
+            }
+            else
+            {
+                EXPECT_NEAR(expected_gl, result.gl[gt_index], 1e-9 * std::max(1.0, fabs(expected_gl)));
+            }
+        }
+    }
+}
+
+TEST(BreakpointGenotyper, PrunesGenotypesOfUnsupportedAlleles)
+{
+    const vector<string> alleles = { "REF", "ALT1", "ALT2", "ALT3", "ALT4", "ALT5" };
+    auto param = std::unique_ptr<GenotypingParameters>(new GenotypingParameters(alleles, 2));
+    BreakpointGenotyper genotyper(param);
+    auto pruned_param = std::unique_ptr<GenotypingParameters>(new GenotypingParameters(alleles, 2));
+    Json::Value pruned_json;
+    pruned_json["max_exhaustive_genotypes"] = 0;
+    pruned_param->setFromJson(pruned_json);
+    BreakpointGenotyper pruned_genotyper(pruned_param);
+
+    const BreakpointGenotyperParameter b_param(40.0, 100, 20, false);
+    const vector<int32_t> counts = { 0, 16, 0, 14, 0, 0 };
+    const Genotype full = genotyper.genotype(b_param, counts);
+    const Genotype pruned = pruned_genotyper.genotype(b_param, counts);
+
+    EXPECT_EQ("1/3", (string)pruned);
+    EXPECT_EQ(full.gt, pruned.gt);
+    EXPECT_EQ(full.gq, pruned.gq);
+    EXPECT_EQ(full.filters, pruned.filters);
+
+    // 1/1, 1/3, 3/3 and one copy of each of the four other alleles with 1 or 3
+    ASSERT_EQ(11ull, pruned.gl_name.size());
+    size_t full_index = 0;
+    for (size_t gt_index = 0; gt_index < pruned.gl_name.size(); ++gt_index)
+    {
+        while (full_index < full.gl_name.size() && full.gl_name[full_index] != pruned.gl_name[gt_index])
+        {
+            ++full_index;
+        }
+        ASSERT_LT(full_index, full.gl_name.size());
+        EXPECT_DOUBLE_EQ(full.gl[full_index], pruned.gl[gt_index]);
+    }
+}
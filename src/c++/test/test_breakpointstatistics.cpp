@@ -22,12 +22,66 @@
 #include <vector>
 
 #include "genotyping/BreakpointStatistics.hh"
+#include "graphcore/Graph.hh"
 
 using std::string;
 using std::vector;
+using graphtools::Graph;
 using namespace genotyping;
 
 TEST(BreakpointStatistics, CreatesEdgeList)
 {
     // TODO implement test
 }
+
+TEST(BreakpointStatistics, AddsCountsToExternalArrays)
+{
+    Graph graph{ 4 };
+    graph.setNodeName(0, "LF");
+    graph.setNodeSeq(0, "AAAAAAAAAAA");
+    graph.setNodeName(1, "P1");
+    graph.setNodeSeq(1, "TTTTTTTT");
+    graph.setNodeName(2, "Q1");
+    graph.setNodeSeq(2, "GGGGGGGG");
+    graph.setNodeName(3, "RF");
+    graph.setNodeSeq(3, "AAAAAAAAAAA");
+    graph.addEdge(0, 1);
+    graph.addEdge(0, 2);
+    graph.addEdge(0, 3);
+    graph.addLabelToEdge(0, 1, "P");
+    graph.addLabelToEdge(0, 1, "P2");
+    graph.addLabelToEdge(0, 2, "Q");
+    graph.addLabelToEdge(0, 3, "REF");
+
+    const BreakpointStatistics breakpoint(graph, 0, true);
+    ASSERT_EQ(vector<string>({ "LF_P1", "LF_Q1", "LF_RF" }), breakpoint.edgeNames());
+    ASSERT_EQ(vector<string>({ "P", "Q", "REF" }), breakpoint.canonicalAlleleNames());
+
+    Json::Value sample1;
+    sample1["read_counts_by_edge"]["LF_P1"] = 3;
+    sample1["read_counts_by_edge"]["LF_RF"] = 5;
+    Json::Value sample2;
+    sample2["read_counts_by_edge"]["LF_Q1"] = 7;
+
+    AlleleCounts edge_counts1(breakpoint.edgeNames().size(), 0);
+    AlleleCounts allele_counts1(breakpoint.canonicalAlleleNames().size(), 0);
+    breakpoint.addCounts(sample1, edge_counts1, allele_counts1);
+    AlleleCounts edge_counts2;
+    AlleleCounts allele_counts2;
+    breakpoint.addCounts(sample2, edge_counts2, allele_counts2);
+
+    ASSERT_EQ(AlleleCounts({ 3, 0, 5 }), edge_counts1);
+    ASSERT_EQ(AlleleCounts({ 3, 0, 5 }), allele_counts1);
+    ASSERT_EQ(3, breakpoint.getCount("P2", edge_counts1, allele_counts1));
+    ASSERT_EQ(7, breakpoint.getCount("LF_Q1", edge_counts2, allele_counts2));
+    ASSERT_EQ(7, breakpoint.getCount("Q", edge_counts2, allele_counts2));
+    ASSERT_EQ(0, breakpoint.getCount("REF", edge_counts2, allele_counts2));
+    ASSERT_EQ(0, breakpoint.getCount("X", edge_counts2, allele_counts2));
+
+    bool is_edge = false;
+    ASSERT_EQ(-1, breakpoint.countIndex("X", is_edge));
+    ASSERT_EQ(2, breakpoint.countIndex("LF_RF", is_edge));
+    ASSERT_TRUE(is_edge);
+    ASSERT_EQ(0, breakpoint.countIndex("P2", is_edge));
+    ASSERT_FALSE(is_edge);
+}
@@ -0,0 +1,133 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_countmatrix.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+#include "common/JsonHelpers.hh"
+#include "grmpy/CountMatrix.hh"
+
+using namespace grmpy;
+
+namespace
+{
+genotyping::SampleInfo makeSample(std::string const& name, double depth, std::string const& sex, std::string counts)
+{
+    genotyping::SampleInfo sample;
+    sample.set_sample_name(name);
+    sample.set_autosome_depth(depth);
+    sample.set_read_length(150);
+    sample.set_sex(sex);
+    Json::Value alignment = common::getJSON(
+        "{\"edges\": [{\"from\": \"source\", \"to\": \"alt\"}, {\"from\": \"source\", \"to\": \"ref\"}], "
+        "\"read_counts_by_edge\": "
+        + counts + "}");
+    sample.set_alignment_data(alignment);
+    return sample;
+}
+}
+
+TEST(CountMatrix, CollectsEdgeCounts)
+{
+    const genotyping::Samples samples = { makeSample("S1", 30.1, "male", "{\"source_ref\": 12, \"total\": 20}"),
+                                          makeSample("S2", 1.0 / 3, "female", "{\"source_alt\": 4}") };
+
+    const CountMatrix matrix = makeCountMatrix("graph.json", samples);
+    ASSERT_EQ("graph.json", matrix.graph_path);
+    ASSERT_EQ((std::vector<std::string>{ "source_alt", "source_ref" }), matrix.edge_names);
+    ASSERT_EQ((std::vector<int32_t>{ 0, 12, 4, 0 }), matrix.counts);
+    ASSERT_EQ(2ull, matrix.samples.size());
+    ASSERT_TRUE(matrix.samples[0].get_alignment_data().isNull());
+}
+
+TEST(CountMatrix, RoundTrip)
+{
+    const genotyping::Samples samples = { makeSample("S1", 30.1, "male", "{\"source_ref\": 12}"),
+                                          makeSample("S2", 1.0 / 3, "female", "{\"source_alt\": 4}"),
+                                          makeSample("S3", 15, "unknown", "{}") };
+    const CountMatrix first = makeCountMatrix("first.json", samples);
+    const CountMatrix second = makeCountMatrix("second.json", { samples[2] });
+
+    std::stringstream stream;
+    writeCountMatrix(stream, first);
+    writeCountMatrix(stream, second);
+
+    CountMatrix matrix;
+    ASSERT_TRUE(readCountMatrix(stream, matrix));
+    ASSERT_EQ("first.json", matrix.graph_path);
+    ASSERT_EQ(first.edge_names, matrix.edge_names);
+    ASSERT_EQ(first.counts, matrix.counts);
+    ASSERT_EQ(3ull, matrix.samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        ASSERT_EQ(samples[i].sample_name(), matrix.samples[i].sample_name());
+        // depths are used in the genotype likelihoods and must not lose precision
+        ASSERT_EQ(samples[i].autosome_depth(), matrix.samples[i].autosome_depth());
+        ASSERT_EQ(samples[i].depth_sd(), matrix.samples[i].depth_sd());
+        ASSERT_EQ(samples[i].read_length(), matrix.samples[i].read_length());
+        ASSERT_EQ(samples[i].sex(), matrix.samples[i].sex());
+    }
+
+    ASSERT_TRUE(readCountMatrix(stream, matrix));
+    ASSERT_EQ("second.json", matrix.graph_path);
+    ASSERT_EQ((std::vector<int32_t>{ 0, 0 }), matrix.counts);
+    ASSERT_EQ(1ull, matrix.samples.size());
+
+    ASSERT_FALSE(readCountMatrix(stream, matrix));
+}
+
+TEST(CountMatrix, EscapesNames)
+{
+    const genotyping::Samples samples = { makeSample("#S1", 30.1, "male", "{\"source_ref\": 12}"),
+                                          makeSample("S\t2\n\\t", 20, "female", "{\"source_alt\": 4}") };
+    const CountMatrix written = makeCountMatrix("#graph\tpath.json", samples);
+
+    std::stringstream stream;
+    writeCountMatrix(stream, written);
+    writeCountMatrix(stream, makeCountMatrix("second.json", { samples[0] }));
+
+    CountMatrix matrix;
+    ASSERT_TRUE(readCountMatrix(stream, matrix));
+    ASSERT_EQ(written.graph_path, matrix.graph_path);
+    ASSERT_EQ(written.counts, matrix.counts);
+    ASSERT_EQ(2ull, matrix.samples.size());
+    ASSERT_EQ("#S1", matrix.samples[0].sample_name());
+    ASSERT_EQ("S\t2\n\\t", matrix.samples[1].sample_name());
+
+    ASSERT_TRUE(readCountMatrix(stream, matrix));
+    ASSERT_EQ("second.json", matrix.graph_path);
+    ASSERT_EQ(1ull, matrix.samples.size());
+    ASSERT_EQ("#S1", matrix.samples[0].sample_name());
+    ASSERT_FALSE(readCountMatrix(stream, matrix));
+}
+
+TEST(CountMatrix, RejectsMalformedRows)
+{
+    std::stringstream stream("#graph\tg.json\n#columns\tsample\tdepth\tdepth_sd\tread_length\tsex\tsource_ref\n"
+                             "S1\t30\t12\t150\tmale\n");
+    CountMatrix matrix;
+    ASSERT_ANY_THROW(readCountMatrix(stream, matrix));
+}
@@ -17,6 +17,8 @@
 //
 //
 
+#include "common.hh"
+#include "common/JsonHelpers.hh"
 #include "common/Threads.hh"
 #include "grm/Align.hh"
 #include "grm/GraphAligner.hh"
@@ -26,6 +28,7 @@
 
 #include "gtest/gtest.h"
 #include <iostream>
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
@@ -103,4 +106,75 @@ TEST_F(DisambiguationTest, DisambiguatesReads)
     ASSERT_EQ(0ull, reads[2]->graph_sequences_supported().size());
     ASSERT_EQ(1ull, reads[3]->graph_sequences_supported().size());
     ASSERT_EQ("D", reads[3]->graph_sequences_supported(0));
-}
\ No newline at end of file
+}
+
+TEST_F(DisambiguationTest, SplitAlignmentKeepsInputOrder)
+{
+    const std::vector<std::string> sequences = { "AAAAAAAAAATTTTTTTTTTTTTTTTTTTTAAAAAAAAAA", "AAAAAAAAAATTTTTTTTTTT",
+                                                 "AAAAAAAAAATTTTTTTTTTGGGGGGGGGGAAAAAAAAAA", "CCCCCCCCCCCCCCCCCCCC",
+                                                 "AAAAAAAAAAAAAAAAAAAA" };
+    ReadBuffer sequential_reads;
+    ReadBuffer split_reads;
+    ReadBuffer threaded_reads;
+    for (int i = 0; i < 203; ++i)
+    {
+        const std::string& sequence = sequences[i % sequences.size()];
+        sequential_reads.emplace_back(new Read("f" + std::to_string(i), sequence, sequence));
+        split_reads.emplace_back(new Read("f" + std::to_string(i), sequence, sequence));
+        threaded_reads.emplace_back(new Read("f" + std::to_string(i), sequence, sequence));
+    }
+    ASSERT_EQ(50ull * 203, grm::alignmentCost(&graph, split_reads));
+
+    std::list<Path> paths;
+    grm::alignReads(&graph, paths, sequential_reads, nullptr, false, true, false, false, false);
+
+    common::CPU_THREADS().reset(4);
+    grm::alignReads(&graph, paths, split_reads, nullptr, false, true, false, false, false, 4, 0);
+    // cheap graphs are still split into one chunk per thread
+    grm::alignReads(
+        &graph, paths, threaded_reads, nullptr, false, true, false, false, false, 4,
+        std::numeric_limits<uint64_t>::max());
+    common::CPU_THREADS().reset(1);
+
+    ASSERT_EQ(sequential_reads.size(), split_reads.size());
+    ASSERT_EQ(sequential_reads.size(), threaded_reads.size());
+    ASSERT_GT(split_reads.size(), 0ull);
+    for (size_t i = 0; i < split_reads.size(); ++i)
+    {
+        ASSERT_EQ(sequential_reads[i]->fragment_id(), split_reads[i]->fragment_id());
+        ASSERT_EQ(sequential_reads[i]->graph_cigar(), split_reads[i]->graph_cigar());
+        ASSERT_EQ(sequential_reads[i]->fragment_id(), threaded_reads[i]->fragment_id());
+    }
+}
+
+TEST(GraphDeduplication, RelabelsResultForDuplicateGraph)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    Json::Value description = common::getJSON(test_data + "chrA.json");
+    description["ID"] = "first";
+    Json::Value duplicate_description = description;
+    duplicate_description["ID"] = "second";
+    duplicate_description["model_name"] = "other model";
+
+    paragraph::Parameters parameters;
+    parameters.loadDescription(description, test_data + "swaps.fa");
+    paragraph::Parameters duplicate_parameters;
+    duplicate_parameters.loadDescription(duplicate_description, test_data + "swaps.fa");
+    ASSERT_EQ(parameters.graphFingerprint(), duplicate_parameters.graphFingerprint());
+    ASSERT_NE(parameters.fingerprint(), duplicate_parameters.fingerprint());
+
+    paragraph::Parameters other_regions;
+    other_regions.loadDescription(description, test_data + "swaps.fa", "chrA:1-100");
+    ASSERT_NE(parameters.graphFingerprint(), other_regions.graphFingerprint());
+
+    Json::Value result = parameters.description();
+    result["read_counts_by_edge"]["total"] = 10;
+    result["bam"] = "sample.bam";
+    const Json::Value relabeled
+        = paragraph::relabelResult(result, parameters.description(), duplicate_parameters.description());
+    ASSERT_EQ("second", relabeled["ID"].asString());
+    ASSERT_EQ("other model", relabeled["model_name"].asString());
+    ASSERT_EQ(10, relabeled["read_counts_by_edge"]["total"].asInt());
+    ASSERT_EQ("sample.bam", relabeled["bam"].asString());
+    ASSERT_EQ(result["nodes"], relabeled["nodes"]);
+}
@@ -46,4 +46,21 @@ TEST(GenotypingParameters, setFromJson)
 
     std::vector<double> new_allele_error_rates = { 0.04, 0.1, 0.1 };
     EXPECT_EQ(param.alleleErrorRates(), new_allele_error_rates);
-}
\ No newline at end of file
+}
+TEST(GenotypingParameters, SkipsEnumeratingTooManyGenotypes)
+{
+    std::vector<std::string> alleles;
+    for (int allele = 0; allele < 64; ++allele)
+    {
+        alleles.push_back(allele == 0 ? "REF" : "ALT" + std::to_string(allele));
+    }
+    GenotypingParameters param(alleles, 4);
+    // 67 choose 4
+    EXPECT_EQ(766480ull, param.numPossibleGenotypes());
+    EXPECT_TRUE(param.possibleGenotypes().empty());
+
+    Json::Value js;
+    js["max_exhaustive_genotypes"] = 1000000;
+    param.setFromJson(js);
+    EXPECT_EQ(766480ull, param.possibleGenotypes().size());
+}
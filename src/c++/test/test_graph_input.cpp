@@ -152,4 +152,44 @@ TEST(Graph, DuplicateNodeNameDeathTest)
 
     Json::Value root = getJsonRoot(graph_spec_path);
     EXPECT_THROW(graphFromJson(root, reference_path), std::exception);
-}
\ No newline at end of file
+}
+
+TEST(Graph, FindsBreakpointWindows)
+{
+    // 50kb deletion and a 10bp insertion at its left end
+    Json::Value root;
+    const std::vector<std::pair<std::string, std::string>> nodes
+        = { { "left", "chr1:1001-2000" }, { "deleted", "chr1:2001-52000" }, { "right", "chr1:52001-53000" } };
+    for (const auto& node : nodes)
+    {
+        Json::Value node_json;
+        node_json["name"] = node.first;
+        node_json["reference"] = node.second;
+        root["nodes"].append(node_json);
+    }
+    Json::Value insertion;
+    insertion["name"] = "insertion";
+    insertion["sequence"] = "ACGTACGTAC";
+    root["nodes"].append(insertion);
+    for (const auto& edge : std::vector<std::pair<std::string, std::string>>{
+             { "left", "deleted" }, { "deleted", "right" }, { "left", "right" }, { "left", "insertion" },
+             { "insertion", "deleted" } })
+    {
+        Json::Value edge_json;
+        edge_json["from"] = edge.first;
+        edge_json["to"] = edge.second;
+        root["edges"].append(edge_json);
+    }
+    const std::list<common::Region> target_regions = { common::Region("chr1:1001-53000") };
+
+    const std::list<common::Region> windows = breakpointWindowsFromJson(root, target_regions, 500, 2000);
+    ASSERT_EQ(2ull, windows.size());
+    ASSERT_EQ("chr1:1500-2501", std::string(windows.front()));
+    ASSERT_EQ("chr1:51501-52501", std::string(windows.back()));
+
+    // windows are clipped to the target regions and merged when they are close
+    const std::list<common::Region> merged = breakpointWindowsFromJson(root, target_regions, 500, 50000);
+    ASSERT_EQ(1ull, merged.size());
+    ASSERT_EQ("chr1:1500-52501", std::string(merged.front()));
+    ASSERT_EQ("chr1:1001-53000", std::string(breakpointWindowsFromJson(root, target_regions, 50000, 0).front()));
+}
@@ -30,6 +30,7 @@
 #include "gtest/gtest.h"
 
 #include <limits>
+#include <sstream>
 #include <string>
 
 using std::string;
@@ -64,3 +65,16 @@ TEST(JsonHelpers, WritesInfAndNaN)
     const string observed = common::writeJson(input);
     ASSERT_EQ(expected, observed);
 }
+
+TEST(JsonHelpers, WritesLargeDoubles)
+{
+    Json::Value input;
+    input["a"] = -std::numeric_limits<double>::max();
+    input["b"] = 1e40;
+
+    std::istringstream output(common::writeJson(input));
+    Json::Value observed;
+    output >> observed;
+    ASSERT_EQ(-std::numeric_limits<double>::max(), observed["a"].asDouble());
+    ASSERT_EQ(1e40, observed["b"].asDouble());
+}
@@ -0,0 +1,101 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_memorybudget.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "common.hh"
+#include "common/BamReader.hh"
+#include "common/MemoryBudget.hh"
+#include "common/ReadExtraction.hh"
+
+using namespace common;
+
+TEST(MemoryBudget, UnlimitedNeverBlocks)
+{
+    MemoryBudget budget;
+    ASSERT_TRUE(budget.unlimited());
+    MemoryReservation r1(budget, 1000);
+    MemoryReservation r2(budget, 1000000);
+    ASSERT_EQ(0ull, budget.inFlight());
+}
+
+TEST(MemoryBudget, AcquireRelease)
+{
+    MemoryBudget budget(100);
+    {
+        MemoryReservation r1(budget, 40);
+        MemoryReservation r2(budget, 60);
+        ASSERT_EQ(100ull, budget.inFlight());
+    }
+    ASSERT_EQ(0ull, budget.inFlight());
+
+    // larger than the budget: admitted when nothing else runs
+    {
+        MemoryReservation r(budget, 1000);
+        ASSERT_EQ(1000ull, budget.inFlight());
+    }
+    ASSERT_EQ(0ull, budget.inFlight());
+}
+
+TEST(MemoryBudget, BlocksUntilReleased)
+{
+    MemoryBudget budget(100);
+    std::atomic<bool> admitted(false);
+    std::unique_ptr<MemoryReservation> r1(new MemoryReservation(budget, 80));
+
+    std::thread waiter([&budget, &admitted]() {
+        MemoryReservation r2(budget, 50);
+        admitted = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(admitted);
+    r1.reset();
+    waiter.join();
+    ASSERT_TRUE(admitted);
+    ASSERT_EQ(0ull, budget.inFlight());
+}
+
+TEST(MemoryBudget, EstimateFromIndex)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/round-trip-genotyping/";
+    BamReader reader(test_data + "sample1.bam", "", test_data + "dummy.fa");
+
+    size_t whole_contig = 0;
+    ASSERT_TRUE(reader.estimateRegionReadCount("chr1", whole_contig));
+    ASSERT_GT(whole_contig, 0ull);
+
+    size_t part = 0;
+    ASSERT_TRUE(reader.estimateRegionReadCount("chr1:1-100", part));
+    ASSERT_LE(part, whole_contig);
+
+    const std::list<Region> regions = { Region("chr1:1-100") };
+    ASSERT_EQ(std::min<size_t>(10, part), estimateNumReads(reader, regions, 10, 0));
+    ASSERT_LT(estimateReadBufferSize(10, 150), estimateReadBufferSize(20, 150));
+}
@@ -0,0 +1,172 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_paragraph_server.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "common.hh"
+#include "common/JsonHelpers.hh"
+#include "common/Threads.hh"
+#include "paragraph/JsonlWorkflow.hh"
+#include "paragraph/Server.hh"
+
+using namespace paragraph;
+
+static std::string sendRequests(const std::string& socket_path, const std::string& requests)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    EXPECT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+    EXPECT_EQ((ssize_t)requests.size(), ::send(fd, requests.data(), requests.size(), MSG_NOSIGNAL));
+    ::shutdown(fd, SHUT_WR);
+
+    std::string responses;
+    char chunk[4096];
+    ssize_t received = 0;
+    while ((received = ::recv(fd, chunk, sizeof(chunk), 0)) > 0)
+    {
+        responses.append(chunk, static_cast<size_t>(received));
+    }
+    ::close(fd);
+    return responses;
+}
+
+static Json::Value parseResponse(const std::string& response)
+{
+    Json::Value result;
+    std::istringstream input(response);
+    input >> result;
+    return result;
+}
+
+TEST(ParagraphServer, AnswersRequests)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string graph_path = test_data + "chrA.json";
+    const std::string socket_path = "/tmp/paragraph_test_server_" + std::to_string(::getpid()) + ".sock";
+
+    Parameters parameters(10000, 3, 0.01f, 0.8f, Parameters::NODE_READ_COUNTS | Parameters::EDGE_READ_COUNTS);
+    Server server(
+        socket_path, { test_data + "swaps.bam" }, { "" }, parameters, test_data + "swaps.fa", std::string());
+    std::thread server_thread([&server]() { server.run(); });
+
+    const std::string inline_graph = common::writeJson(common::getJSON(graph_path), false);
+    const std::string responses
+        = sendRequests(socket_path, graph_path + "\n\n" + inline_graph + "\n/no/such/graph.json\n");
+    sendRequests(socket_path, "shutdown\n");
+    server_thread.join();
+
+    std::istringstream response_stream(responses);
+    std::string by_path;
+    std::string by_value;
+    std::string failed;
+    ASSERT_TRUE((bool)std::getline(response_stream, by_path));
+    ASSERT_TRUE((bool)std::getline(response_stream, by_value));
+    ASSERT_TRUE((bool)std::getline(response_stream, failed));
+
+    const Json::Value by_path_json = parseResponse(by_path);
+    ASSERT_EQ(test_data + "swaps.bam", by_path_json["bam"].asString());
+    ASSERT_TRUE(by_path_json.isMember("read_counts_by_edge"));
+    ASSERT_FALSE(by_path_json["read_counts_by_edge"].empty());
+    ASSERT_EQ(by_path, by_value);
+    ASSERT_TRUE(parseResponse(failed).isMember("error"));
+}
+
+TEST(ParagraphServer, ProtectsSocketPath)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string socket_path = "/tmp/paragraph_test_server_file_" + std::to_string(::getpid()) + ".sock";
+    Parameters parameters(10000, 3, 0.01f, 0.8f, Parameters::NODE_READ_COUNTS | Parameters::EDGE_READ_COUNTS);
+
+    // an existing file which is not a socket must not be removed
+    std::ofstream(socket_path) << "data";
+    ASSERT_ANY_THROW(Server(
+        socket_path, { test_data + "swaps.bam" }, { "" }, parameters, test_data + "swaps.fa", std::string()));
+    struct stat file_stat;
+    ASSERT_EQ(0, ::lstat(socket_path.c_str(), &file_stat));
+    ASSERT_TRUE(S_ISREG(file_stat.st_mode));
+    ::unlink(socket_path.c_str());
+
+    Server server(
+        socket_path, { test_data + "swaps.bam" }, { "" }, parameters, test_data + "swaps.fa", std::string());
+    ASSERT_EQ(0, ::lstat(socket_path.c_str(), &file_stat));
+    ASSERT_TRUE(S_ISSOCK(file_stat.st_mode));
+    ASSERT_EQ((mode_t)0600, file_stat.st_mode & 0777);
+}
+
+TEST(JsonlWorkflow, WritesResultsInInputOrder)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    Parameters parameters(10000, 3, 0.01f, 0.8f, Parameters::NODE_READ_COUNTS | Parameters::EDGE_READ_COUNTS);
+    parameters.set_threads(3);
+
+    std::vector<std::string> graph_ids;
+    std::string graphs;
+    for (int repeat = 0; repeat != 3; ++repeat)
+    {
+        for (const char* graph : { "chrA", "chrB", "chrC" })
+        {
+            const std::string graph_path = test_data + graph + ".json";
+            graphs += (repeat == 1 ? common::writeJson(common::getJSON(graph_path), false) : graph_path) + "\n";
+            graph_ids.push_back(common::getJSON(graph_path)["target_regions"][0].asString());
+        }
+        graphs += "\n";
+    }
+
+    JsonlWorkflow workflow(
+        { test_data + "swaps.bam" }, { "" }, "-", "-", false, parameters, test_data + "swaps.fa", std::string());
+    std::istringstream input(graphs);
+    std::ostringstream output;
+    common::CPU_THREADS().reset(3);
+    workflow.processStream(input, output);
+    common::CPU_THREADS().reset(1);
+
+    std::istringstream output_lines(output.str());
+    std::string line;
+    std::vector<std::string> output_ids;
+    std::vector<std::string> outputs;
+    while (std::getline(output_lines, line))
+    {
+        const Json::Value result = parseResponse(line);
+        ASSERT_TRUE(result.isMember("read_counts_by_edge"));
+        output_ids.push_back(result["target_regions"][0].asString());
+        outputs.push_back(line);
+    }
+    ASSERT_EQ(graph_ids, output_ids);
+    // graph files and inline graphs give the same results
+    ASSERT_EQ(outputs[0], outputs[3]);
+    ASSERT_EQ(outputs[5], outputs[8]);
+}
@@ -0,0 +1,93 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_prefetcher.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "common/Prefetcher.hh"
+
+using namespace common;
+
+TEST(Prefetcher, ProducesInOrder)
+{
+    int produced = 0;
+    Prefetcher<int> prefetcher(2, [&produced](int& item) -> bool {
+        if (produced == 100)
+        {
+            return false;
+        }
+        item = produced++;
+        return true;
+    });
+
+    std::vector<int> consumed;
+    int item = -1;
+    while (prefetcher.next(item))
+    {
+        consumed.push_back(item);
+    }
+    ASSERT_EQ(100ull, consumed.size());
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_EQ(i, consumed[i]);
+    }
+    // stays drained
+    ASSERT_FALSE(prefetcher.next(item));
+}
+
+TEST(Prefetcher, RethrowsProducerException)
+{
+    int produced = 0;
+    Prefetcher<int> prefetcher(4, [&produced](int& item) -> bool {
+        if (produced == 3)
+        {
+            throw std::runtime_error("producer failed");
+        }
+        item = produced++;
+        return true;
+    });
+
+    int item = -1;
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_TRUE(prefetcher.next(item));
+        ASSERT_EQ(i, item);
+    }
+    ASSERT_THROW(prefetcher.next(item), std::runtime_error);
+}
+
+TEST(Prefetcher, CancelStopsProducer)
+{
+    Prefetcher<int> prefetcher(1, [](int& item) -> bool {
+        item = 0;
+        return true;
+    });
+    int item = -1;
+    ASSERT_TRUE(prefetcher.next(item));
+    prefetcher.cancel();
+    // destructor must not block on an endless producer
+}
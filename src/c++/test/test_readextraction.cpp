@@ -17,15 +17,28 @@
 //
 //
 
+#include <cstring>
+#include <functional>
+#include <list>
+#include <map>
 #include <string>
 #include <vector>
 
+#include <boost/filesystem.hpp>
+
+extern "C" {
+#include <htslib/sam.h>
+};
+
 #include "gmock/gmock.h"
 
 #include "common/Read.hh"
 #include "common/ReadExtraction.hh"
 #include "common/ReadPairs.hh"
+#include "common.hh"
+#include "common/BamReader.hh"
 #include "common/ReadReader.hh"
+#include "common/ReadSweep.hh"
 #include "common/Region.hh"
 
 using std::vector;
@@ -172,4 +185,335 @@ TEST_F(ExtractReads, isReadOrItsMateInRegion)
     read1.set_mate_chrom_id(1);
     read1.set_mate_pos(1600);
     ASSERT_TRUE(isReadOrItsMateInRegion(read1, region_overlap_mate));
-}
\ No newline at end of file
+}
+
+TEST(SubsampledExtraction, KeepsPairsUniformly)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    BamReader reader(test_data + "swaps.bam", "", test_data + "swaps.fa");
+    const std::list<Region> target_regions = { Region("chrA:1350-1659") };
+
+    std::vector<p_Read> all_reads;
+    extractReads(reader, target_regions, 100000, 0, all_reads);
+    ASSERT_LT(200ull, all_reads.size());
+
+    // the extended region is about 2300bp, so a density of 0.1 keeps fewer than 230 reads
+    std::vector<p_Read> subsampled_reads;
+    extractReads(reader, target_regions, 100000, 0, subsampled_reads, 333, 0.1);
+    ASSERT_LT(0ull, subsampled_reads.size());
+    ASSERT_GE(230ull, subsampled_reads.size());
+
+    std::map<std::string, int> fragment_reads;
+    std::map<std::string, int> all_fragment_reads;
+    uint32_t max_hash = 0;
+    for (const auto& read : subsampled_reads)
+    {
+        ++fragment_reads[read->fragment_id()];
+        max_hash = std::max(max_hash, ReadPairs::fragmentHash(read->fragment_id()));
+    }
+    for (const auto& read : all_reads)
+    {
+        ++all_fragment_reads[read->fragment_id()];
+    }
+    // every pair with a fragment hash below the threshold is kept with both mates
+    for (const auto& fragment : all_fragment_reads)
+    {
+        if (ReadPairs::fragmentHash(fragment.first) <= max_hash)
+        {
+            ASSERT_EQ(fragment.second, fragment_reads[fragment.first]) << fragment.first;
+        }
+    }
+
+    // regions below the limit are not subsampled
+    std::vector<p_Read> unlimited_reads;
+    extractReads(reader, target_regions, 10, 0, unlimited_reads, 333, 100.0);
+    ASSERT_EQ(all_reads.size(), unlimited_reads.size());
+}
+
+TEST(ReadExtraction, EstimatesReadLength)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    BamReader reader(test_data + "swaps.bam", "", test_data + "swaps.fa");
+    ASSERT_EQ(150ull, estimateReadLength(reader));
+
+    // the reader can still be used for regions afterwards
+    std::vector<p_Read> reads;
+    extractReads(reader, { Region("chrA:1350-1659") }, 100000, 0, reads);
+    ASSERT_LT(200ull, reads.size());
+    ASSERT_EQ(150ull, estimateReadLength(reader, 1));
+}
+
+TEST(ReadCache, SameReadsAsUncached)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    BamReader uncached(test_data + "swaps.bam", "", test_data + "swaps.fa");
+    BamReader cached(test_data + "swaps.bam", "", test_data + "swaps.fa");
+    cached.enableReadCache(100000);
+    BamReader small_cache(test_data + "swaps.bam", "", test_data + "swaps.fa");
+    small_cache.enableReadCache(10);
+
+    // nested, sliding, disjoint and leftwards regions, and a region on another contig
+    const std::vector<std::string> regions
+        = { "chrA:1000-1600", "chrA:1200-1400", "chrA:1300-1900", "chrA:1899-2100", "chrA:500-800",
+            "chrB:1300-1700", "chrB",           "chrA:1300-1500" };
+    for (const auto& region : regions)
+    {
+        std::vector<Read> expected_reads;
+        Read read;
+        uncached.setRegion(region);
+        while (uncached.getAlign(read))
+        {
+            expected_reads.push_back(read);
+        }
+        ASSERT_FALSE(expected_reads.empty()) << region;
+
+        for (BamReader* reader : { &cached, &small_cache })
+        {
+            std::vector<Read> observed_reads;
+            reader->setRegion(region);
+            while (reader->getAlign(read))
+            {
+                observed_reads.push_back(read);
+            }
+            ASSERT_EQ(expected_reads, observed_reads) << region;
+        }
+
+        for (size_t r = 0; r < expected_reads.size(); r += 100)
+        {
+            const Read& expected_read = expected_reads[r];
+            Read expected_mate;
+            Read observed_mate;
+            const bool found = uncached.getAlignedMate(expected_read, expected_mate);
+            // once to fill the cache, once from the cache
+            for (int i = 0; i < 2; ++i)
+            {
+                ASSERT_EQ(found, cached.getAlignedMate(expected_read, observed_mate));
+                ASSERT_EQ(expected_mate, observed_mate);
+            }
+        }
+    }
+}
+
+TEST(ReadSweep, SameReadsAsExtractReads)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string reference = test_data + "swaps.fa";
+
+    // the same BAM without an index, so mates are recovered in a second pass
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-sweeptest");
+    boost::filesystem::create_directories(dir);
+    const std::string unindexed_bam = (dir / "swaps.bam").string();
+    boost::filesystem::copy_file(test_data + "swaps.bam", unindexed_bam);
+
+    struct Target
+    {
+        std::list<Region> regions;
+        int max_num_reads;
+        unsigned longest_alt_insertion;
+    };
+    // nested, overlapping, multi-region and empty targets, targets that hit the read limit or recover mates
+    const std::vector<Target> targets
+        = { { { Region("chrA:1000-1600") }, 10000, 0 },
+            { { Region("chrA:1200-1400") }, 10000, 1000 },
+            { { Region("chrB:1300-1700"), Region("chrA:500-800") }, 10000, 1000 },
+            { { Region("chrA:1300-1500") }, 20, 1000 },
+            { { Region("chrC:1000-1200") }, 10000, 1000 },
+            { {}, 10000, 0 } };
+
+    BamReader reader(test_data + "swaps.bam", "", reference);
+    std::vector<std::vector<Read>> expected_reads;
+    for (const auto& target : targets)
+    {
+        ReadBuffer reads;
+        extractReads(reader, target.regions, target.max_num_reads, target.longest_alt_insertion, reads);
+        expected_reads.emplace_back();
+        for (const auto& read : reads)
+        {
+            expected_reads.back().push_back(*read);
+        }
+    }
+
+    for (const std::string& bam : { test_data + "swaps.bam", unindexed_bam })
+    {
+        ReadSweep sweep(bam, "", reference);
+        for (const auto& target : targets)
+        {
+            sweep.addTarget(target.regions, target.max_num_reads, target.longest_alt_insertion);
+        }
+        std::vector<bool> seen(targets.size(), false);
+        std::size_t target = 0;
+        ReadBuffer reads;
+        while (sweep.next(target, reads))
+        {
+            ASSERT_FALSE(seen[target]) << bam;
+            seen[target] = true;
+            std::vector<Read> observed_reads;
+            for (const auto& read : reads)
+            {
+                observed_reads.push_back(*read);
+            }
+            ASSERT_EQ(expected_reads[target], observed_reads) << bam << " target " << target;
+        }
+        ASSERT_EQ(std::vector<bool>(targets.size(), true), seen) << bam;
+    }
+    boost::filesystem::remove_all(dir);
+}
+
+TEST(MultiFileReader, PairsReadsAcrossFiles)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string reference = test_data + "swaps.fa";
+
+    // split the BAM into one file with the first and one with the second mates
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-multifiletest");
+    boost::filesystem::create_directories(dir);
+    const std::vector<std::string> parts = { (dir / "first.bam").string(), (dir / "second.bam").string() };
+    {
+        samFile* input = sam_open((test_data + "swaps.bam").c_str(), "r");
+        ASSERT_NE(nullptr, input);
+        bam_hdr_t* header = sam_hdr_read(input);
+        samFile* first = sam_open(parts[0].c_str(), "wb");
+        samFile* second = sam_open(parts[1].c_str(), "wb");
+        ASSERT_EQ(0, sam_hdr_write(first, header));
+        ASSERT_EQ(0, sam_hdr_write(second, header));
+        bam1_t* record = bam_init1();
+        while (sam_read1(input, header, record) >= 0)
+        {
+            ASSERT_LE(0, sam_write1((record->core.flag & BAM_FREAD1) ? first : second, header, record));
+        }
+        bam_destroy1(record);
+        sam_close(first);
+        sam_close(second);
+        bam_hdr_destroy(header);
+        sam_close(input);
+        for (const auto& part : parts)
+        {
+            ASSERT_EQ(0, sam_index_build(part.c_str(), 0));
+        }
+    }
+
+    BamReader single(test_data + "swaps.bam", "", reference);
+    BamReader merged(parts, {}, reference);
+    for (const auto& region : { "chrA:1000-1600", "chrB:1300-1700", "chrC" })
+    {
+        std::vector<int64_t> expected_positions;
+        Read read;
+        single.setRegion(region);
+        while (single.getAlign(read))
+        {
+            expected_positions.push_back(read.pos());
+        }
+        std::vector<int64_t> observed_positions;
+        merged.setRegion(region);
+        while (merged.getAlign(read))
+        {
+            observed_positions.push_back(read.pos());
+        }
+        ASSERT_EQ(expected_positions, observed_positions) << region;
+
+        ReadBuffer expected_reads;
+        extractReads(single, { Region(region) }, 10000, 1000, expected_reads);
+        ReadBuffer observed_reads;
+        extractReads(merged, { Region(region) }, 10000, 1000, observed_reads);
+        ASSERT_EQ(expected_reads.size(), observed_reads.size()) << region;
+        for (size_t r = 0; r != expected_reads.size(); ++r)
+        {
+            ASSERT_EQ(*expected_reads[r], *observed_reads[r]) << region;
+        }
+    }
+    boost::filesystem::remove_all(dir);
+}
+
+TEST(ReadGroupExtraction, SameReadsAsSeparateFiles)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string reference = test_data + "swaps.fa";
+
+    // assign the fragments to read groups A and B, and also write the reads of each read group to a separate file
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-readgrouptest");
+    boost::filesystem::create_directories(dir);
+    const std::string tagged = (dir / "tagged.bam").string();
+    const std::vector<std::string> parts = { (dir / "A.bam").string(), (dir / "B.bam").string() };
+    {
+        samFile* input = sam_open((test_data + "swaps.bam").c_str(), "r");
+        ASSERT_NE(nullptr, input);
+        bam_hdr_t* header = sam_hdr_read(input);
+        bam_hdr_t* tagged_header = bam_hdr_dup(header);
+        const std::string text = std::string(header->text, header->l_text) + "@RG\tID:A\tSM:a\n@RG\tID:B\tSM:b\n";
+        free(tagged_header->text);
+        tagged_header->text = strdup(text.c_str());
+        tagged_header->l_text = static_cast<uint32_t>(text.size());
+
+        samFile* tagged_output = sam_open(tagged.c_str(), "wb");
+        samFile* part_outputs[] = { sam_open(parts[0].c_str(), "wb"), sam_open(parts[1].c_str(), "wb") };
+        ASSERT_EQ(0, sam_hdr_write(tagged_output, tagged_header));
+        ASSERT_EQ(0, sam_hdr_write(part_outputs[0], header));
+        ASSERT_EQ(0, sam_hdr_write(part_outputs[1], header));
+        bam1_t* record = bam_init1();
+        while (sam_read1(input, header, record) >= 0)
+        {
+            const size_t part = std::hash<std::string>()(bam_get_qname(record)) % 2;
+            ASSERT_LE(0, sam_write1(part_outputs[part], header, record));
+            const std::string read_group = part ? "B" : "A";
+            bam_aux_append(
+                record, "RG", 'Z', static_cast<int>(read_group.size() + 1),
+                reinterpret_cast<const uint8_t*>(read_group.c_str()));
+            ASSERT_LE(0, sam_write1(tagged_output, tagged_header, record));
+        }
+        bam_destroy1(record);
+        sam_close(tagged_output);
+        sam_close(part_outputs[0]);
+        sam_close(part_outputs[1]);
+        bam_hdr_destroy(tagged_header);
+        bam_hdr_destroy(header);
+        sam_close(input);
+        ASSERT_EQ(0, sam_index_build(tagged.c_str(), 0));
+        for (const auto& part : parts)
+        {
+            ASSERT_EQ(0, sam_index_build(part.c_str(), 0));
+        }
+    }
+
+    BamReader tagged_reader(tagged, "", reference);
+    tagged_reader.enableReadCache(100000);
+    const std::list<Region> regions = { Region("chrA:1000-1600"), Region("chrB:1300-1700"), Region("chrC") };
+    // read groups are only decoded once the reader is used for read group extraction
+    ReadBuffer untagged_reads;
+    extractReads(tagged_reader, regions, 10000, 1000, untagged_reads);
+    ASSERT_LT(0ull, untagged_reads.size());
+    ASSERT_EQ("", untagged_reads.front()->read_group());
+    std::vector<ReadBuffer> sample_reads;
+    extractReadGroupReads(tagged_reader, regions, 10000, 1000, { "SA", "SB" }, { { "A" }, { "B" } }, sample_reads);
+    ASSERT_EQ(2ull, sample_reads.size());
+    for (size_t part = 0; part != parts.size(); ++part)
+    {
+        ReadBuffer expected_reads;
+        extractReads(parts[part], "", reference, regions, 10000, 1000, expected_reads);
+        ASSERT_LT(0ull, expected_reads.size());
+        ASSERT_EQ(expected_reads.size(), sample_reads[part].size());
+        for (size_t r = 0; r != expected_reads.size(); ++r)
+        {
+            ASSERT_EQ(*expected_reads[r], *sample_reads[part][r]);
+            ASSERT_EQ(part ? "B" : "A", sample_reads[part][r]->read_group());
+        }
+    }
+
+    const auto depths = tagged_reader.estimateReadGroupDepths("chrA");
+    ASSERT_EQ(3ull, depths.size());
+    const auto all_reads = BamReader(test_data + "swaps.bam", "", reference).estimateDepth("chrA");
+    ASSERT_EQ(all_reads->read_count, depths.at("")->read_count);
+    ASSERT_EQ(all_reads->depth_median, depths.at("")->depth_median);
+    ASSERT_EQ(all_reads->read_count, depths.at("A")->read_count + depths.at("B")->read_count);
+    for (size_t part = 0; part != parts.size(); ++part)
+    {
+        const auto part_depth = BamReader(parts[part], "", reference).estimateDepth("chrA");
+        const auto& read_group_depth = depths.at(part ? "B" : "A");
+        ASSERT_EQ(part_depth->read_count, read_group_depth->read_count);
+        ASSERT_EQ(part_depth->read_length, read_group_depth->read_length);
+        ASSERT_EQ(part_depth->depth_median, read_group_depth->depth_median);
+    }
+    boost::filesystem::remove_all(dir);
+}
@@ -0,0 +1,179 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+#include "common.hh"
+#include "common/Fasta.hh"
+#include "common/JsonHelpers.hh"
+#include "grm/Align.hh"
+#include "grm/GraphInput.hh"
+#include "oligo/KmerBloomFilter.hh"
+#include "paragraph/ReferencePrescreen.hh"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace testing;
+using namespace common;
+using namespace graphtools;
+
+class ReferencePrescreenTest : public Test
+{
+public:
+    std::string reference_path;
+    Json::Value description;
+    Graph graph;
+    FastaFile reference;
+
+    virtual void SetUp()
+    {
+        const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+        reference_path = test_data + "swaps.fa";
+        description = getJSON(test_data + "chrA.json");
+        graph = grm::graphFromJson(description, reference_path);
+        reference = FastaFile(reference_path);
+    }
+
+    /**
+     * @param pos 0-based start of the linear alignment
+     */
+    p_Read makeRead(std::string const& name, std::string const& bases, int32_t pos)
+    {
+        p_Read read(new Read(name, bases, std::string(bases.size(), '#')));
+        read->set_pos(pos);
+        read->set_has_single_match_cigar(true);
+        return read;
+    }
+};
+
+TEST_F(ReferencePrescreenTest, PlacesReferenceReadsLikeGraphAligner)
+{
+    paragraph::ReferencePrescreen prescreen(&graph, description);
+    ASSERT_TRUE(prescreen.enabled());
+
+    // spans the insertion breakpoint on the reference path
+    ReadBuffer reads;
+    reads.emplace_back(makeRead("spanning", reference.query("chrA:1450-1549"), 1449));
+    ASSERT_FALSE(prescreen.hasAltKmer(*reads.front()));
+    ReadBuffer aligned_reads;
+    aligned_reads.emplace_back(new Read(*reads.front()));
+
+    ASSERT_TRUE(prescreen.alignToReference(*reads.front()));
+    ASSERT_EQ(Read::MAPPED, reads.front()->graph_mapping_status());
+    grm::alignReads(
+        &graph, grm::pathsFromJson(&graph, description["paths"]), aligned_reads, nullptr, false, true, false, false,
+        false);
+    ASSERT_EQ(1ull, aligned_reads.size());
+    ASSERT_EQ(aligned_reads.front()->graph_pos(), reads.front()->graph_pos());
+    ASSERT_EQ(aligned_reads.front()->graph_cigar(), reads.front()->graph_cigar());
+    ASSERT_EQ(aligned_reads.front()->graph_alignment_score(), reads.front()->graph_alignment_score());
+}
+
+TEST_F(ReferencePrescreenTest, ClipsMismatchingEndsLikeGraphAligner)
+{
+    paragraph::ReferencePrescreen prescreen(&graph, description);
+
+    std::string bases = reference.query("chrA:1450-1549");
+    bases.back() = bases.back() == 'A' ? 'C' : 'A';
+    p_Read read = makeRead("mismatch", bases, 1449);
+    ReadBuffer aligned_reads;
+    aligned_reads.emplace_back(new Read(*read));
+
+    ASSERT_TRUE(prescreen.alignToReference(*read));
+    grm::alignReads(
+        &graph, grm::pathsFromJson(&graph, description["paths"]), aligned_reads, nullptr, false, true, false, false,
+        false);
+    ASSERT_EQ(1ull, aligned_reads.size());
+    ASSERT_EQ(aligned_reads.front()->graph_pos(), read->graph_pos());
+    ASSERT_EQ(aligned_reads.front()->graph_cigar(), read->graph_cigar());
+    ASSERT_EQ(aligned_reads.front()->graph_alignment_score(), read->graph_alignment_score());
+}
+
+TEST_F(ReferencePrescreenTest, DetectsAltReads)
+{
+    paragraph::ReferencePrescreen prescreen(&graph, description);
+
+    const std::string alt_bases
+        = reference.query("chrA:1450-1502") + "AGTAA" + reference.query("chrA:1507-1548");
+    Read alt_read = *makeRead("alt", alt_bases, 1449);
+    ASSERT_TRUE(prescreen.hasAltKmer(alt_read));
+    ASSERT_FALSE(prescreen.alignToReference(alt_read));
+
+    // linear alignment which does not match the reference path
+    Read shifted_read = *makeRead("shifted", reference.query("chrA:1400-1499"), 1402);
+    ASSERT_FALSE(prescreen.hasAltKmer(shifted_read));
+    ASSERT_FALSE(prescreen.alignToReference(shifted_read));
+    ASSERT_NE(Read::MAPPED, shifted_read.graph_mapping_status());
+
+    // soft-clipped or gapped in the BAM record
+    Read clipped_read = *makeRead("clipped", reference.query("chrA:1450-1549"), 1449);
+    clipped_read.set_has_single_match_cigar(false);
+    ASSERT_FALSE(prescreen.alignToReference(clipped_read));
+
+    // overhangs the start of the reference path
+    Read overhanging_read = *makeRead("overhanging", reference.query("chrA:1320-1419"), 1319);
+    ASSERT_FALSE(prescreen.alignToReference(overhanging_read));
+}
+
+TEST_F(ReferencePrescreenTest, DisabledWithoutReferencePath)
+{
+    Json::Value no_reference = description;
+    no_reference["paths"] = Json::arrayValue;
+    paragraph::ReferencePrescreen prescreen(&graph, no_reference);
+    ASSERT_FALSE(prescreen.enabled());
+}
+
+TEST_F(ReferencePrescreenTest, TriagesFlankReads)
+{
+    paragraph::ReferencePrescreen prescreen(&graph, description);
+
+    Read flank_read = *makeRead("flank", reference.query("chrA:1360-1459"), 1359);
+    ASSERT_FALSE(prescreen.hasInformativeKmer(flank_read));
+    ASSERT_TRUE(prescreen.alignToFlank(flank_read, 0.0));
+    ASSERT_EQ(10, flank_read.graph_pos());
+    ASSERT_EQ("1[100M]", flank_read.graph_cigar());
+
+    std::string mismatch_bases = reference.query("chrA:1360-1459");
+    mismatch_bases[50] = mismatch_bases[50] == 'A' ? 'C' : 'A';
+    Read mismatch_read = *makeRead("mismatch", mismatch_bases, 1359);
+    ASSERT_FALSE(prescreen.alignToFlank(mismatch_read, 0.0));
+    ASSERT_TRUE(prescreen.alignToFlank(mismatch_read, 0.05));
+    ASSERT_EQ("1[50M1X49M]", mismatch_read.graph_cigar());
+
+    // spans the edges around the insertion
+    Read spanning_read = *makeRead("spanning", reference.query("chrA:1450-1549"), 1449);
+    ASSERT_TRUE(prescreen.hasInformativeKmer(spanning_read));
+    ASSERT_FALSE(prescreen.alignToFlank(spanning_read, 0.05));
+}
+
+TEST(KmerBloomFilter, HasNoFalseNegatives)
+{
+    oligo::KmerBloomFilter<unsigned> filter(1000);
+    for (unsigned kmer = 0; kmer != 1000; ++kmer)
+    {
+        filter.insert(kmer * 7919);
+    }
+    size_t false_positives = 0;
+    for (unsigned kmer = 0; kmer != 1000; ++kmer)
+    {
+        ASSERT_TRUE(filter.mayContain(kmer * 7919));
+        false_positives += filter.mayContain(kmer * 7919 + 1) ? 1 : 0;
+    }
+    ASSERT_LT(false_positives, 50ull);
+}
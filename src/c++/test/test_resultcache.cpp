@@ -0,0 +1,97 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_resultcache.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "common/ResultCache.hh"
+
+using namespace common;
+
+TEST(ResultCache, KeyDigest)
+{
+    const std::string digest = CacheKey().add("a", "bc").add("d", "").digest();
+    ASSERT_EQ(32ull, digest.size());
+    ASSERT_EQ(digest, CacheKey().add("a", "bc").add("d", "").digest());
+
+    // values are length-prefixed, so moving characters between them changes the key
+    ASSERT_NE(digest, CacheKey().add("a", "b").add("d", "c").digest());
+    ASSERT_NE(digest, CacheKey().add("a", "bc").digest());
+}
+
+TEST(ResultCache, KeyChangesWithFile)
+{
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-cachetest");
+    boost::filesystem::create_directories(dir);
+    const std::string file = (dir / "input.txt").string();
+    {
+        std::ofstream out(file);
+        out << "abc";
+    }
+    const std::string before = CacheKey().addFile("input", file).digest();
+    ASSERT_EQ(before, CacheKey().addFile("input", file).digest());
+    {
+        std::ofstream out(file, std::ios::app);
+        out << "def";
+    }
+    ASSERT_NE(before, CacheKey().addFile("input", file).digest());
+    boost::filesystem::remove_all(dir);
+}
+
+TEST(ResultCache, PutGet)
+{
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-cachetest");
+    {
+        ResultCache disabled;
+        ASSERT_FALSE(disabled.enabled());
+        std::string value;
+        ASSERT_FALSE(disabled.get(CacheKey().digest(), value));
+    }
+
+    ResultCache cache(dir.string());
+    ASSERT_TRUE(cache.enabled());
+
+    const std::string key1 = CacheKey().add("graph", "1").digest();
+    const std::string key2 = CacheKey().add("graph", "2").digest();
+    std::string value;
+    ASSERT_FALSE(cache.get(key1, value));
+
+    cache.put(key1, "{\"result\": 1}");
+    ASSERT_TRUE(cache.get(key1, value));
+    ASSERT_EQ("{\"result\": 1}", value);
+    ASSERT_FALSE(cache.get(key2, value));
+
+    // a second cache on the same directory sees earlier entries
+    ResultCache reopened(dir.string());
+    ASSERT_TRUE(reopened.get(key1, value));
+    ASSERT_EQ("{\"result\": 1}", value);
+
+    boost::filesystem::remove_all(dir);
+}
@@ -143,3 +143,15 @@ TEST(String, StringParsePos)
     ASSERT_EQ(start, 999);
     ASSERT_EQ(end, 1999);
 }
+
+TEST(String, StringParseMemorySize)
+{
+    ASSERT_EQ(parseMemorySize("1234"), 1234ull);
+    ASSERT_EQ(parseMemorySize("2k"), 2048ull);
+    ASSERT_EQ(parseMemorySize("512M"), 512ull * 1024 * 1024);
+    ASSERT_EQ(parseMemorySize("1.5G"), 3ull * 512 * 1024 * 1024);
+    ASSERT_EQ(parseMemorySize("16GB"), 16ull * 1024 * 1024 * 1024);
+    ASSERT_EQ(parseMemorySize("1T"), 1024ull * 1024 * 1024 * 1024);
+    ASSERT_THROW(parseMemorySize("12X"), std::invalid_argument);
+    ASSERT_THROW(parseMemorySize("G"), std::invalid_argument);
+}
@@ -0,0 +1,129 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Paragraph
+// Copyright (c) 2016-2019 Illumina, Inc.
+// All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//		http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied
+// See the License for the specific language governing permissions and limitations
+//
+//
+
+/**
+ *
+ * \file test_unmappedreadindex.cpp
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+extern "C" {
+#include <htslib/sam.h>
+};
+
+#include "common.hh"
+#include "common/Fasta.hh"
+#include "common/UnmappedReadIndex.hh"
+
+using namespace common;
+
+TEST(UnmappedReadIndex, RecruitsReadsSharingKmers)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string reference = test_data + "swaps.fa";
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-unmappedtest");
+    boost::filesystem::create_directories(dir);
+    const std::string index_file = (dir / "sample.unmapped.idx").string();
+
+    // all reads of the test BAM have a lower MAPQ than this
+    auto index = UnmappedReadIndex::open({ test_data + "swaps.bam" }, reference, index_file, 255);
+    ASSERT_LT(0ull, index->numReads());
+    const auto modified = boost::filesystem::last_write_time(index_file);
+    index = UnmappedReadIndex::open({ test_data + "swaps.bam" }, reference, index_file, 255);
+    ASSERT_EQ(modified, boost::filesystem::last_write_time(index_file));
+
+    const std::vector<std::string> sequences = { FastaFile(reference).query("chrA:1450-1549") };
+    ReadBuffer reads;
+    const size_t recruited = index->recruitReads(sequences, 1000, reads);
+    ASSERT_LT(0ull, recruited);
+    ASSERT_EQ(recruited, reads.size());
+    // recruited reads overlap the sequence
+    for (const auto& read : reads)
+    {
+        ASSERT_LT(read->pos(), 1549);
+        ASSERT_GT(read->pos() + static_cast<int64_t>(read->bases().size()), 1449);
+    }
+
+    // reads are only added once
+    ASSERT_EQ(0ull, index->recruitReads(sequences, 1000, reads));
+
+    ReadBuffer limited_reads;
+    ASSERT_EQ(1ull, index->recruitReads(sequences, 1, limited_reads));
+
+    // a different MAPQ threshold rebuilds the index
+    index = UnmappedReadIndex::open({ test_data + "swaps.bam" }, reference, index_file, 0);
+    ASSERT_EQ(0ull, index->numReads());
+    boost::filesystem::remove_all(dir);
+}
+
+TEST(UnmappedReadIndex, IndexesUnmappedReadsPlacedAtTheirMate)
+{
+    const std::string test_data = g_testenv->getBasePath() + "/../share/test-data/genotyping_test_2/";
+    const std::string reference = test_data + "swaps.fa";
+    const boost::filesystem::path dir
+        = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-unmappedtest");
+    boost::filesystem::create_directories(dir);
+    const std::string bam = (dir / "placed.bam").string();
+    const std::string index_file = (dir / "placed.unmapped.idx").string();
+
+    // flag the first read of each pair as unmapped, keeping the position of its mate like aligners do
+    size_t num_unmapped = 0;
+    {
+        samFile* input = sam_open((test_data + "swaps.bam").c_str(), "r");
+        bam_hdr_t* header = sam_hdr_read(input);
+        samFile* output = sam_open(bam.c_str(), "wb");
+        ASSERT_EQ(0, sam_hdr_write(output, header));
+        bam1_t* record = bam_init1();
+        while (sam_read1(input, header, record) >= 0)
+        {
+            if ((record->core.flag & BAM_FREAD1) != 0)
+            {
+                record->core.flag |= BAM_FUNMAP;
+                if ((record->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) == 0)
+                {
+                    ++num_unmapped;
+                }
+            }
+            ASSERT_LE(0, sam_write1(output, header, record));
+        }
+        bam_destroy1(record);
+        sam_close(output);
+        bam_hdr_destroy(header);
+        sam_close(input);
+        ASSERT_EQ(0, sam_index_build(bam.c_str(), 0));
+    }
+    ASSERT_LT(0ull, num_unmapped);
+
+    auto index = UnmappedReadIndex::open({ bam }, reference, index_file, 0);
+    ASSERT_EQ(num_unmapped, index->numReads());
+
+    const std::vector<std::string> sequences = { FastaFile(reference).query("chrA:1450-1549") };
+    ReadBuffer reads;
+    ASSERT_LT(0ull, index->recruitReads(sequences, 1000, reads));
+    for (const auto& read : reads)
+    {
+        ASSERT_TRUE(read->is_first_mate());
+    }
+    boost::filesystem::remove_all(dir);
+}